@@ -11,12 +11,26 @@ LOCAL_MODULE_TAGS := optional
 LOCAL_CPP_EXTENSION := .cc
 
 LOCAL_SRC_FILES := \
+		src/allocation_counter.cc \
 		src/audiofuntest.cc \
 		src/binary_client.cc \
+		src/capture_thread.cc \
 		src/common.cc \
 		src/evaluator.cc \
+		src/fft.cc \
+		src/file_source.cc \
 		src/generator_player.cc \
-		src/tone_generators.cc
+		src/glitch_detector.cc \
+		src/goertzel.cc \
+		src/oscillator.cc \
+		src/pilot_tracker.cc \
+		src/sample_format.cc \
+		src/spectrogram.cc \
+		src/spectrum_analyzer.cc \
+		src/sweep_analyzer.cc \
+		src/tone_cache.cc \
+		src/tone_generators.cc \
+		src/window.cc
 
 LOCAL_MODULE := audiofuntest
 
@@ -27,6 +27,7 @@ struct alsa_conformance_args {
 	int iterations;
 	double merge_threshold;
 	snd_pcm_sframes_t merge_threshold_sz;
+	int perf_counters;
 };
 
 struct alsa_conformance_args *args_create()
@@ -53,6 +54,7 @@ struct alsa_conformance_args *args_create()
 	args->iterations = 1;
 	args->merge_threshold = 0.0001;
 	args->merge_threshold_sz = 0;
+	args->perf_counters = false;
 
 	return args;
 }
@@ -130,6 +132,11 @@ snd_pcm_sframes_t args_get_merge_threshold_sz(const struct alsa_conformance_args
 	return args->merge_threshold_sz;
 }
 
+int args_get_perf_counters(const struct alsa_conformance_args *args)
+{
+	return args->perf_counters;
+}
+
 void args_set_playback_dev_name(struct alsa_conformance_args *args,
 				const char *name)
 {
@@ -210,3 +217,7 @@ void args_set_merge_threshold_sz(struct alsa_conformance_args *args,
 	args->merge_threshold_sz = (snd_pcm_sframes_t)merge_threshold_sz;
 }
 
+void args_set_perf_counters(struct alsa_conformance_args *args, int flag)
+{
+	args->perf_counters = flag;
+}
@@ -56,6 +56,9 @@ double args_get_merge_threshold(const struct alsa_conformance_args *args);
 /* Return merge threshold size. */
 snd_pcm_sframes_t args_get_merge_threshold_sz(const struct alsa_conformance_args *args);
 
+/* Return whether perf counters are collected. */
+int args_get_perf_counters(const struct alsa_conformance_args *args);
+
 /* Set playback device name. */
 void args_set_playback_dev_name(struct alsa_conformance_args *args,
 				const char *name);
@@ -102,4 +105,7 @@ void args_set_merge_threshold(struct alsa_conformance_args *args,
 void args_set_merge_threshold_sz(struct alsa_conformance_args *args,
 				 int merge_threshold_sz);
 
+/* Set perf counters flag of argument. */
+void args_set_perf_counters(struct alsa_conformance_args *args, int flag);
+
 #endif /* INCLUDE_ALSA_CONFORMANCE_ARGS_H_ */
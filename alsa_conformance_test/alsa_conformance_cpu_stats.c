@@ -0,0 +1,307 @@
+/*
+ * Copyright 2019 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "alsa_conformance_cpu_stats.h"
+#include "alsa_conformance_timer.h"
+
+enum PERF_COUNTER {
+	PERF_CYCLES = 0,
+	PERF_INSTRUCTIONS,
+	PERF_CONTEXT_SWITCHES,
+	PERF_MIGRATIONS,
+	PERF_COUNTER_COUNT /* Keep it in the last line to count total amounts. */
+};
+
+static const struct {
+	const char *name;
+	uint32_t type;
+	uint64_t config;
+} perf_counter_info[PERF_COUNTER_COUNT] = {
+	{ "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+	{ "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+	{ "context switches", PERF_TYPE_SOFTWARE,
+	  PERF_COUNT_SW_CONTEXT_SWITCHES },
+	{ "cpu migrations", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS },
+};
+
+/* Values read from /proc/thread-self/schedstat. */
+struct schedstat {
+	unsigned long long run_ns; /* Time spent on the cpu. */
+	unsigned long long wait_ns; /* Time spent waiting on a runqueue. */
+	unsigned long long timeslices; /* Number of timeslices run. */
+};
+
+struct alsa_conformance_cpu_stats {
+	int use_perf;
+	int is_running;
+	unsigned long runs;
+
+	/* Snapshots taken by cpu_stats_start. */
+	struct timespec start_time;
+	struct rusage start_usage;
+	struct schedstat start_sched;
+	int perf_fd[PERF_COUNTER_COUNT];
+
+	/* Accumulated differences of all runs. */
+	struct timespec wall_time;
+	struct timespec user_time;
+	struct timespec system_time;
+	long voluntary_switches;
+	long involuntary_switches;
+	long minor_faults;
+	long major_faults;
+	int has_schedstat;
+	struct schedstat sched;
+	int has_perf[PERF_COUNTER_COUNT];
+	unsigned long long perf_value[PERF_COUNTER_COUNT];
+};
+
+static int read_schedstat(struct schedstat *sched)
+{
+	FILE *fp;
+	int rc;
+
+	fp = fopen("/proc/thread-self/schedstat", "r");
+	if (!fp)
+		return -1;
+	rc = fscanf(fp, "%llu %llu %llu", &sched->run_ns, &sched->wait_ns,
+		    &sched->timeslices);
+	fclose(fp);
+	return rc == 3 ? 0 : -1;
+}
+
+static int perf_open(enum PERF_COUNTER id)
+{
+	struct perf_event_attr attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = perf_counter_info[id].type;
+	attr.config = perf_counter_info[id].config;
+	attr.disabled = 1;
+	attr.exclude_hv = 1;
+
+	/* pid = 0 and cpu = -1 measure the calling thread on any cpu. */
+	return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static void timeval_to_timespec(const struct timeval *tv, struct timespec *ts)
+{
+	ts->tv_sec = tv->tv_sec;
+	ts->tv_nsec = tv->tv_usec * 1000L;
+}
+
+/* Accumulates (end - start) into total. */
+static void accumulate_timeval(struct timespec *total,
+			       const struct timeval *start,
+			       const struct timeval *end)
+{
+	struct timespec start_ts;
+	struct timespec end_ts;
+
+	timeval_to_timespec(start, &start_ts);
+	timeval_to_timespec(end, &end_ts);
+	subtract_timespec(&end_ts, &start_ts);
+	add_timespec(total, &end_ts);
+}
+
+struct alsa_conformance_cpu_stats *cpu_stats_create()
+{
+	struct alsa_conformance_cpu_stats *stats;
+	int i;
+
+	stats = (struct alsa_conformance_cpu_stats *)malloc(
+		sizeof(struct alsa_conformance_cpu_stats));
+	if (!stats) {
+		perror("malloc (alsa_conformance_cpu_stats)");
+		exit(EXIT_FAILURE);
+	}
+	memset(stats, 0, sizeof(*stats));
+	stats->has_schedstat = true;
+	for (i = 0; i < PERF_COUNTER_COUNT; i++)
+		stats->perf_fd[i] = -1;
+	return stats;
+}
+
+void cpu_stats_destroy(struct alsa_conformance_cpu_stats *stats)
+{
+	int i;
+
+	for (i = 0; i < PERF_COUNTER_COUNT; i++) {
+		if (stats->perf_fd[i] >= 0)
+			close(stats->perf_fd[i]);
+	}
+	free(stats);
+}
+
+void cpu_stats_set_perf(struct alsa_conformance_cpu_stats *stats, int enable)
+{
+	int i;
+
+	assert(!stats->is_running);
+	stats->use_perf = enable;
+	for (i = 0; i < PERF_COUNTER_COUNT; i++)
+		stats->has_perf[i] = enable;
+}
+
+void cpu_stats_start(struct alsa_conformance_cpu_stats *stats)
+{
+	int i;
+
+	assert(!stats->is_running);
+	stats->is_running = 1;
+
+	/*
+	 * Perf counters are bound to the thread which opens them, so they are
+	 * opened here instead of in cpu_stats_create.
+	 */
+	for (i = 0; i < PERF_COUNTER_COUNT; i++) {
+		if (!stats->has_perf[i])
+			continue;
+		stats->perf_fd[i] = perf_open(i);
+		if (stats->perf_fd[i] < 0) {
+			fprintf(stderr, "perf_event_open (%s): %s\n",
+				perf_counter_info[i].name, strerror(errno));
+			stats->has_perf[i] = false;
+			continue;
+		}
+		ioctl(stats->perf_fd[i], PERF_EVENT_IOC_RESET, 0);
+		ioctl(stats->perf_fd[i], PERF_EVENT_IOC_ENABLE, 0);
+	}
+
+	if (stats->has_schedstat && read_schedstat(&stats->start_sched) < 0)
+		stats->has_schedstat = false;
+
+	if (getrusage(RUSAGE_THREAD, &stats->start_usage) < 0) {
+		perror("getrusage");
+		exit(EXIT_FAILURE);
+	}
+	clock_gettime(CLOCK_MONOTONIC_RAW, &stats->start_time);
+}
+
+void cpu_stats_stop(struct alsa_conformance_cpu_stats *stats)
+{
+	struct timespec end_time;
+	struct rusage end_usage;
+	struct schedstat end_sched;
+	uint64_t value;
+	int i;
+
+	clock_gettime(CLOCK_MONOTONIC_RAW, &end_time);
+	if (getrusage(RUSAGE_THREAD, &end_usage) < 0) {
+		perror("getrusage");
+		exit(EXIT_FAILURE);
+	}
+
+	assert(stats->is_running);
+	stats->is_running = 0;
+	stats->runs++;
+
+	subtract_timespec(&end_time, &stats->start_time);
+	add_timespec(&stats->wall_time, &end_time);
+	accumulate_timeval(&stats->user_time, &stats->start_usage.ru_utime,
+			   &end_usage.ru_utime);
+	accumulate_timeval(&stats->system_time, &stats->start_usage.ru_stime,
+			   &end_usage.ru_stime);
+	stats->voluntary_switches +=
+		end_usage.ru_nvcsw - stats->start_usage.ru_nvcsw;
+	stats->involuntary_switches +=
+		end_usage.ru_nivcsw - stats->start_usage.ru_nivcsw;
+	stats->minor_faults +=
+		end_usage.ru_minflt - stats->start_usage.ru_minflt;
+	stats->major_faults +=
+		end_usage.ru_majflt - stats->start_usage.ru_majflt;
+
+	if (stats->has_schedstat) {
+		if (read_schedstat(&end_sched) < 0) {
+			stats->has_schedstat = false;
+		} else {
+			stats->sched.run_ns +=
+				end_sched.run_ns - stats->start_sched.run_ns;
+			stats->sched.wait_ns +=
+				end_sched.wait_ns - stats->start_sched.wait_ns;
+			stats->sched.timeslices += end_sched.timeslices -
+						   stats->start_sched.timeslices;
+		}
+	}
+
+	for (i = 0; i < PERF_COUNTER_COUNT; i++) {
+		if (stats->perf_fd[i] < 0)
+			continue;
+		ioctl(stats->perf_fd[i], PERF_EVENT_IOC_DISABLE, 0);
+		if (read(stats->perf_fd[i], &value, sizeof(value)) ==
+		    sizeof(value))
+			stats->perf_value[i] += value;
+		else
+			stats->has_perf[i] = false;
+		close(stats->perf_fd[i]);
+		stats->perf_fd[i] = -1;
+	}
+}
+
+double cpu_stats_get_wall_time(const struct alsa_conformance_cpu_stats *stats)
+{
+	return timespec_to_s(&stats->wall_time);
+}
+
+void cpu_stats_print_result(const struct alsa_conformance_cpu_stats *stats)
+{
+	double wall_time;
+	double cpu_time;
+	int i;
+
+	wall_time = timespec_to_s(&stats->wall_time);
+	cpu_time = timespec_to_s(&stats->user_time) +
+		   timespec_to_s(&stats->system_time);
+
+	printf("measured runs: %lu\n", stats->runs);
+	printf("wall time: %lf\n", wall_time);
+	printf("user time: %lf\n", timespec_to_s(&stats->user_time));
+	printf("system time: %lf\n", timespec_to_s(&stats->system_time));
+	printf("cpu utilization: %lf\n",
+	       wall_time > 0 ? cpu_time / wall_time : 0);
+	printf("voluntary context switches: %ld\n", stats->voluntary_switches);
+	printf("involuntary context switches: %ld\n",
+	       stats->involuntary_switches);
+	printf("page faults (minor/major): %ld/%ld\n", stats->minor_faults,
+	       stats->major_faults);
+
+	if (stats->has_schedstat) {
+		printf("schedstat run time: %lf\n", stats->sched.run_ns / 1e9);
+		printf("schedstat wait time: %lf\n",
+		       stats->sched.wait_ns / 1e9);
+		printf("schedstat timeslices: %llu\n", stats->sched.timeslices);
+	} else {
+		puts("schedstat: unavailable");
+	}
+
+	if (!stats->use_perf)
+		return;
+	for (i = 0; i < PERF_COUNTER_COUNT; i++) {
+		if (stats->has_perf[i])
+			printf("perf %s: %llu\n", perf_counter_info[i].name,
+			       stats->perf_value[i]);
+		else
+			printf("perf %s: unavailable\n",
+			       perf_counter_info[i].name);
+	}
+}
@@ -0,0 +1,36 @@
+/*
+ * Copyright 2019 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#ifndef INCLUDE_ALSA_CONFORMANCE_CPU_STATS_H_
+#define INCLUDE_ALSA_CONFORMANCE_CPU_STATS_H_
+
+struct alsa_conformance_cpu_stats;
+
+/* Creates and initializes a new cpu stats object. */
+struct alsa_conformance_cpu_stats *cpu_stats_create();
+
+/* Destroys cpu stats object. */
+void cpu_stats_destroy(struct alsa_conformance_cpu_stats *stats);
+
+/* Enables collecting cycles, instructions, context switches and migrations
+ * with perf_event_open. Counters which can't be opened are skipped. */
+void cpu_stats_set_perf(struct alsa_conformance_cpu_stats *stats, int enable);
+
+/* Samples counters of the calling thread at the start of a run. It must be
+ * called from the thread being measured. */
+void cpu_stats_start(struct alsa_conformance_cpu_stats *stats);
+
+/* Samples counters of the calling thread at the end of a run and accumulates
+ * the difference from cpu_stats_start. */
+void cpu_stats_stop(struct alsa_conformance_cpu_stats *stats);
+
+/* Returns total wall time(s) of all measured runs. */
+double cpu_stats_get_wall_time(const struct alsa_conformance_cpu_stats *stats);
+
+/* Prints cpu stats result. */
+void cpu_stats_print_result(const struct alsa_conformance_cpu_stats *stats);
+
+#endif /* INCLUDE_ALSA_CONFORMANCE_CPU_STATS_H_ */
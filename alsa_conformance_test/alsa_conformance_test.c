@@ -63,6 +63,9 @@ void show_usage(const char *name)
 	       "\t\teg: hw:0,0 PLAYBACK 2 S16_LE 48000 240 240 10 # Example\n");
 	printf("\t--merge_threshold_sz: "
 	       "Set frame merge threadhold size, auto computed if not set\n");
+	printf("\t--perf_counters: "
+	       "Collect cycles, instructions, context switches and cpu\n"
+	       "\t\tmigrations of each device thread with perf_event_open.\n");
 }
 
 void set_dev_thread_args(struct dev_thread *thread,
@@ -79,6 +82,7 @@ void set_dev_thread_args(struct dev_thread *thread,
 					 args_get_merge_threshold(args));
 	dev_thread_set_merge_threshold_size(thread,
 					 args_get_merge_threshold_sz(args));
+	dev_thread_set_perf_counters(thread, args_get_perf_counters(args));
 }
 
 struct dev_thread *create_playback_thread(struct alsa_conformance_args *args)
@@ -165,6 +169,8 @@ size_t parse_device_file(struct alsa_conformance_args *args,
 		dev_thread_set_block_size(thread, block_size);
 		dev_thread_set_duration(thread, duration);
 		dev_thread_set_iterations(thread, args_get_iterations(args));
+		dev_thread_set_perf_counters(thread,
+					     args_get_perf_counters(args));
 
 		thread_list[thread_count++] = thread;
 	}
@@ -251,7 +257,8 @@ void parse_arguments(struct alsa_conformance_args *test_args, int argc,
 		OPT_DEV_INFO_ONLY,
 		OPT_ITERATIONS,
 		OPT_MERGE_THRESHOLD,
-		OPT_MERGE_THRESHOLD_SZ
+		OPT_MERGE_THRESHOLD_SZ,
+		OPT_PERF_COUNTERS
 	};
 	int c;
 	const char *short_opt = "hP:C:c:f:r:p:B:d:D";
@@ -274,6 +281,7 @@ void parse_arguments(struct alsa_conformance_args *test_args, int argc,
 		  OPT_MERGE_THRESHOLD },
 		{ "merge_threshold_sz", required_argument, NULL,
 		  OPT_MERGE_THRESHOLD_SZ },
+		{ "perf_counters", no_argument, NULL, OPT_PERF_COUNTERS },
 		{ 0, 0, 0, 0 }
 	};
 	while (1) {
@@ -352,6 +360,10 @@ void parse_arguments(struct alsa_conformance_args *test_args, int argc,
 			args_set_merge_threshold_sz(test_args,
 						 (int)atof(optarg));
 			break;
+
+		case OPT_PERF_COUNTERS:
+			args_set_perf_counters(test_args, true);
+			break;
 		case ':':
 		case '?':
 			fprintf(stderr,
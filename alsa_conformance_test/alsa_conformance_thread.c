@@ -7,6 +7,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "alsa_conformance_cpu_stats.h"
 #include "alsa_conformance_debug.h"
 #include "alsa_conformance_helper.h"
 #include "alsa_conformance_recorder.h"
@@ -43,9 +44,12 @@ struct dev_thread {
 	snd_pcm_sframes_t merge_threshold_sz;
 	unsigned underrun_count; /* Record number of underruns during playback. */
 	unsigned overrun_count; /* Record number of overrun during capture. */
+	/* Record number of snd_pcm_avail calls during measured runs. */
+	unsigned long long avail_count;
 
 	struct alsa_conformance_timer *timer;
 	struct alsa_conformance_recorder_list *recorder_list;
+	struct alsa_conformance_cpu_stats *cpu_stats;
 };
 
 struct dev_thread *dev_thread_create()
@@ -67,8 +71,10 @@ struct dev_thread *dev_thread_create()
 	thread->dev_name = NULL;
 	thread->underrun_count = 0;
 	thread->overrun_count = 0;
+	thread->avail_count = 0;
 	thread->timer = conformance_timer_create();
 	thread->recorder_list = recorder_list_create();
+	thread->cpu_stats = cpu_stats_create();
 	thread->merge_threshold_t = 0;
 	thread->merge_threshold_sz = 0;
 
@@ -85,6 +91,7 @@ void dev_thread_destroy(struct dev_thread *thread)
 	snd_ctl_card_info_free(thread->card_info);
 	conformance_timer_destroy(thread->timer);
 	recorder_list_destroy(thread->recorder_list);
+	cpu_stats_destroy(thread->cpu_stats);
 	free(thread->dev_name);
 	free(thread);
 }
@@ -160,6 +167,11 @@ void dev_thread_set_iterations(struct dev_thread *thread, int iterations)
 	thread->iterations = iterations;
 }
 
+void dev_thread_set_perf_counters(struct dev_thread *thread, int enable)
+{
+	cpu_stats_set_perf(thread->cpu_stats, enable);
+}
+
 /* Open device and initialize params. */
 void dev_thread_open_device(struct dev_thread *thread)
 {
@@ -509,15 +521,28 @@ struct alsa_conformance_recorder *dev_thread_run_once(struct dev_thread *thread,
 						      int dryrun)
 {
 	struct alsa_conformance_recorder *recorder;
+	unsigned long long avail_count;
+
 	recorder = recorder_create(thread->merge_threshold_t,
 				   thread->merge_threshold_sz);
+
+	/* Cpu usage is only measured in runs which are added to the result. */
+	avail_count = conformance_timer_get_count(thread->timer, SND_PCM_AVAIL);
+	if (!dryrun)
+		cpu_stats_start(thread->cpu_stats);
+
 	if (thread->stream == SND_PCM_STREAM_PLAYBACK)
 		dev_thread_start_playback(thread, recorder);
 	else if (thread->stream == SND_PCM_STREAM_CAPTURE)
 		dev_thread_start_capture(thread, recorder);
 
-	if (!dryrun)
+	if (!dryrun) {
+		cpu_stats_stop(thread->cpu_stats);
+		thread->avail_count += conformance_timer_get_count(
+					       thread->timer, SND_PCM_AVAIL) -
+				       avail_count;
 		recorder_list_add_recorder(thread->recorder_list, recorder);
+	}
 	return recorder;
 }
 
@@ -600,6 +625,7 @@ void dev_thread_print_params(struct dev_thread *thread)
 
 void dev_thread_print_result(struct dev_thread *thread)
 {
+	double wall_time;
 	int i;
 	if (thread->params_record == NULL) {
 		puts("No data.");
@@ -627,4 +653,10 @@ void dev_thread_print_result(struct dev_thread *thread)
 
 	printf("number of underrun: %u\n", thread->underrun_count);
 	printf("number of overrun: %u\n", thread->overrun_count);
+
+	puts("----------CPU RESULT----------");
+	cpu_stats_print_result(thread->cpu_stats);
+	wall_time = cpu_stats_get_wall_time(thread->cpu_stats);
+	printf("snd_pcm_avail calls per second: %lf\n",
+	       wall_time > 0 ? thread->avail_count / wall_time : 0);
 }
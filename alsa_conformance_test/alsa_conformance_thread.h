@@ -53,6 +53,9 @@ void dev_thread_set_params(struct dev_thread *thread);
 /* Set iterations. */
 void dev_thread_set_iterations(struct dev_thread *thread, int iterations);
 
+/* Set whether perf counters are collected for cpu usage. */
+void dev_thread_set_perf_counters(struct dev_thread *thread, int enable);
+
 /* Run device thread with set iterations. */
 void *dev_thread_run_iterations(void *arg);
 
@@ -145,6 +145,13 @@ void conformance_timer_disable(struct alsa_conformance_timer *timer)
 	timer->enable = false;
 }
 
+unsigned long long
+conformance_timer_get_count(const struct alsa_conformance_timer *timer,
+			    enum ALSA_API id)
+{
+	return timer->api_timer[id].count_of_calls;
+}
+
 void api_print_result(enum ALSA_API id, const struct alsa_api_timer *api_timer)
 {
 	char api_name[MAX_ALSA_API_LENGTH];
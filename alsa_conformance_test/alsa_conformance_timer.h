@@ -81,6 +81,11 @@ void conformance_timer_enable(struct alsa_conformance_timer *timer);
 /* Disables timer. It will not record any data until it is enabled. */
 void conformance_timer_disable(struct alsa_conformance_timer *timer);
 
+/* Returns how many times this alsa api has been recorded. */
+unsigned long long
+conformance_timer_get_count(const struct alsa_conformance_timer *timer,
+			    enum ALSA_API id);
+
 /* Prints timer result. */
 void conformance_timer_print_result(const struct alsa_conformance_timer *timer);
 
@@ -16,6 +16,7 @@ CRAS_LIBS := $(shell $(PKG_CONFIG) --libs libcras)
 
 CC_BINARY(alsa_conformance_test/alsa_conformance_test): \
 	alsa_conformance_test/alsa_conformance_args.o \
+	alsa_conformance_test/alsa_conformance_cpu_stats.o \
 	alsa_conformance_test/alsa_conformance_helper.o \
 	alsa_conformance_test/alsa_conformance_test.o \
 	alsa_conformance_test/alsa_conformance_thread.o \
@@ -0,0 +1,16 @@
+// Copyright 2019 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef INCLUDE_ALLOCATION_COUNTER_H_
+#define INCLUDE_ALLOCATION_COUNTER_H_
+
+#include <stdint.h>
+
+// Returns the number of calls to the global operator new made by the calling
+// thread so far. Linking src/allocation_counter.o replaces the global
+// operator new and delete to count them, so the difference of two calls tells
+// whether the code in between allocates.
+uint64_t ThreadAllocationCount();
+
+#endif  // INCLUDE_ALLOCATION_COUNTER_H_
@@ -19,6 +19,7 @@
 // Alsa API forward declares.
 struct _snd_pcm;
 
+class ToneCache;
 class ToneGenerator;
 
 _snd_pcm_format SampleFormatToAlsaFormat(SampleFormat format);
@@ -177,6 +178,9 @@ class AlsaPlaybackClient {
   unsigned int latency_ms_;
   PlaybackParam pb_param_;
   std::set<int> *active_channels_;
+  // Serves the frames of |generator_| for the format and active channels given
+  // to Init().
+  std::unique_ptr<ToneCache> tone_cache_;
 
   // Our abstracted version of the connection state.
   State state_;
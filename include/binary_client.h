@@ -9,6 +9,7 @@
 
 #include <stddef.h>
 
+#include <atomic>
 #include <set>
 #include <string>
 #include <vector>
@@ -54,6 +55,10 @@ class RecordClient {
   // Puts the recorded data into block.
   void Record(void *buffer, size_t size);
 
+  // Puts the recorded data into block, or gives up and returns false once
+  // |is_stopped| is set.
+  bool Record(void *buffer, size_t size, const std::atomic<bool> *is_stopped);
+
  private:
   std::string command_;
   int child_pid_;
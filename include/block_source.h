@@ -0,0 +1,43 @@
+// Copyright 2019 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef INCLUDE_BLOCK_SOURCE_H_
+#define INCLUDE_BLOCK_SOURCE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <chrono>
+
+// Source of fixed size blocks of recorded audio for the Evaluator, either
+// captured live or read from a file.
+class BlockSource {
+ public:
+  struct Block {
+    const uint8_t *data;
+    // Increases by one for every block, starting from 1.
+    uint64_t sequence;
+    // Time when the block became available.
+    std::chrono::steady_clock::time_point timestamp;
+  };
+
+  virtual ~BlockSource() {}
+
+  virtual size_t block_size() const = 0;
+
+  // Returns the sequence of the latest block, or 0 if there is none yet.
+  virtual uint64_t latest_sequence() = 0;
+
+  // Returns the number of blocks replaced before being acquired.
+  virtual uint64_t dropped_blocks() = 0;
+
+  // Returns a block newer than |sequence|, or NULL if the source has no more
+  // blocks. The block stays valid until it is passed to Release().
+  virtual const Block *Acquire(uint64_t sequence) = 0;
+
+  // Gives the block returned by Acquire() back to the source.
+  virtual void Release(const Block *block) = 0;
+};
+
+#endif  // INCLUDE_BLOCK_SOURCE_H_
@@ -0,0 +1,79 @@
+// Copyright 2019 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef INCLUDE_CAPTURE_THREAD_H_
+#define INCLUDE_CAPTURE_THREAD_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "include/binary_client.h"
+#include "include/block_source.h"
+
+// Thread that keeps reading blocks from a RecordClient so the recorder pipe
+// never backs up while the captured audio is being evaluated.
+//
+// Blocks come from a pool of three: one is being filled, one holds the
+// freshest captured audio and one may be held by the consumer. A new block
+// replaces the freshest one, so a slow consumer skips old audio instead of
+// stalling the recorder.
+//
+// The timestamp of a block is the time when its last byte was read.
+class CaptureThread : public BlockSource {
+ public:
+  CaptureThread(size_t block_size, RecordClient *recorder);
+  ~CaptureThread();
+
+  size_t block_size() const override { return block_size_; }
+
+  // Starts capturing in a new thread.
+  void Start();
+
+  // Stops capturing. The block being read is discarded.
+  void Stop();
+
+  uint64_t latest_sequence() override;
+  uint64_t dropped_blocks() override;
+
+  // Waits for a block newer than |sequence| and returns the freshest one. The
+  // block is not reused until it is passed to Release().
+  const Block *Acquire(uint64_t sequence) override;
+
+  void Release(const Block *block) override;
+
+ private:
+  static const int kNumBlocks = 3;
+
+  enum BlockState {
+    kFree,
+    kFilling,
+    kReady,
+    kHeld,
+  };
+
+  void Run();
+
+  size_t block_size_;
+  RecordClient *recorder_;
+  std::unique_ptr<uint8_t[]> buffers_[kNumBlocks];
+  Block blocks_[kNumBlocks];
+  BlockState states_[kNumBlocks];
+  // Index of the freshest block which is not acquired yet, or -1.
+  int ready_;
+  uint64_t latest_sequence_;
+  uint64_t dropped_blocks_;
+  std::atomic<bool> is_stopped_;
+  std::mutex mutex_;
+  std::condition_variable block_ready_;
+  std::thread thread_;
+};
+
+#endif  // INCLUDE_CAPTURE_THREAD_H_
@@ -10,12 +10,17 @@
 #include <string>
 
 #include "include/sample_format.h"
+#include "include/window.h"
 
 struct TestConfig {
   enum TestType {
     kInvalid,
     kASharpMinorScale,
     kSingleTone,
+    kSweep,
+    kWhiteNoise,
+    kPinkNoise,
+    kMls,
   };
 
   TestConfig()
@@ -24,6 +29,9 @@ struct TestConfig {
         format(SampleFormat::kPcmS16),
         tone_length_sec(0.3f),
         frequency(440.0f),  // Middle-A
+        min_frequency(20.0),
+        max_frequency(20000.0),
+        seed(0),
         sample_rate(44100),
         start_volume(1.0f),
         end_volume(1.0f),
@@ -35,6 +43,11 @@ struct TestConfig {
   SampleFormat format;
   double tone_length_sec;
   double frequency;
+  // Range of a sweep.
+  double min_frequency;
+  double max_frequency;
+  // Seed of noise and MLS signals.
+  unsigned seed;
   int sample_rate;
   double start_volume;  // TODO(ajwong): Figure out units, and use this value.
   double end_volume;
@@ -50,6 +63,7 @@ struct AudioFunTestConfig {
         confidence_threshold(3),
         sample_rate(64000),
         sample_format(SampleFormat::kPcmS16),
+        dither(false),
         num_mic_channels(2),
         num_speaker_channels(2),
         test_rounds(10),
@@ -57,6 +71,16 @@ struct AudioFunTestConfig {
         volume_gain(50),
         min_frequency(4000),
         max_frequency(10000),
+        num_carriers(1),
+        channel_matrix(false),
+        window(WindowFunction::kRectangular),
+        hop_size(0),
+        single_precision(false),
+        distortion(false),
+        glitches(false),
+        pilot_frequency(0.0),
+        spectrogram_decimation(1),
+        seed(0),
         verbose(false) {}
 
   std::set<int> active_speaker_channels;
@@ -71,6 +95,8 @@ struct AudioFunTestConfig {
   std::string recorder_fifo;
   int sample_rate;
   SampleFormat sample_format;
+  // Adds TPDF dither of +-1 LSB to the played integer samples.
+  bool dither;
   int num_mic_channels;
   int num_speaker_channels;
   int test_rounds;
@@ -78,6 +104,38 @@ struct AudioFunTestConfig {
   int volume_gain;
   int min_frequency;
   int max_frequency;
+  int num_carriers;
+  bool channel_matrix;
+  WindowFunction window;
+  // Frames between the starts of two consecutive FFT frames. 0 means
+  // fft_size, i.e. no overlap.
+  int hop_size;
+  // Analyzes the recorded audio in float instead of double.
+  bool single_precision;
+  // Measures the distortion and noise of each carrier from the full spectrum
+  // of every trial, and the noise floor before the first round.
+  bool distortion;
+  // Looks for dropped, repeated or corrupted samples in the carriers of the
+  // blocks evaluated in each round.
+  bool glitches;
+  // Recorded audio to evaluate instead of playing and recording.
+  std::string input_file;
+  // Carriers of each round, read with input_file and written otherwise.
+  std::string rounds_file;
+  // Broadband signal to play once instead of the carrier rounds, one of
+  // sweep, white, pink or mls. Everything recorded meanwhile is written to
+  // capture_file.
+  std::string stimulus;
+  std::string capture_file;
+  // Frequency of a pilot tone to play instead of the carrier rounds, whose
+  // phase is tracked to measure the clock drift. 0 means no pilot.
+  double pilot_frequency;
+  // Spectrogram of the recorded blocks, written while they are recorded, and
+  // the number of FFT frames averaged into a row of it.
+  std::string spectrogram_file;
+  int spectrogram_decimation;
+  // Seed of noise and MLS stimuli.
+  unsigned seed;
   bool verbose;
 };
 
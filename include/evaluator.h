@@ -11,37 +11,167 @@
 #include <set>
 #include <vector>
 
-#include "include/binary_client.h"
+#include "include/block_source.h"
 #include "include/common.h"
+#include "include/glitch_detector.h"
 #include "include/sample_format.h"
+#include "include/spectrogram.h"
+#include "include/spectrum_analyzer.h"
 
 class Evaluator {
  public:
+  // Highest harmonic summed into the THD.
+  static const int kMaxHarmonic = 5;
+  // Trials of silence averaged into the noise floor by MeasureNoise().
+  static const int kNoiseTrials = 4;
+
+  // Distortion and noise of a carrier in a channel, in dB.
+  struct Distortion {
+    // Power of harmonics 2 ~ kMaxHarmonic relative to the fundamental.
+    double thd_db;
+    // Power outside the match windows of all carriers relative to the
+    // fundamental, which is what a notch filter on the carriers leaves.
+    double thd_n_db;
+    // Power of the fundamental relative to the noise floor measured by
+    // MeasureNoise(), or NAN if it was not measured.
+    double snr_db;
+  };
+
   explicit Evaluator(const AudioFunTestConfig &);
 
-  // Evaluates the recorded wave and compared with the expected bin.
-  // Saves the result in the vector that indicates the successness of each mic
-  // channels.
-  void Evaluate(int center_bin,
-                RecordClient *recorder,
-                std::vector<bool> *result);
+  // Evaluates the recorded wave and compared with the expected bins, one for
+  // each carrier played at the same time. All carriers are evaluated from the
+  // same transform.
+  // Each trial evaluates a windowed frame of the last fft_size recorded
+  // frames, and frames of consecutive trials are hop_size apart.
+  // Only blocks after the latest one of |source| at the call are evaluated,
+  // and each trial uses the freshest one. The evaluation ends early if the
+  // source runs out of blocks.
+  // Saves the result in the vectors that indicate the successness of each mic
+  // channels, one vector for each carrier.
+  // Trials reuse the buffers allocated in the constructor, so the trial loop
+  // does not allocate memory. At most num_carriers carriers are evaluated.
+  void Evaluate(const std::vector<int> &center_bins,
+                BlockSource *source,
+                std::vector<std::vector<bool> > *results);
+
+  // Returns the sequence of the latest block of the source at the start of
+  // the last Evaluate(). The evaluated audio starts right after that block.
+  uint64_t start_sequence() const { return start_sequence_; }
+
+  // Returns seconds from the start of the last Evaluate() until the capture of
+  // the block on which it made the decision.
+  double decision_time() const { return decision_time_; }
+
+  // Returns seconds of audio captured from the start of the last Evaluate()
+  // until the decision, including skipped blocks.
+  double decision_audio_time() const { return decision_audio_time_; }
+
+  // Measures the noise floor of each channel over kNoiseTrials trials of
+  // |source|, which must be recording silence. config.distortion must be set.
+  void MeasureNoise(BlockSource *source);
+
+  // Returns the distortion of |carrier| in |channel| in the last trial of the
+  // last Evaluate(). Harmonics, the match windows and the noise are summed
+  // over the bins of the full spectrum, excluding the match window around DC.
+  // config.distortion must be set.
+  Distortion distortion(int carrier, int channel) const;
+
+  // Returns the glitches found in the blocks of the last Evaluate(), up to
+  // the decision. Their frames count from the start of the evaluated audio.
+  // config.glitches must be set.
+  const GlitchDetector &glitch_detector() const { return *glitch_detector_; }
+
+  // Makes Evaluate() write every evaluated block into |spectrogram| at its
+  // frame of the recording, or no block if NULL. The spectrogram is not
+  // owned.
+  void set_spectrogram(Spectrogram *spectrogram) { spectrogram_ = spectrogram; }
+
+  // Returns the mean power of the center bin of |carrier| in |channel| over
+  // all trials of the last Evaluate(), normalized like the match window.
+  double carrier_power(int carrier, int channel) const {
+    return carrier_power_[carrier * num_channels_ + channel];
+  }
+
+  // Returns the confidence of |carrier| in |channel| accumulated by the last
+  // Evaluate(), which stops growing once it reaches the threshold.
+  double confidence(int carrier, int channel) const {
+    return confidence_[carrier * num_channels_ + channel];
+  }
 
  private:
-  // Returns the matched filter confidence the single channel.
-  double EstimateChannel(std::vector<double> *data, int center_bin);
+  // Returns the matched filter confidence of a carrier in the single channel.
+  double EstimateChannel(int carrier, int channel);
 
+  // Measures the distortion of the carriers from the transform of the
+  // current trial.
+  void MeasureDistortion(const std::vector<int> &center_bins);
+  // Returns the power of |channel| in the match window around |center_bin|,
+  // clipped to the bins summed by TotalPower(), from spectrum_power_.
+  // |center_bin| must be folded into bins 0 ~ fft_size / 2.
+  double WindowPower(int center_bin, int channel) const;
+  // Returns the power of |channel| in all bins above the match window around
+  // DC from spectrum_power_.
+  double TotalPower(int channel) const;
+
+  // Unpacks the captured blocks and transforms them in the precision chosen
+  // by the config.
+  std::unique_ptr<SpectrumAnalyzer> analyzer_;
+  int hop_size_;
+  // Power of each bin in the match windows. Bin b of carrier k of channel c
+  // is at (k * match_window_size + b) * num_channels_ + c.
+  std::vector<double> power_;
+  // Normalizes the power of a bin. It also compensates the coherent gain of
+  // the window.
+  double power_scale_;
+  // Expected power of the bins in the match window for a tone on the center
+  // bin, relative to the center bin.
+  std::vector<double> expected_power_;
   std::vector<double> filter_;
   int half_window_size_;
   int num_channels_;
   std::set<int> active_mic_channels_;
-  SampleFormat format_;
   int sample_rate_;
   std::vector<double> bin_;
-  std::unique_ptr<uint8_t[]> buffer_;
-  size_t buf_size_;
+  // Mean power of each carrier in each channel. Carrier k of channel c is at
+  // k * num_channels_ + c.
+  std::vector<double> carrier_power_;
+  // Accumulated confidence of each carrier in each channel, laid out like
+  // carrier_power_.
+  std::vector<double> confidence_;
+
+  bool distortion_;
+  int fft_size_;
+  // Power spectrum of the current trial, laid out by
+  // SpectrumAnalyzer::PowerSpectrum().
+  std::vector<double> spectrum_power_;
+  // Power of the match window of each carrier and of its harmonics in each
+  // channel in the last trial, laid out like carrier_power_.
+  std::vector<double> fundamental_power_;
+  std::vector<double> harmonic_power_;
+  // Folded center bins of the windows summed for a carrier by
+  // MeasureDistortion().
+  std::vector<int> counted_bins_;
+  // Power outside the match windows of the carriers in each channel in the
+  // last trial.
+  std::vector<double> residual_power_;
+  // Mean power of each channel measured by MeasureNoise(), and the number of
+  // trials it was averaged over.
+  std::vector<double> noise_power_;
+  int noise_trials_;
+
+  // Checks every evaluated block for glitches of the carriers, if
+  // config.glitches is set.
+  std::unique_ptr<GlitchDetector> glitch_detector_;
+  // Frequencies of the carriers of the current Evaluate().
+  std::vector<double> frequencies_;
+  Spectrogram *spectrogram_;
 
   double confidence_threshold_;
   int max_trial_;
+  uint64_t start_sequence_;
+  double decision_time_;
+  double decision_audio_time_;
 
   bool verbose_;
 };
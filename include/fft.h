@@ -0,0 +1,81 @@
+// Copyright 2019 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef INCLUDE_FFT_H_
+#define INCLUDE_FFT_H_
+
+#include <vector>
+
+// Fast fourier transform of real input.
+//
+// A |size| points real sequence is packed into a |size| / 2 points complex
+// sequence (even samples as real part, odd samples as imaginary part), which
+// is transformed with an iterative radix-2 FFT and then split into the
+// spectrum of the original sequence. The bit-reversal permutation and all
+// twiddle factors are computed once in the constructor, so an instance should
+// be kept for as long as the transform size does not change.
+//
+// |T| is the floating point type of samples, twiddle factors and the result.
+// float halves the memory traffic and doubles the SIMD width of double.
+template <typename T>
+class BasicRealFFT {
+ public:
+  // |size| must be a power of 2 and at least 2.
+  explicit BasicRealFFT(int size);
+
+  int size() const { return size_; }
+
+  // Number of values written by Transform().
+  int output_size() const { return size_ + 2; }
+
+  // Transforms |size| real samples in |input|. Bins 0 ~ size / 2 are written
+  // into |output| as interleaved (real, imaginary) pairs. The result equals
+  // to the forward DFT X[k] = sum(x[n] * exp(-2 * pi * i * k * n / size)).
+  void Transform(const T *input, T *output);
+
+  // Transforms |batch| sequences of |size| real samples together. |input| is
+  // laid out as |size| points of |batch| samples, i.e. sample n of sequence c
+  // is input[n * batch + c], which is how interleaved frames are stored.
+  // Bin k of sequence c is written into output[2 * k * batch + c] (real) and
+  // output[(2 * k + 1) * batch + c] (imaginary), so |output| must hold
+  // output_size() * batch values.
+  void TransformBatch(const T *input, int batch, T *output);
+
+  // Inverse of Transform(). Bins 0 ~ size / 2 in |input|, interleaved like
+  // the output of Transform(), are transformed into |size| real samples
+  // x[n] = sum(X[k] * exp(2 * pi * i * k * n / size)) / size, bins above
+  // size / 2 being the conjugates of the bins below. The imaginary parts of
+  // bins 0 and size / 2 are ignored.
+  void InverseTransform(const T *input, T *output);
+
+  // Allocates the working buffer of TransformBatch() for |batch| sequences up
+  // front, so that no transform allocates memory afterwards.
+  void Reserve(int batch);
+
+ private:
+  // Implements TransformBatch(). |kLanes| is the batch size known at compile
+  // time, or 0 to use |batch|.
+  template <int kLanes>
+  void TransformLanes(const T *input, int batch, T *output);
+  // Runs the butterflies of the half size complex FFT over the points in the
+  // working buffer, which must be in bit-reversed order.
+  template <int kLanes>
+  void Butterflies(int batch);
+
+  int size_;
+  int half_size_;
+  // Bit-reversed index of each point of the half size complex FFT.
+  std::vector<int> bit_reverse_;
+  // exp(-2 * pi * i * k / half_size) for k in [0, half_size / 2), interleaved.
+  std::vector<T> twiddle_;
+  // exp(-2 * pi * i * k / size) for k in [0, half_size], interleaved.
+  std::vector<T> split_twiddle_;
+  // Working buffer of the half size complex FFTs. Each point holds the real
+  // parts of all sequences followed by their imaginary parts.
+  std::vector<T> work_;
+};
+
+typedef BasicRealFFT<double> RealFFT;
+
+#endif  // INCLUDE_FFT_H_
@@ -0,0 +1,76 @@
+// Copyright 2019 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef INCLUDE_FILE_SOURCE_H_
+#define INCLUDE_FILE_SOURCE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "include/block_source.h"
+#include "include/sample_format.h"
+
+// Recorded audio mapped into memory from a WAV or raw PCM file.
+class AudioFile {
+ public:
+  AudioFile();
+  ~AudioFile();
+
+  // Maps the file at |path|. The format, rate and channels of a file starting
+  // with a RIFF/WAVE header are read from the header. Any other file is raw
+  // interleaved PCM with the given |format|, |sample_rate| and
+  // |num_channels|. Returns false with a message on stderr on failure.
+  bool Open(const char *path, SampleFormat format, int sample_rate,
+            int num_channels);
+
+  SampleFormat format() const { return format_; }
+  int sample_rate() const { return sample_rate_; }
+  int num_channels() const { return num_channels_; }
+  size_t frame_bytes() const { return format_.bytes() * num_channels_; }
+
+  // Returns the samples, without the header.
+  const uint8_t *data() const { return map_ + data_offset_; }
+  size_t data_size() const { return data_size_; }
+
+ private:
+  // Reads the format and locates the samples of a WAV file. Returns false
+  // if the header is not supported.
+  bool ParseWaveHeader(const char *path);
+
+  const uint8_t *map_;
+  size_t map_size_;
+  size_t data_offset_;
+  size_t data_size_;
+  SampleFormat format_;
+  int sample_rate_;
+  int num_channels_;
+};
+
+// Replays an AudioFile in blocks as fast as they are acquired. Blocks are
+// never dropped, and the source ends at the last whole block of the file.
+class FileSource : public BlockSource {
+ public:
+  FileSource(size_t block_size, const AudioFile *file);
+
+  size_t block_size() const override { return block_size_; }
+  uint64_t latest_sequence() override { return block_.sequence; }
+  uint64_t dropped_blocks() override { return 0; }
+  const Block *Acquire(uint64_t sequence) override;
+  void Release(const Block *) override {}
+
+  // Makes the next block start at |frame| of the file.
+  void Seek(uint64_t frame);
+
+  // Returns the frame where the next block starts.
+  uint64_t position() const { return offset_ / file_->frame_bytes(); }
+
+ private:
+  size_t block_size_;
+  const AudioFile *file_;
+  // Byte offset of the next block in the samples of file_.
+  size_t offset_;
+  Block block_;
+};
+
+#endif  // INCLUDE_FILE_SOURCE_H_
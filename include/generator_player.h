@@ -10,9 +10,11 @@
 #include <memory>
 #include <set>
 #include <thread>
+#include <vector>
 
 #include "include/binary_client.h"
 #include "include/sample_format.h"
+#include "include/tone_cache.h"
 #include "include/tone_generators.h"
 
 class GeneratorPlayer {
@@ -21,15 +23,20 @@ class GeneratorPlayer {
                   int num_channels,
                   const std::set<int> &active_channels,
                   SampleFormat format,
+                  bool dither,
                   PlayClient *player);
   void Play(ToneGenerator *generator);
   void Stop();
 
+  // Frames played so far, and the thread CPU time spent generating them.
+  const ToneCache &cache() const { return cache_; }
+
  private:
   size_t buf_size_;
-  int num_channels_;
-  const std::set<int> active_channels_;
-  SampleFormat format_;
+  // Dither of the played samples, used by the playing thread only.
+  TpdfDither dither_;
+  // Serves the generator frames, replaying its periods.
+  ToneCache cache_;
   PlayClient *player_;
   std::thread thread_;
   bool is_stopped_;
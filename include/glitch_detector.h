@@ -0,0 +1,98 @@
+// Copyright 2019 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef INCLUDE_GLITCH_DETECTOR_H_
+#define INCLUDE_GLITCH_DETECTOR_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "include/sample_format.h"
+
+// Finds dropped, repeated or corrupted samples in recorded tones of known
+// frequencies.
+//
+// A sine of angular frequency w satisfies the two-tap recurrence
+// x[n] = 2 * cos(w) * x[n - 1] - x[n - 2], so the residual
+// x[n] - 2 * cos(w) * x[n - 1] + x[n - 2] of a clean tone is only noise. One
+// such stage per tone cancels all the tones, and a phase discontinuity of
+// any of them leaves a spike of about its amplitude times w. The stages are
+// FIR filters over the interleaved samples of all channels, so they
+// vectorize and run at many times real time on any number of channels.
+//
+// A channel is checked only while the residual of the previous block is far
+// below its signal, so the onset and the end of a tone are not counted.
+// Spikes stand out from the residual noise of the previous block. Spikes
+// closer than a few frames are one glitch.
+class GlitchDetector {
+ public:
+  // Frames of the first glitches kept for each channel.
+  static const int kMaxGlitchFrames = 16;
+
+  // Checks blocks of |block_frames| frames of |num_channels| channels in
+  // |format|, for up to |max_tones| tones at a time.
+  GlitchDetector(int sample_rate, int num_channels, int block_frames,
+                 SampleFormat format, int max_tones);
+
+  // Starts looking for glitches of tones of |frequencies| Hz and clears the
+  // glitches found so far. Tones beyond |max_tones| are ignored, which leaves
+  // a residual too large to check. It does not allocate memory.
+  void Reset(const std::vector<double> &frequencies);
+
+  // Forgets the recorded history but keeps the glitches, e.g. when the next
+  // block does not follow the last one.
+  void Restart();
+
+  // Checks the next block of recorded frames in |data|, whose first frame is
+  // frame |first_frame| of the recorded stream. Glitches are reported in the
+  // frames of the stream.
+  void AddFrames(const void *data, uint64_t first_frame);
+
+  // Returns the number of glitches in |channel| since the last Reset().
+  int glitch_count(int channel) const { return glitch_count_[channel]; }
+  // Returns the frames of the first kMaxGlitchFrames glitches in
+  // |channel|.
+  const std::vector<uint64_t> &glitch_frames(int channel) const {
+    return glitch_frames_[channel];
+  }
+
+ private:
+  // Updates the per-channel state from the residual of a block, starting at
+  // |first_valid| frame of the block.
+  void CheckResidual(const double *residual, int first_valid,
+                     uint64_t first_frame);
+
+  int sample_rate_;
+  int num_channels_;
+  int block_frames_;
+  SampleFormat format_;
+  // 2 * cos(w) of each tone.
+  std::vector<double> coefficients_;
+  // The last block, converted into interleaved samples.
+  std::vector<double> samples_;
+  // Input and output of the stages, swapped after each stage. Each holds 2
+  // frames of history followed by a block.
+  std::vector<double> stage_input_;
+  std::vector<double> stage_output_;
+  // Last 2 input frames of each stage.
+  std::vector<double> history_;
+  // Frames added since the last Restart(), up to the frames after which the
+  // residual only depends on recorded frames.
+  int warm_frames_;
+  // Mean power of the signal and of the residual of the last block in each
+  // channel.
+  std::vector<double> signal_power_;
+  std::vector<double> residual_power_;
+  // Per-channel scratch of CheckResidual().
+  std::vector<double> block_signal_;
+  std::vector<double> block_residual_;
+  std::vector<double> block_peak_;
+  // Frame of the last spike in each channel, or -1.
+  std::vector<int64_t> last_spike_;
+  std::vector<int> glitch_count_;
+  std::vector<std::vector<uint64_t> > glitch_frames_;
+};
+
+#endif  // INCLUDE_GLITCH_DETECTOR_H_
@@ -0,0 +1,47 @@
+// Copyright 2019 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef INCLUDE_GOERTZEL_H_
+#define INCLUDE_GOERTZEL_H_
+
+#include <vector>
+
+// Bank of Goertzel filters computing the DFT power of a few consecutive bins
+// of a real sequence. It costs O(size * num_bins), so it is cheaper than a
+// full FFT when only a narrow window of bins around the carrier is needed.
+// |T| is the floating point type of samples, filter states and the result.
+template <typename T>
+class BasicGoertzelBank {
+ public:
+  BasicGoertzelBank(int size, int num_bins);
+
+  // Returns true if computing |num_bins| bins with the bank is cheaper than a
+  // full RealFFT of |size| points.
+  static bool IsCheaperThanFFT(int size, int num_bins);
+
+  // Computes |X[k]|^2 for k in [first_bin, first_bin + num_bins) of |size|
+  // real samples in |input|, where X is the forward DFT of the input. Bins out
+  // of [0, size / 2] are mirrored like the full spectrum of real input.
+  void Transform(const T *input, int first_bin, T *power);
+
+  // Computes the same bins of |batch| sequences together. |input| is laid out
+  // as |size| points of |batch| samples like RealFFT::TransformBatch(), and
+  // the power of bin first_bin + b of sequence c is written into
+  // |power|[b * batch + c].
+  void TransformBatch(const T *input, int batch, int first_bin, T *power);
+
+ private:
+  // Recomputes filter coefficients if the bins have changed.
+  void SetFirstBin(int first_bin);
+
+  int size_;
+  int num_bins_;
+  int first_bin_;
+  // 2 * cos(2 * pi * k / size) of each bin.
+  std::vector<T> coeff_;
+};
+
+typedef BasicGoertzelBank<double> GoertzelBank;
+
+#endif  // INCLUDE_GOERTZEL_H_
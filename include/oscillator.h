@@ -0,0 +1,80 @@
+// Copyright 2019 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef INCLUDE_OSCILLATOR_H_
+#define INCLUDE_OSCILLATOR_H_
+
+#include <stdint.h>
+
+// Sine oscillator of a fixed frequency. The phase is bounded by every engine,
+// so a tone keeps its precision however long it plays.
+class Oscillator {
+ public:
+  enum Engine {
+    // Wrapped 64-bit phase accumulator evaluated with sin(). The most exact,
+    // but it costs a libm call per sample.
+    kPhaseAccumulator,
+    // Unit phasor rotated by a complex multiply per sample. Blocks are
+    // computed from a table of rotations, and the phasor is renormalized
+    // after each block, so its magnitude does not drift.
+    kQuadrature,
+    // The phase accumulator of kPhaseAccumulator looking up a sine table with
+    // linear interpolation.
+    kTableLookup,
+    kInvalid,
+  };
+
+  Oscillator();
+  explicit Oscillator(Engine engine);
+  Engine engine() const;
+  const char *to_string() const;
+
+  // Restarts the oscillator from phase 0 at |frequency| Hz.
+  void Reset(double frequency, int sample_rate);
+
+  // Changes the frequency without resetting the phase.
+  void SetFrequency(double frequency);
+
+  // Current phase in cycles, in [0, 1).
+  double phase() const;
+
+  // Returns sin(2 * pi * phase) and advances the phase by one sample.
+  double Next();
+
+  // Writes the next |count| samples into |output|, like calling Next()
+  // |count| times.
+  void Generate(int count, double *output);
+
+  // Advances the phase by |count| samples without generating them.
+  void Skip(long long count);
+
+ private:
+  // Number of samples of a quadrature block.
+  static const int kBlockSize = 16;
+
+  void GenerateQuadrature(int count, double *output);
+  // Scales the phasor of kQuadrature back to magnitude 1.
+  void Renormalize();
+  void GenerateTable(int count, double *output);
+
+  Engine engine_;
+  int sample_rate_;
+  // Phase of kPhaseAccumulator and kTableLookup, 2^64 being a cycle, and its
+  // increment per sample. The unsigned overflow wraps the phase.
+  uint64_t phase_;
+  uint64_t increment_;
+  // Phasor of kQuadrature, whose imaginary part is the output.
+  double real_;
+  double imag_;
+  // Rotation of one sample.
+  double rotate_real_;
+  double rotate_imag_;
+  // Rotations of 0 ~ kBlockSize - 1 samples, and of a whole block.
+  double block_real_[kBlockSize];
+  double block_imag_[kBlockSize];
+  double step_real_;
+  double step_imag_;
+};
+
+#endif  // INCLUDE_OSCILLATOR_H_
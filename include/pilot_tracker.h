@@ -0,0 +1,101 @@
+// Copyright 2019 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef INCLUDE_PILOT_TRACKER_H_
+#define INCLUDE_PILOT_TRACKER_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "include/sample_format.h"
+
+// Tracks the phase of a recorded pilot tone to measure the drift between the
+// playback and the capture clocks.
+//
+// Each block is demodulated against the nominal pilot frequency: the
+// Hann windowed frames are multiplied by exp(-j * w * n) of their frame n in
+// the recording and summed, which leaves one phasor per block and channel.
+// A pilot played by a clock that runs fast by r relative to the capture clock
+// is recorded at (1 + r) times its frequency, so its unwrapped phase grows by
+// r * w per frame. A line fitted to the phase over time gives r, and the
+// residual phase about the line is the jitter of the estimate. The fit is
+// updated with each block, so the recording is never stored.
+//
+// The pilot should lie many bins of the block length above DC, so the window
+// keeps its negative frequency image out of the phasor.
+class PilotTracker {
+ public:
+  // Tracks a pilot of |frequency| Hz in blocks of |block_frames| frames of
+  // |num_channels| channels in |format|.
+  PilotTracker(int sample_rate, int num_channels, int block_frames,
+               SampleFormat format, double frequency);
+
+  // Clears the estimates of all channels.
+  void Reset();
+
+  // Demodulates the next block of recorded frames in |data|, whose first frame
+  // is frame |first_frame| of the recording. Blocks need not be contiguous.
+  void AddFrames(const void *data, uint64_t first_frame);
+
+  // Returns the number of blocks in which the pilot was found in |channel|.
+  int num_blocks(int channel) const { return fits_[channel].count; }
+
+  // Returns the amplitude of the pilot in |channel| in the last block in
+  // which it was found, relative to full scale.
+  double amplitude(int channel) const { return amplitude_[channel]; }
+
+  // Returns the rate of the playback clock relative to the capture clock in
+  // |channel| minus 1, in ppm, or NAN before 3 blocks.
+  double drift_ppm(int channel) const;
+
+  // Returns the RMS deviation of the phase of the blocks from the fitted
+  // line in |channel|, in seconds of the pilot, or NAN before 3 blocks.
+  double jitter_sec(int channel) const;
+
+ private:
+  // Online least squares fit of the phase against the time of the blocks.
+  // The co-moments are updated around the running means, which keeps them
+  // exact over long recordings.
+  struct Fit {
+    int count;
+    double mean_time;
+    double mean_phase;
+    double time_time;
+    double time_phase;
+    double phase_phase;
+    // Unwrapped phase of the last block.
+    double phase;
+  };
+
+  // Adds the phase of a block centered at |time| seconds to |fit|.
+  static void AddPhase(double time, double phase, Fit *fit);
+
+  int sample_rate_;
+  int num_channels_;
+  int block_frames_;
+  SampleFormat format_;
+  double frequency_;
+  // Phase increment of a frame, 2^64 being a cycle. The unsigned overflow of
+  // the phase of a frame wraps it exactly, however long the recording.
+  uint64_t increment_;
+  // Hann window times cos(w * i) and sin(w * i) of frame i of a block.
+  std::vector<double> cosine_;
+  std::vector<double> sine_;
+  // Sum of the window, the gain of a unit phasor, and of its square, the gain
+  // of the power of a block.
+  double window_sum_;
+  double window_square_sum_;
+  // The last block, converted into interleaved samples.
+  std::vector<double> samples_;
+  // Real and imaginary sums and the windowed power of each channel in a
+  // block.
+  std::vector<double> real_;
+  std::vector<double> imag_;
+  std::vector<double> power_;
+  std::vector<double> amplitude_;
+  std::vector<Fit> fits_;
+};
+
+#endif  // INCLUDE_PILOT_TRACKER_H_
@@ -6,6 +6,7 @@
 #define INCLUDE_SAMPLE_FORMAT_H_
 
 #include <stddef.h>
+#include <stdint.h>
 
 #include <vector>
 
@@ -14,8 +15,13 @@ class SampleFormat {
   enum Type {
     kPcmU8,
     kPcmS16,
+    // 24 bits packed in 3 bytes, S24_3LE in ALSA.
     kPcmS24,
+    // 24 bits in the lower 3 bytes of 4 bytes, S24_LE in ALSA.
+    kPcmS24In32,
     kPcmS32,
+    // 32-bit float in [-1.0, 1.0], FLOAT_LE in ALSA.
+    kPcmFloat,
     kPcmInvalid,
   };
 
@@ -24,6 +30,8 @@ class SampleFormat {
   void set_type(Type type);
   Type type() const;
   const char *to_string() const;
+  // Container size of a sample in bytes, which is the only place frame sizes
+  // should be derived from.
   size_t bytes() const;
   inline bool operator==(const SampleFormat &format) const;
 
@@ -31,12 +39,88 @@ class SampleFormat {
   Type type_;
 };
 
-// Writes sample into the buffer with the specific format.
+// Triangular (TPDF) dither of +-1 LSB for Interleave(). The noise comes from
+// a hash of a sample counter, so a sequence is reproducible from its seed.
+class TpdfDither {
+ public:
+  explicit TpdfDither(uint32_t seed = 0);
+
+  // Writes |count| noise values in (-1.0, 1.0) LSB into |noise|.
+  void Generate(int count, double *noise);
+
+ private:
+  uint32_t counter_;
+};
+
+// Uniform noise in [-1.0, 1.0) from the same counter hash as TpdfDither, for
+// test signals which must be reproducible from their seed.
+class UniformNoise {
+ public:
+  explicit UniformNoise(uint32_t seed = 0);
+
+  // Writes the next |count| noise values into |noise|.
+  void Generate(int count, double *noise);
+
+ private:
+  uint32_t counter_;
+};
+
+// Writes sample into the buffer with the specific format. The sample is
+// rounded to the nearest value and clamped to the range of the format, so
+// 1.0 writes the maximum value.
 // Returns the next position after writing.
 void *WriteSample(double sample, SampleFormat format, void *buf);
 
+// Interleaves |num_frames| frames of |num_channels| channels into |data|, the
+// reverse of Deinterleave(). Sample of channel c in frame i is
+// planes[c][i] * gains[c], rounded and clamped like WriteSample(), or stored
+// as it is for float. Channels with a NULL plane or a zero gain are written
+// as silence. If |dither| is not NULL, its noise is added to each integer
+// sample before rounding. The conversion is specialized and vectorized like
+// Deinterleave().
+// Returns the next position after writing.
+void *Interleave(const double *const *planes, const double *gains,
+                 int num_frames, int num_channels, SampleFormat format,
+                 void *data, TpdfDither *dither = NULL);
+void *Interleave(const float *const *planes, const double *gains,
+                 int num_frames, int num_channels, SampleFormat format,
+                 void *data, TpdfDither *dither = NULL);
+
+// Interleaves |num_frames| samples into all |num_channels| channels, like
+// Interleave() with every plane being |samples|. When all non-zero gains are
+// equal and there is no dither, each sample is quantized once and stored
+// into the active channels of a frame together. This is specialized for 1, 2,
+// 4, 8, 16 and 32 channels.
+// Returns the next position after writing.
+void *Broadcast(const double *samples, const double *gains, int num_frames,
+                int num_channels, SampleFormat format, void *data,
+                TpdfDither *dither = NULL);
+void *Broadcast(const float *samples, const double *gains, int num_frames,
+                int num_channels, SampleFormat format, void *data,
+                TpdfDither *dither = NULL);
+
+// Reads a sample from the buffer and normalizes it into -1.0 ~ 1.0.
+// Returns the next position after reading.
 void *ReadSample(SampleFormat format, void *data, double *sample);
 
+// Deinterleaves |num_frames| frames of |num_channels| channels in |data| into
+// planar buffers, so that sample of channel c in frame i is written into
+// planes[c][i]. Each sample is normalized into -1.0 ~ 1.0 exactly, i.e. it is
+// divided by the full scale of its format (128 for u8, 32768 for s16, ...).
+// The conversion is specialized for each format and for 1, 2, 4 and 8
+// channels, and is vectorized; planes aligned to 16 bytes work best.
+void Deinterleave(const void *data, int num_frames, SampleFormat format,
+                  int num_channels, double *const *planes);
+void Deinterleave(const void *data, int num_frames, SampleFormat format,
+                  int num_channels, float *const *planes);
+
+// Converts |num_samples| samples in |data| like Deinterleave() but keeps them
+// in the same order.
+void ConvertSamples(const void *data, int num_samples, SampleFormat format,
+                    double *output);
+void ConvertSamples(const void *data, int num_samples, SampleFormat format,
+                    float *output);
+
 // Unpack the data read from recorder.
 // The input data is a byte array with interlaced data (usually the raw data
 // obtained from recorder.).
@@ -50,5 +134,4 @@ int Unpack(void *data, size_t data_size,
            SampleFormat format, int num_channels,
            std::vector<std::vector<double> > *output);
 
-
 #endif  // INCLUDE_SAMPLE_FORMAT_H_
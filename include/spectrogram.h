@@ -0,0 +1,109 @@
+// Copyright 2019 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef INCLUDE_SPECTROGRAM_H_
+#define INCLUDE_SPECTROGRAM_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include "include/fft.h"
+#include "include/sample_format.h"
+
+// Writes the log-magnitude spectrogram of recorded blocks to disk as they
+// arrive, one file per channel.
+//
+// Each block completes a Hann windowed FFT frame of the last fft_size frames.
+// The bins are grouped into at most kMaxColumns columns, each taking the
+// power of its loudest bin so tones keep their level, and |decimation|
+// frames are averaged into a row. Only a row is kept in memory, so
+// recordings of any length can be written.
+//
+// A path ending in .pgm is written as a binary PGM image, with time going
+// down from the first row and frequency going right from DC, and levels
+// from -120 dB to 0 dB relative to a full scale sine mapped to 0 ~ 255.
+// Other paths are written as a gnuplot nonuniform matrix in dB, the first
+// row holding the column frequencies in Hz and the first column the row
+// times in seconds, to be plotted by
+//   plot 'path' nonuniform matrix with image
+class Spectrogram {
+ public:
+  // Maximum number of frequency columns of a row.
+  static const int kMaxColumns = 512;
+
+  // Transforms frames of |fft_size| frames of |num_channels| channels in
+  // |format|, from blocks of |hop_size| frames.
+  Spectrogram(int sample_rate, int num_channels, int fft_size, int hop_size,
+              SampleFormat format, int decimation);
+  ~Spectrogram();
+
+  // Creates a file of each channel in |channels|, named |path| with
+  // "_<channel>" inserted before its extension. Returns false if a file
+  // cannot be created.
+  bool Open(const std::string &path, const std::set<int> &channels);
+
+  // Adds the next block of recorded frames in |data|, whose first frame is
+  // frame |first_frame| of the recording. A block which does not follow the
+  // last one ends the current row and starts a new FFT frame.
+  void AddFrames(const void *data, uint64_t first_frame);
+
+  // Writes the last partial row and completes the files.
+  void Close();
+
+  // Returns the number of rows written.
+  uint64_t num_rows() const { return num_rows_; }
+
+ private:
+  struct Output {
+    int channel;
+    FILE *file;
+    // Offset of the height in the PGM header, which is written when the file
+    // is closed.
+    long height_offset;
+  };
+
+  // Writes the averaged row to each file, if any frame was added to it.
+  void WriteRow();
+
+  int sample_rate_;
+  int num_channels_;
+  int hop_size_;
+  SampleFormat format_;
+  int decimation_;
+  bool is_pgm_;
+  RealFFT fft_;
+  std::vector<double> window_;
+  // Scales the power of a bin to that of a full scale sine.
+  double power_scale_;
+  // Bins grouped into a column, and the number of columns.
+  int bins_per_column_;
+  int num_columns_;
+  // Ring of the last fft_size recorded frames of all channels in frame order,
+  // the position of the oldest frame in it and the number of valid frames.
+  std::vector<double> ring_;
+  int ring_pos_;
+  int filled_frames_;
+  // Frame following the last block, where the next block should start.
+  uint64_t next_frame_;
+  // Windowed FFT frame and its spectrum, laid out by RealFFT::TransformBatch().
+  std::vector<double> frame_;
+  std::vector<double> spectrum_;
+  // Summed power of each column of each channel of the current row, column j
+  // of channel c at j * num_channels + c, the number of frames summed, and
+  // the first and the end frames they span.
+  std::vector<double> row_;
+  int row_frames_;
+  uint64_t row_start_frame_;
+  uint64_t row_end_frame_;
+  uint64_t num_rows_;
+  // Pixels of a PGM row.
+  std::vector<uint8_t> pixels_;
+  std::vector<Output> outputs_;
+};
+
+#endif  // INCLUDE_SPECTROGRAM_H_
@@ -0,0 +1,56 @@
+// Copyright 2019 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef INCLUDE_SPECTRUM_ANALYZER_H_
+#define INCLUDE_SPECTRUM_ANALYZER_H_
+
+#include <memory>
+#include <vector>
+
+#include "include/common.h"
+
+// Keeps the last fft_size recorded frames of all mic channels and computes
+// the power of the bins in the match windows of the carriers from them.
+//
+// The samples, the window and the transform are kept in either double or
+// float. float halves the memory traffic and doubles the SIMD width, and its
+// 24-bit mantissa still covers 16-bit captures with plenty of margin.
+class SpectrumAnalyzer {
+ public:
+  // Creates an analyzer computing in float if config.single_precision is
+  // set, or in double otherwise.
+  static std::unique_ptr<SpectrumAnalyzer> Create(
+      const AudioFunTestConfig &config);
+
+  virtual ~SpectrumAnalyzer() {}
+
+  // Returns true if the bins are computed with Goertzel filters instead of
+  // the full FFT.
+  virtual bool use_goertzel() const = 0;
+
+  // Returns the name of the floating point type used.
+  virtual const char *precision() const = 0;
+
+  // Drops all recorded frames.
+  virtual void Reset() = 0;
+
+  // Unpacks hop_size frames in |data| in place of the oldest frames. Returns
+  // true if fft_size frames have been added since the last Reset().
+  virtual bool AddFrames(const void *data) = 0;
+
+  // Computes |X[k]|^2 of each bin in the match window of each carrier of all
+  // channels, where X is the DFT of the windowed last fft_size frames. Bin b
+  // of the window around center_bins[k] of channel c is written into
+  // power[(k * match_window_size + b) * num_mic_channels + c].
+  virtual void Transform(const std::vector<int> &center_bins,
+                         double *power) = 0;
+
+  // Computes |X[k]|^2 of bins 0 ~ fft_size / 2 of all channels, bin k of
+  // channel c being written into power[k * num_mic_channels + c]. The
+  // transform of the last Transform() is reused if no frames were added
+  // since. It is only available if config.distortion is set.
+  virtual void PowerSpectrum(double *power) = 0;
+};
+
+#endif  // INCLUDE_SPECTRUM_ANALYZER_H_
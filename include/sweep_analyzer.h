@@ -0,0 +1,87 @@
+// Copyright 2019 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef INCLUDE_SWEEP_ANALYZER_H_
+#define INCLUDE_SWEEP_ANALYZER_H_
+
+#include <memory>
+#include <vector>
+
+#include "include/fft.h"
+
+// Measures a playback to capture path from the recording of an exponential
+// sweep of SweepGenerator.
+//
+// The recording is deconvolved with the inverse of the sweep by FFT
+// convolution, which leaves the impulse response of the path. Each harmonic
+// k of a nonlinear path turns into a sweep that runs ahead by
+// L * ln(k), where L = length / ln(end / start), so its impulse response
+// lands that much before the linear one and can be cut out on its own. One
+// sweep thus gives the latency, the frequency response and the distortion
+// orders of the path.
+class SweepAnalyzer {
+ public:
+  // Highest harmonic order measured.
+  static const int kMaxHarmonic = 5;
+
+  struct Result {
+    // Delay of the peak of the impulse response from the start of the
+    // recording, in seconds.
+    double latency_sec;
+    // Center frequencies of the octave bands within the sweep, and the gain
+    // of the path averaged over each band, in dB.
+    std::vector<double> band_frequencies;
+    std::vector<double> response_db;
+    // Power of harmonic 2, 3, ... relative to the fundamental, in dB, over
+    // the fundamentals which keep the harmonic within the sweep. It ends at
+    // the first order out of range.
+    std::vector<double> harmonic_db;
+  };
+
+  // The arguments are those of the played SweepGenerator. Recordings of up to
+  // |max_frames| frames can be analyzed.
+  SweepAnalyzer(int sample_rate, double length_sec, double start_frequency,
+                double end_frequency, int volume_gain, int max_frames);
+
+  // Analyzes |num_frames| recorded samples of a channel, which start no later
+  // than the sweep. Returns false if no response is found.
+  bool Analyze(const double *recording, int num_frames, Result *result);
+
+  // Impulse response of the last Analyze(), starting from the start of the
+  // recording. Harmonic responses wrap around to its end.
+  const std::vector<double> &impulse_response() const { return response_; }
+
+ private:
+  // Writes the spectrum of fft->size() frames of the impulse response around
+  // |center| into |spectrum|. The cut starts a quarter of its size before
+  // |center|, which keeps the ringing of the band limit, and fades in and out
+  // over a sixteenth at both ends. It wraps around the response.
+  void SegmentSpectrum(RealFFT *fft, int center, std::vector<double> *spectrum);
+
+  int sample_rate_;
+  double start_frequency_;
+  double end_frequency_;
+  // Highest harmonic order within the sweep, at most kMaxHarmonic.
+  int num_harmonics_;
+  // L of the class comment in frames.
+  double rate_frames_;
+  int max_frames_;
+  // Deconvolves whole recordings, zero padded so the convolution does not
+  // wrap around.
+  RealFFT fft_;
+  // Transforms of the cut out linear response for the frequency response,
+  // and of the shorter cuts which fit between the harmonic responses.
+  std::unique_ptr<RealFFT> response_fft_;
+  std::unique_ptr<RealFFT> harmonic_fft_;
+  // Spectrum of the inverse sweep, band limited to the sweep.
+  std::vector<double> inverse_;
+  // Buffers of Analyze().
+  std::vector<double> spectrum_;
+  std::vector<double> response_;
+  std::vector<double> samples_;
+  std::vector<double> segment_;
+  std::vector<double> fundamental_;
+};
+
+#endif  // INCLUDE_SWEEP_ANALYZER_H_
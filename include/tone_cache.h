@@ -0,0 +1,72 @@
+// Copyright 2019 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef INCLUDE_TONE_CACHE_H_
+#define INCLUDE_TONE_CACHE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "include/sample_format.h"
+#include "include/tone_generators.h"
+
+// Serves the frames of a ToneGenerator, rendering repeating output only once.
+//
+// While the generator reports a period in ToneGenerator::GetPeriod(), one
+// period is generated into a buffer, and the following frames are copied out
+// of it over and over while the generator is only skipped along. A fixed
+// carrier on a bin of the analysis DFT repeats within the DFT size, so
+// steady-state playback costs a memcpy. Fades and other output without a
+// period are generated live, and so is dithered output, whose noise must not
+// repeat.
+class ToneCache {
+ public:
+  // Frames are written in |format| with |channel_gains|, dithered by
+  // |dither| if it is not NULL. The dither is not owned.
+  ToneCache(SampleFormat format, const std::vector<double> &channel_gains,
+            TpdfDither *dither = NULL);
+
+  // Forgets the cached period. It must be called before serving another
+  // generator.
+  void Reset();
+
+  // Fills |data| with up to |buf_size| bytes of frames of |generator|, like
+  // ToneGenerator::GetFrames(). Returns the number of bytes written.
+  size_t GetFrames(ToneGenerator *generator, void *data, size_t buf_size);
+
+  // Thread CPU time spent in GetFrames() so far, in seconds.
+  double cpu_seconds() const { return cpu_ns_ * 1e-9; }
+  // Number of frames served so far, and how many of them were copied from a
+  // cached period.
+  long long frames() const { return frames_; }
+  long long cached_frames() const { return cached_frames_; }
+
+ private:
+  // Copies |num_frames| frames from the cached period into |data|, wrapping
+  // around its end.
+  void CopyFrames(int num_frames, uint8_t *data);
+
+  SampleFormat format_;
+  std::vector<double> channel_gains_;
+  TpdfDither *dither_;
+  size_t frame_bytes_;
+
+  // One period of frames, valid if |period_frames_| is not 0.
+  std::vector<uint8_t> period_;
+  int period_frames_;
+  unsigned serial_;
+  // Frame of the period to copy next.
+  int position_;
+  // Frames of the period which the generator has already advanced past but
+  // which have not been served yet.
+  int ahead_frames_;
+
+  int64_t cpu_ns_;
+  long long frames_;
+  long long cached_frames_;
+};
+
+#endif  // INCLUDE_TONE_CACHE_H_
@@ -7,75 +7,162 @@
 // channel) of sound.
 //
 // SineWaveGenerator -- Generates a single test tone for a given frequency.
+// ChannelSineWaveGenerator -- Generates a different test tone on each
+//    channel.
+// MultiToneGenerator -- Generates a mix of tones on all channels.
 // ASharpMinorGenerator -- Generates tones for the A# Harmonic Minor Scale.
 //    Why choose A# Harmonic Minor?  Cause I can. (and because double-sharps
 //    are cool :) )
+// SweepGenerator, NoiseGenerator, MlsGenerator -- Generate broadband signals
+//    which measure a whole frequency response at once.
 
 #ifndef INCLUDE_TONE_GENERATORS_H_
 #define INCLUDE_TONE_GENERATORS_H_
 
+#include <stdint.h>
+
+#include <atomic>
 #include <set>
 #include <vector>
 
 #include "include/common.h"
+#include "include/oscillator.h"
 #include "include/sample_format.h"
 
+// Returns the gain of each of |num_channels| channels for
+// ToneGenerator::GetFrames(): 1 for channels in |active_channels| and 0 for
+// the others. The set is 0 indexed. It is resolved once when playback is
+// configured, so generators never look it up per frame.
+std::vector<double> ChannelGains(int num_channels,
+                                 const std::set<int> &active_channels);
+
 class ToneGenerator {
  public:
   virtual ~ToneGenerator() {}
   // Fills data with up to |buf_size| bytes with of audio frames.  Only
   // complete frames are written into data (ie., the number of samples written
-  // is a multiple of the number of channels), and |buf_size| is adjusted to
-  // reflect the number of bytes written into data.
+  // is a multiple of the number of channels), and the number of bytes
+  // written into data is returned.
   //
-  // The |format|, and |num_channels| parameters affet the size of a frame, and
-  // the type of sample written.  The |active_channels| parameter is used to
-  // select which channels have samples written into them.  If a channel is
-  // not listed in |active_channels|, then it is filled with silence.  This is
-  // to allow generating tones on specific channels.
-  //
-  // The |active_channels| set is 0 indexed.  If you have 2 channels, and you
-  // want to play on all of them, make sure |active_channels| contains 0, and
-  // 1.
+  // The |format| and the number of |channel_gains| affect the size of a
+  // frame, and the type of sample written.  Samples of channel c are
+  // multiplied by channel_gains[c], so a channel with a zero gain is filled
+  // with silence.  This is to allow generating tones on specific channels.
+  // If |dither| is not NULL, its noise is added to integer samples before
+  // they are rounded, like Interleave().
   virtual size_t GetFrames(SampleFormat format,
-                           int num_channels,
-                           const std::set<int> &active_channels,
+                           const std::vector<double> &channel_gains,
                            void *data,
-                           size_t buf_size) = 0;
+                           size_t buf_size,
+                           TpdfDither *dither) = 0;
 
   // Returns whether or not the FrameGenerator is able to produce more frames.
   // This is used to signal when one should stop calling GetFrames().
   virtual bool HasMoreFrames() const = 0;
+
+  // Longest period a generator reports, which bounds the memory of a cache.
+  static const int kMaxPeriodFrames = 1 << 16;
+
+  // Describes how the upcoming output of GetFrames() repeats.
+  struct Period {
+    Period() : frames(0), repeat_frames(0), serial(0) {}
+
+    // Length of a period, or 0 if the output does not repeat.
+    int frames;
+    // Number of upcoming frames which keep repeating.
+    long long repeat_frames;
+    // Changes whenever the repeating waveform may have changed, like on
+    // Reset().
+    unsigned serial;
+  };
+
+  // Returns the repetition of the upcoming output. Generators which cannot
+  // tell, like during fades, return a period of 0 frames.
+  virtual Period GetPeriod() const { return Period(); }
+
+  // Advances the generator by |num_frames| frames as if GetFrames() had
+  // written them. It lets a cache serve a repeating output without
+  // generating it, and is only called while GetPeriod() reports a period.
+  virtual void Skip(int num_frames) {}
 };
 
 class SineWaveGenerator : public ToneGenerator {
  public:
-  explicit SineWaveGenerator(int sample_rate,
-                             double length_sec = -1.0,
-                             int volume_gain = 50);
+  explicit SineWaveGenerator(
+      int sample_rate,
+      double length_sec = -1.0,
+      int volume_gain = 50,
+      Oscillator::Engine engine = Oscillator::kQuadrature);
 
   // Generates a sampled sine wave, where the sine wave period is determined
   // by |frequency| and the sine wave sampling rate is determined by
   // |sample_rate| (in HZ).
   double Next();
+  // Writes the next |count| samples into |output|, like calling Next()
+  // |count| times.
+  void Generate(int count, double *output);
   void Reset(double frequency);
   virtual size_t GetFrames(SampleFormat format,
-                           int num_channels,
-                           const std::set<int> &active_channels,
+                           const std::vector<double> &channel_gains,
                            void *data,
-                           size_t buf_size);
+                           size_t buf_size,
+                           TpdfDither *dither);
   virtual bool HasMoreFrames() const;
+  virtual Period GetPeriod() const;
+  virtual void Skip(int num_frames);
 
  private:
-  double cur_x_;
+  Oscillator oscillator_;
+  // Frames of a whole number of cycles, or 0 if longer than
+  // kMaxPeriodFrames.
+  int period_;
+  unsigned serial_;
   int cur_frame_;
   int total_frame_;
   int sample_rate_;
-  double frequency_;
   int volume_gain_;
 };
 
+class ChannelSineWaveGenerator : public ToneGenerator {
+ public:
+  explicit ChannelSineWaveGenerator(int sample_rate,
+                                    double length_sec = -1.0,
+                                    int volume_gain = 50);
+
+  // Restarts the tones. Channel c plays |frequencies|[c]. Channels out of
+  // |frequencies| are silent.
+  void Reset(const std::vector<double> &frequencies);
+  virtual size_t GetFrames(SampleFormat format,
+                           const std::vector<double> &channel_gains,
+                           void *data,
+                           size_t buf_size,
+                           TpdfDither *dither);
+  virtual bool HasMoreFrames() const;
+  virtual Period GetPeriod() const;
+  virtual void Skip(int num_frames);
+
+ private:
+  std::vector<SineWaveGenerator> tone_wave_;
+  // Common period of all tones, or 0 if longer than kMaxPeriodFrames.
+  int period_;
+  unsigned serial_;
+  // Planar samples of each tone before they are interleaved.
+  std::vector<double> buffer_;
+  std::vector<const double *> planes_;
+  int cur_frame_;
+  int total_frame_;
+  int sample_rate_;
+  int volume_gain_;
+};
 
+// Mixes tones which may change while they play.
+//
+// SetVolumes() and Reset() may be called by a control thread while another
+// thread calls GetFrames(). They publish a copy of the parameters, which the
+// next GetFrames() picks up by swapping an index, so neither thread ever
+// waits for the other. Calls of the control thread must not overlap each
+// other. Tones keep their phase across calls, and a tone changing its
+// frequency without restarting glides to the new frequency.
 class MultiToneGenerator : public ToneGenerator {
  public:
   MultiToneGenerator(int sample_rate, double length_sec);
@@ -88,26 +175,79 @@ class MultiToneGenerator : public ToneGenerator {
                      bool reset_timer = false);
   virtual void Reset(double frequency, bool reset_timer = false);
   virtual size_t GetFrames(SampleFormat format,
-                           int num_channels,
-                           const std::set<int> &active_channels,
+                           const std::vector<double> &channel_gains,
                            void *data,
-                           size_t buf_size);
+                           size_t buf_size,
+                           TpdfDither *dither);
+  // A pending Reset() may restart the tone, so there are more frames as long
+  // as parameters wait to be picked up.
   virtual bool HasMoreFrames() const;
+  // The mix repeats between the fade in and the fade out, as long as the
+  // volume stays constant and no frequency glides.
+  virtual Period GetPeriod() const;
+  virtual void Skip(int num_frames);
 
  private:
-  std::vector<SineWaveGenerator> tone_wave_;
+  // Parameters set by the control thread.
+  struct Params {
+    Params();
+
+    std::vector<double> frequencies;
+    double start_vol;
+    double end_vol;
+    // Common period of the tones, or 0 if longer than kMaxPeriodFrames.
+    int period;
+    // Counts of the restarts of the timer and of volume changes, which
+    // GetFrames() compares with the ones it applied. Counters rather than
+    // flags survive a copy being replaced before it is picked up.
+    unsigned restarts;
+    unsigned volume_changes;
+    // Changes on every publish.
+    unsigned serial;
+  };
 
+  // The three copies of Params are handed over between the threads through
+  // |shared_index_|. It holds the index of the copy between them, with
+  // kDirty set when that copy was published and not picked up yet.
+  static const int kDirty = 4;
+  static const int kIndexMask = 3;
+
+  // Publishes |control_| to GetFrames(). Called by the control thread.
+  void Publish();
+  // Picks up the latest published parameters, if any, and starts playing
+  // them. Called by GetFrames().
+  void ApplyParams();
+  // Moves the glide to the frequencies of the next |count| frames.
+  void UpdateGlide(int count);
   double GetFadeMagnitude() const;
 
+  // Owned by the control thread.
+  Params control_;
+  int write_index_;
+  // Owned by the thread calling GetFrames().
+  int read_index_;
+  std::atomic<int> shared_index_;
+  Params params_[3];
+
+  // State of the thread calling GetFrames().
+  std::vector<Oscillator> tones_;
+  // Frequency each tone plays now, and the one its glide started from.
+  std::vector<double> frequencies_;
+  std::vector<double> glide_start_;
+  // Frames into the glide, which ends after |glide_frames_|.
+  int glide_frame_;
+  int glide_frames_;
+  // Samples of one tone before they are mixed.
+  std::vector<double> tone_buffer_;
+  unsigned restarts_;
+  unsigned volume_changes_;
+
   int frames_generated_;
   int frames_wanted_;
   int fade_frames_;
-  std::vector<double> frequencies_;
   int sample_rate_;
   double cur_vol_;
-  double start_vol_;
   double inc_vol_;
-  pthread_mutex_t param_mutex;
 };
 
 
@@ -119,10 +259,10 @@ class ASharpMinorGenerator : public ToneGenerator {
   void SetVolumes(double start_vol, double end_vol);
   virtual void Reset();
   virtual size_t GetFrames(SampleFormat format,
-                           int num_channels,
-                           const std::set<int> &active_channels,
+                           const std::vector<double> &channel_gains,
                            void *data,
-                           size_t buf_size);
+                           size_t buf_size,
+                           TpdfDither *dither);
   virtual bool HasMoreFrames() const;
 
  private:
@@ -133,4 +273,130 @@ class ASharpMinorGenerator : public ToneGenerator {
   int cur_note_;
 };
 
+// Exponential sine sweep from |start_frequency| to |end_frequency| Hz. Every
+// octave takes the same time, so a single sweep measures the whole band, and
+// after deconvolution its harmonic distortion lands apart from the linear
+// response. Both ends are faded like the tones of MultiToneGenerator.
+class SweepGenerator : public ToneGenerator {
+ public:
+  SweepGenerator(int sample_rate,
+                 double length_sec,
+                 double start_frequency,
+                 double end_frequency,
+                 int volume_gain = 50);
+
+  // Restarts the sweep from its start frequency.
+  void Reset();
+  // Writes the next |count| samples into |output|.
+  void Generate(int count, double *output);
+  virtual size_t GetFrames(SampleFormat format,
+                           const std::vector<double> &channel_gains,
+                           void *data,
+                           size_t buf_size,
+                           TpdfDither *dither);
+  virtual bool HasMoreFrames() const;
+
+ private:
+  int total_frames_;
+  int cur_frame_;
+  int fade_frames_;
+  double volume_;
+  // Frequency of the first sample in cycles per sample, and the ratio of the
+  // frequencies of consecutive samples.
+  double start_cycles_;
+  double growth_;
+  // Phase and frequency of the next sample, in cycles.
+  double phase_;
+  double cycles_;
+};
+
+// White or pink noise, reproducible from its seed. White noise is uniform
+// over the full scale. Pink noise falls by 3 dB per octave, and is scaled to
+// an RMS of a quarter of the full scale so that its peaks rarely clip.
+class NoiseGenerator : public ToneGenerator {
+ public:
+  enum Color {
+    kWhite,
+    kPink,
+  };
+
+  NoiseGenerator(int sample_rate,
+                 double length_sec,
+                 Color color,
+                 uint32_t seed = 0,
+                 int volume_gain = 50);
+
+  // Restarts the same noise from its seed.
+  void Reset();
+  // Writes the next |count| samples into |output|.
+  void Generate(int count, double *output);
+  virtual size_t GetFrames(SampleFormat format,
+                           const std::vector<double> &channel_gains,
+                           void *data,
+                           size_t buf_size,
+                           TpdfDither *dither);
+  virtual bool HasMoreFrames() const;
+
+ private:
+  static const int kPinkPoles = 7;
+
+  Color color_;
+  uint32_t seed_;
+  UniformNoise noise_;
+  // State of the pinking filter.
+  double pink_[kPinkPoles];
+  int total_frames_;
+  int cur_frame_;
+  double volume_;
+};
+
+// Maximum length sequence of +-1, from a Galois LFSR of |order| bits, played
+// over and over for the length. Its circular autocorrelation is an impulse,
+// so correlating a period of the recording with the sequence gives the
+// impulse response. Sequences up to kMaxPeriodFrames long report their
+// period, so ToneCache replays them.
+class MlsGenerator : public ToneGenerator {
+ public:
+  static const int kMinOrder = 2;
+  static const int kMaxOrder = 24;
+
+  // An |order| of 0 picks the longest sequence up to 16 bits which plays at
+  // least twice, since the first period only primes the response. The |seed|
+  // picks the state the sequence starts from.
+  MlsGenerator(int sample_rate,
+               double length_sec,
+               int order = 0,
+               uint32_t seed = 0,
+               int volume_gain = 50);
+
+  int order() const { return order_; }
+  // Frames of a period, 2^order - 1.
+  int period() const { return period_; }
+
+  // Restarts the sequence from its first state.
+  void Reset();
+  // Writes the next |count| samples into |output|.
+  void Generate(int count, double *output);
+  virtual size_t GetFrames(SampleFormat format,
+                           const std::vector<double> &channel_gains,
+                           void *data,
+                           size_t buf_size,
+                           TpdfDither *dither);
+  virtual bool HasMoreFrames() const;
+  virtual Period GetPeriod() const;
+  virtual void Skip(int num_frames);
+
+ private:
+  int order_;
+  int period_;
+  // Feedback taps of the LFSR, and its first and next states.
+  uint32_t taps_;
+  uint32_t start_state_;
+  uint32_t state_;
+  int total_frames_;
+  int cur_frame_;
+  double volume_;
+  unsigned serial_;
+};
+
 #endif  // INCLUDE_TONE_GENERATORS_H_
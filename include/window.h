@@ -0,0 +1,34 @@
+// Copyright 2019 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef INCLUDE_WINDOW_H_
+#define INCLUDE_WINDOW_H_
+
+#include <vector>
+
+// Window functions applied to the frames of a short-time Fourier transform.
+class WindowFunction {
+ public:
+  enum Type {
+    kRectangular,
+    kHann,
+    kBlackmanHarris,
+    kInvalid,
+  };
+
+  WindowFunction();
+  explicit WindowFunction(Type type);
+  Type type() const;
+  const char *to_string() const;
+
+  // Returns the periodic window of |size| points, so that a tone centered on
+  // a bin of a |size| points DFT has its energy spread into a few fixed bins
+  // around it.
+  std::vector<double> Generate(int size) const;
+
+ private:
+  Type type_;
+};
+
+#endif  // INCLUDE_WINDOW_H_
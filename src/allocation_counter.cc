@@ -0,0 +1,52 @@
+// Copyright 2019 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "include/allocation_counter.h"
+
+#include <stdlib.h>
+
+#include <new>
+
+namespace {
+// Counted per thread, so the capture thread does not disturb the evaluation
+// and no atomic operation is needed.
+thread_local uint64_t allocation_count = 0;
+
+void *Allocate(size_t size) {
+  ++allocation_count;
+  void *ptr = malloc(size ? size : 1);
+  if (!ptr)
+    throw std::bad_alloc();
+  return ptr;
+}
+
+}  // namespace
+
+uint64_t ThreadAllocationCount() {
+  return allocation_count;
+}
+
+void *operator new(size_t size) {
+  return Allocate(size);
+}
+
+void *operator new[](size_t size) {
+  return Allocate(size);
+}
+
+void operator delete(void *ptr) noexcept {
+  free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+  free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+  free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept {
+  free(ptr);
+}
@@ -6,6 +6,7 @@
 
 #include <limits>
 
+#include "include/tone_cache.h"
 #include "include/tone_generators.h"
 
 // Translates our SampleFormat type into a Alsa friendly format.
@@ -20,33 +21,24 @@ _snd_pcm_format SampleFormatToAlsaFormat(SampleFormat format) {
       return SND_PCM_FORMAT_S16_LE;
 
     case SampleFormat::kPcmS24:
+      return SND_PCM_FORMAT_S24_3LE;
+
+    case SampleFormat::kPcmS24In32:
       return SND_PCM_FORMAT_S24_LE;
 
     case SampleFormat::kPcmS32:
       return SND_PCM_FORMAT_S32_LE;
 
+    case SampleFormat::kPcmFloat:
+      return SND_PCM_FORMAT_FLOAT_LE;
+
     default:
       return SND_PCM_FORMAT_UNKNOWN;
   }
 }
 
 int SampleFormatToFrameBytes(SampleFormat format, int channels) {
-  switch (format.type()) {
-    case SampleFormat::kPcmU8:
-      return channels;
-
-    case SampleFormat::kPcmS16:
-      return channels * 2;
-
-    case SampleFormat::kPcmS24:
-      return channels * 4;
-
-    case SampleFormat::kPcmS32:
-      return channels * 4;
-
-    default:
-      return SND_PCM_FORMAT_UNKNOWN;
-  }
+  return channels * format.bytes();
 }
 
 template<typename T>
@@ -111,6 +103,8 @@ bool AlsaPlaybackClient::Init(int sample_rate, SampleFormat format,
   format_ = format;
   num_channels_ = num_channels;
   active_channels_ = active_channels;
+  tone_cache_.reset(
+      new ToneCache(format, ChannelGains(num_channels, *active_channels)));
 
   /* Open pcm handle */
   if (pcm_out_handle_)
@@ -257,12 +251,15 @@ void AlsaPlaybackClient::PlayTones() {
     return;
 
   fprintf(stderr, "Start play tone\n");
+  tone_cache_->Reset();
+  const double cpu_seconds = tone_cache_->cpu_seconds();
+  const long long frames = tone_cache_->frames();
   // Run main loop until we are out of frames to generate.
   while (state() == kReady && generator_->HasMoreFrames()) {
     size_t to_write = pb_param_.num_frames_ * pb_param_.frame_bytes_;
     size_t written = to_write;
-    written = generator_->GetFrames(format_, num_channels_, *active_channels_,
-                                    pb_param_.chunk_.get(), to_write);
+    written = tone_cache_->GetFrames(generator_, pb_param_.chunk_.get(),
+                                     to_write);
 
     if (written < to_write)
       memset(pb_param_.chunk_.get() + written, 0, (to_write - written));
@@ -290,6 +287,12 @@ void AlsaPlaybackClient::PlayTones() {
   set_state(kComplete);
   snd_pcm_drop(pcm_out_handle_);
   fprintf(stderr, "Stop play tone\n");
+  const long long played = tone_cache_->frames() - frames;
+  if (played > 0) {
+    fprintf(stderr, "Tone generation: %.3f ms CPU per second\n",
+            1000 * (tone_cache_->cpu_seconds() - cpu_seconds) * sample_rate_ /
+                played);
+  }
 }
 
 void AlsaPlaybackClient::Print(FILE *fp) {
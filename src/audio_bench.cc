@@ -0,0 +1,583 @@
+// Copyright 2019 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Microbenchmarks of the audio processing kernels. Each case runs a kernel
+// over a fixed parameter set until the minimum time has passed, and prints a
+// tab separated line:
+//
+//   kernel  params  ops  ns_per_op  samples_per_s
+//
+// where an op is one call of the kernel and params is a comma separated list
+// of key=value pairs. The columns and the names of kernels and params are
+// kept stable, so the output of different releases can be compared by
+// joining on the first two columns. See PrintUsage() for the options.
+
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <alsa/asoundlib.h>
+
+#include "include/block_source.h"
+#include "include/common.h"
+#include "include/evaluator.h"
+#include "include/fft.h"
+#include "include/glitch_detector.h"
+#include "include/oscillator.h"
+#include "include/sample_format.h"
+#include "include/tone_cache.h"
+#include "include/tone_generators.h"
+
+extern "C" {
+#include "alsa_conformance_test/alsa_conformance_recorder.h"
+}
+
+namespace {
+
+const int kFrames = 2048;
+const int kSampleRate = 48000;
+const int kChannelCounts[] = {1, 2, 4, 8};
+const SampleFormat::Type kFormats[] = {
+  SampleFormat::kPcmU8,
+  SampleFormat::kPcmS16,
+  SampleFormat::kPcmS24,
+  SampleFormat::kPcmS24In32,
+  SampleFormat::kPcmS32,
+  SampleFormat::kPcmFloat,
+};
+
+struct BenchConfig {
+  BenchConfig() : min_time_sec(0.2) {}
+
+  // Only kernels whose name contains the filter are run.
+  std::string filter;
+  double min_time_sec;
+};
+
+// Keeps results of kernels alive, so they are not optimized out.
+volatile double sink;
+
+// Returns true if |kernel| is selected by the filter of |config|.
+bool IsSelected(const BenchConfig &config, const char *kernel) {
+  return strstr(kernel, config.filter.c_str()) != NULL;
+}
+
+void PrintResult(const char *kernel, const std::string &params,
+                 long long ops, double elapsed, double samples_per_op) {
+  printf("%s\t%s\t%lld\t%.2f\t%.4e\n", kernel, params.c_str(), ops,
+         elapsed * 1e9 / ops, samples_per_op * ops / elapsed);
+  fflush(stdout);
+}
+
+// Times |op| and prints a result line. |samples_per_op| is the number of
+// samples each op processes. The number of ops doubles until the run takes
+// at least the minimum time.
+template <typename Op>
+void Measure(const BenchConfig &config, const char *kernel,
+             const std::string &params, double samples_per_op, Op op) {
+  if (!IsSelected(config, kernel))
+    return;
+  // Warms up caches and lazily allocated buffers.
+  op();
+  long long ops = 1;
+  double elapsed = 0.0;
+  while (true) {
+    const std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    for (long long i = 0; i < ops; ++i)
+      op();
+    elapsed = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    if (elapsed >= config.min_time_sec)
+      break;
+    ops *= 2;
+  }
+  PrintResult(kernel, params, ops, elapsed, samples_per_op);
+}
+
+// Fills |data| with deterministic noise in [-0.5, 0.5).
+void FillNoise(std::vector<double> *data) {
+  unsigned int seed = 1;
+  for (auto &x : *data)
+    x = static_cast<double>(rand_r(&seed)) / RAND_MAX - 0.5;
+}
+
+// Returns |num_samples| samples of noise in |format|.
+std::vector<uint8_t> NoiseBuffer(SampleFormat format, int num_samples) {
+  std::vector<double> noise(num_samples);
+  FillNoise(&noise);
+  std::vector<uint8_t> buffer(num_samples * format.bytes());
+  void *ptr = buffer.data();
+  for (double x : noise)
+    ptr = WriteSample(x, format, ptr);
+  return buffer;
+}
+
+std::set<int> AllChannels(int num_channels) {
+  std::set<int> channels;
+  for (int c = 0; c < num_channels; ++c)
+    channels.insert(c);
+  return channels;
+}
+
+template <typename T>
+void BenchFFT(const BenchConfig &config, const char *type) {
+  for (int size = 256; size <= 16384; size *= 2) {
+    for (int batch : kChannelCounts) {
+      BasicRealFFT<T> fft(size);
+      std::vector<double> noise(size * batch);
+      FillNoise(&noise);
+      std::vector<T> input(noise.begin(), noise.end());
+      std::vector<T> output(fft.output_size() * batch);
+      const std::string params = "size=" + std::to_string(size) +
+                                 ",batch=" + std::to_string(batch) +
+                                 ",type=" + type;
+      Measure(config, "fft", params, size * batch, [&] {
+        fft.TransformBatch(input.data(), batch, output.data());
+        sink = output[2];
+      });
+    }
+  }
+}
+
+void BenchUnpack(const BenchConfig &config) {
+  for (SampleFormat::Type type : kFormats) {
+    const SampleFormat format(type);
+    for (int channels : kChannelCounts) {
+      std::vector<uint8_t> buffer = NoiseBuffer(format, kFrames * channels);
+      std::vector<std::vector<double> > output;
+      const std::string params = std::string("format=") + format.to_string() +
+                                 ",channels=" + std::to_string(channels);
+      Measure(config, "unpack", params, kFrames * channels, [&] {
+        Unpack(buffer.data(), buffer.size(), format, channels, &output);
+        sink = output[0][1];
+      });
+    }
+  }
+}
+
+void BenchWriteSample(const BenchConfig &config) {
+  for (SampleFormat::Type type : kFormats) {
+    const SampleFormat format(type);
+    std::vector<double> noise(kFrames);
+    FillNoise(&noise);
+    std::vector<uint8_t> buffer(kFrames * format.bytes());
+    int index = 0;
+    Measure(config, "write_sample",
+            std::string("format=") + format.to_string(), 1, [&] {
+      WriteSample(noise[index], format, &buffer[index * format.bytes()]);
+      index = (index + 1) % kFrames;
+    });
+    sink = buffer[1];
+  }
+}
+
+// Interleaves kFrames frames of planar noise in each op, with and without
+// dither.
+void BenchInterleave(const BenchConfig &config) {
+  for (SampleFormat::Type type : kFormats) {
+    const SampleFormat format(type);
+    for (int channels : kChannelCounts) {
+      std::vector<double> noise(kFrames);
+      FillNoise(&noise);
+      const std::vector<const double *> planes(channels, noise.data());
+      const std::vector<double> gains(channels, 1.0);
+      std::vector<uint8_t> buffer(kFrames * channels * format.bytes());
+      TpdfDither dither;
+      for (bool use_dither : {false, true}) {
+        const std::string params =
+            std::string("format=") + format.to_string() + ",channels=" +
+            std::to_string(channels) + ",dither=" + (use_dither ? "1" : "0");
+        Measure(config, "interleave", params, kFrames * channels, [&] {
+          Interleave(planes.data(), gains.data(), kFrames, channels, format,
+                     buffer.data(), use_dither ? &dither : NULL);
+          sink = buffer[1];
+        });
+      }
+    }
+  }
+}
+
+// Generates kFrames frames of |generator| in each op, through a ToneCache if
+// |cached|. The generator is reset by |reset| whenever it comes short of
+// frames.
+template <typename Reset>
+void BenchGenerator(const BenchConfig &config, const char *kernel,
+                    const std::string &name, ToneGenerator *generator,
+                    Reset reset, bool cached = false) {
+  for (SampleFormat::Type type : kFormats) {
+    const SampleFormat format(type);
+    // TDM configurations run 16 and 32 channels.
+    for (int channels : {1, 2, 4, 8, 16, 32}) {
+      const std::vector<double> channel_gains =
+          ChannelGains(channels, AllChannels(channels));
+      std::vector<uint8_t> buffer(kFrames * channels * format.bytes());
+      const std::string params = name + ",format=" + format.to_string() +
+                                 ",channels=" + std::to_string(channels);
+      ToneCache cache(format, channel_gains);
+      reset();
+      Measure(config, kernel, params, kFrames * channels, [&] {
+        const size_t written =
+            cached ? cache.GetFrames(generator, buffer.data(), buffer.size())
+                   : generator->GetFrames(format, channel_gains,
+                                          buffer.data(), buffer.size(), NULL);
+        if (written < buffer.size()) {
+          reset();
+          cache.Reset();
+        }
+        sink = buffer[1];
+      });
+    }
+  }
+}
+
+void BenchGenerators(const BenchConfig &config) {
+  SineWaveGenerator sine(kSampleRate, 10.0);
+  BenchGenerator(config, "get_frames", "generator=sine", &sine,
+                 [&] { sine.Reset(1000.0); });
+
+  for (int tones : {2, 8}) {
+    MultiToneGenerator multi_tone(kSampleRate, 10.0);
+    std::vector<double> frequencies;
+    for (int i = 0; i < tones; ++i)
+      frequencies.push_back(1000.0 + 500.0 * i);
+    BenchGenerator(config, "get_frames",
+                   "generator=multi_tone,tones=" + std::to_string(tones),
+                   &multi_tone,
+                   [&] { multi_tone.Reset(frequencies, true); });
+  }
+
+  ChannelSineWaveGenerator channel_sine(kSampleRate, 10.0);
+  std::vector<double> frequencies;
+  for (int c = 0; c < 8; ++c)
+    frequencies.push_back(1000.0 + 500.0 * c);
+  BenchGenerator(config, "get_frames", "generator=channel_sine",
+                 &channel_sine, [&] { channel_sine.Reset(frequencies); });
+
+  SweepGenerator sweep(kSampleRate, 10.0, 20.0, 20000.0);
+  BenchGenerator(config, "get_frames", "generator=sweep", &sweep,
+                 [&] { sweep.Reset(); });
+  NoiseGenerator white(kSampleRate, 10.0, NoiseGenerator::kWhite);
+  BenchGenerator(config, "get_frames", "generator=white", &white,
+                 [&] { white.Reset(); });
+  NoiseGenerator pink(kSampleRate, 10.0, NoiseGenerator::kPink);
+  BenchGenerator(config, "get_frames", "generator=pink", &pink,
+                 [&] { pink.Reset(); });
+  MlsGenerator mls(kSampleRate, 10.0);
+  BenchGenerator(config, "get_frames", "generator=mls", &mls,
+                 [&] { mls.Reset(); });
+
+  // Tones on bins of a 2048 point DFT, like audiofuntest plays, repeat every
+  // 2048 frames.
+  const double bin = kSampleRate / 2048.0;
+  sine.Reset(bin * 43);
+  BenchGenerator(config, "cached_frames", "generator=sine", &sine,
+                 [&] { sine.Reset(bin * 43); }, true);
+
+  MultiToneGenerator multi_tone(kSampleRate, 10.0);
+  std::vector<double> bins;
+  for (int i = 0; i < 8; ++i)
+    bins.push_back(bin * (43 + 21 * i));
+  BenchGenerator(config, "cached_frames", "generator=multi_tone,tones=8",
+                 &multi_tone, [&] { multi_tone.Reset(bins, true); }, true);
+  BenchGenerator(config, "cached_frames", "generator=mls", &mls,
+                 [&] { mls.Reset(); }, true);
+}
+
+const Oscillator::Engine kEngines[] = {
+  Oscillator::kPhaseAccumulator,
+  Oscillator::kQuadrature,
+  Oscillator::kTableLookup,
+};
+const int kNumEngines = sizeof(kEngines) / sizeof(kEngines[0]);
+
+// Generates kFrames samples of a tone with each engine in each op.
+void BenchOscillator(const BenchConfig &config) {
+  for (Oscillator::Engine engine : kEngines) {
+    Oscillator oscillator(engine);
+    oscillator.Reset(997.0, kSampleRate);
+    std::vector<double> output(kFrames);
+    Measure(config, "oscillator",
+            std::string("engine=") + oscillator.to_string(), kFrames, [&] {
+      oscillator.Generate(kFrames, output.data());
+      sink = output[1];
+    });
+  }
+}
+
+// Prints the accuracy of each engine as comment lines, which keeps the table
+// of timings intact. A tone on bin kBin of a kSize points DFT is generated
+// from |offset| samples on, so it is periodic in the transform and needs no
+// window: all the power outside the carrier bin is distortion. The spurious
+// free dynamic range is the carrier over the largest other bin, and the max
+// error is against sin() in long double. "unbounded" is sin() of a phase
+// growing without bound, the way tones were generated before.
+void BenchOscillatorAccuracy(const BenchConfig &config) {
+  const char *kernel = "oscillator_sfdr";
+  if (!IsSelected(config, kernel))
+    return;
+  const int kSize = 65536;
+  const int kBin = 1361;
+  const double frequency = static_cast<double>(kBin) * kSampleRate / kSize;
+  RealFFT fft(kSize);
+  std::vector<double> samples(kSize);
+  std::vector<double> spectrum(fft.output_size());
+
+  for (long long offset : {0LL, 1LL << 25}) {
+    // Engine -1 is the unbounded phase.
+    for (int e = -1; e < kNumEngines; ++e) {
+      const char *name = "unbounded";
+      if (e < 0) {
+        const double omega = 2 * M_PI * frequency / kSampleRate;
+        double x = 0.0;
+        for (long long n = 0; n < offset; ++n)
+          x += omega;
+        for (int n = 0; n < kSize; ++n) {
+          samples[n] = sin(x);
+          x += omega;
+        }
+      } else {
+        Oscillator oscillator(kEngines[e]);
+        oscillator.Reset(frequency, kSampleRate);
+        name = oscillator.to_string();
+        for (long long n = 0; n < offset; n += kSize)
+          oscillator.Generate(kSize, samples.data());
+        oscillator.Generate(kSize, samples.data());
+      }
+
+      double max_error = 0.0;
+      for (int n = 0; n < kSize; ++n) {
+        const long long cycle = (kBin * (offset + n)) % kSize;
+        const double expected = sinl(2 * M_PIl * cycle / kSize);
+        max_error = std::max(max_error, fabs(samples[n] - expected));
+      }
+      fft.Transform(samples.data(), spectrum.data());
+      double carrier = 0.0;
+      double spur = 0.0;
+      for (int k = 1; k < kSize / 2; ++k) {
+        const double power = spectrum[2 * k] * spectrum[2 * k] +
+                             spectrum[2 * k + 1] * spectrum[2 * k + 1];
+        if (k == kBin)
+          carrier = power;
+        else
+          spur = std::max(spur, power);
+      }
+      printf("# %s\tengine=%s,offset=%lld\tsfdr_db=%.1f\tmax_error=%.3e\n",
+             kernel, name, offset,
+             10 * log10(carrier / std::max(spur, 1e-300)), max_error);
+      fflush(stdout);
+    }
+  }
+}
+
+// Serves the same block of noise forever, like a capture of silence.
+class NoiseSource : public BlockSource {
+ public:
+  explicit NoiseSource(std::vector<uint8_t> data)
+      : data_(std::move(data)), trials_(0) {
+    block_.data = data_.data();
+    block_.sequence = 0;
+  }
+
+  size_t block_size() const override { return data_.size(); }
+  uint64_t latest_sequence() override { return block_.sequence; }
+  uint64_t dropped_blocks() override { return 0; }
+  const Block *Acquire(uint64_t sequence) override {
+    ++trials_;
+    block_.sequence = sequence + 1;
+    return &block_;
+  }
+  void Release(const Block *) override {}
+
+  // Returns the number of blocks acquired so far.
+  long long trials() const { return trials_; }
+
+ private:
+  std::vector<uint8_t> data_;
+  Block block_;
+  long long trials_;
+};
+
+// Times a trial of Evaluator::Evaluate(): unpacking a block, transforming it
+// and estimating the confidence of every carrier in every channel with
+// EstimateChannel(). Noise never passes, so each Evaluate() runs all trials.
+void BenchEvaluator(const BenchConfig &config) {
+  const char *kernel = "evaluator_trial";
+  if (!IsSelected(config, kernel))
+    return;
+  for (int fft_size : {2048, 8192}) {
+    for (int channels : {2, 8}) {
+      for (int carriers : {1, 4}) {
+        for (int single_precision = 0; single_precision < 2;
+             ++single_precision) {
+          AudioFunTestConfig test_config;
+          test_config.fft_size = fft_size;
+          test_config.hop_size = fft_size;
+          test_config.num_mic_channels = channels;
+          test_config.active_mic_channels = AllChannels(channels);
+          test_config.num_carriers = carriers;
+          test_config.single_precision = single_precision;
+          Evaluator evaluator(test_config);
+          NoiseSource source(NoiseBuffer(test_config.sample_format,
+                                         fft_size * channels));
+          std::vector<int> bins;
+          for (int k = 0; k < carriers; ++k)
+            bins.push_back(fft_size / 16 + k * test_config.match_window_size);
+          std::vector<std::vector<bool> > results(
+              carriers, std::vector<bool>(channels));
+
+          const std::string params =
+              "fft_size=" + std::to_string(fft_size) +
+              ",channels=" + std::to_string(channels) +
+              ",carriers=" + std::to_string(carriers) +
+              ",type=" + (single_precision ? "float" : "double");
+          // An op is one trial, i.e. one block acquired from the source.
+          evaluator.Evaluate(bins, &source, &results);
+          const long long warm_up_trials = source.trials();
+          const std::chrono::steady_clock::time_point start =
+              std::chrono::steady_clock::now();
+          double elapsed = 0.0;
+          while (elapsed < config.min_time_sec) {
+            evaluator.Evaluate(bins, &source, &results);
+            elapsed = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start).count();
+          }
+          PrintResult(kernel, params, source.trials() - warm_up_trials,
+                      elapsed, fft_size * channels);
+        }
+      }
+    }
+  }
+}
+
+// Checks a block of kFrames frames of steady tones for glitches in each op,
+// with one stage per tone. The tones have whole periods in a block, so the
+// repeated block has no glitch.
+void BenchGlitchDetector(const BenchConfig &config) {
+  const int sample_rate = 192000;
+  const SampleFormat format(SampleFormat::kPcmS16);
+  for (int channels : kChannelCounts) {
+    for (int tones : {1, 4}) {
+      std::vector<double> frequencies;
+      for (int k = 0; k < tones; ++k)
+        frequencies.push_back((11.0 + 16 * k) * sample_rate / kFrames);
+      std::vector<uint8_t> buffer(kFrames * channels * format.bytes());
+      void *ptr = buffer.data();
+      for (int i = 0; i < kFrames; ++i) {
+        double sample = 0.0;
+        for (double frequency : frequencies)
+          sample += 0.5 / tones * sin(2 * M_PI * frequency * i / sample_rate);
+        for (int c = 0; c < channels; ++c)
+          ptr = WriteSample(sample, format, ptr);
+      }
+      GlitchDetector detector(sample_rate, channels, kFrames, format, tones);
+      detector.Reset(frequencies);
+      uint64_t first_frame = 0;
+      const std::string params = "channels=" + std::to_string(channels) +
+                                 ",tones=" + std::to_string(tones);
+      Measure(config, "glitch_detector", params, kFrames * channels, [&] {
+        detector.AddFrames(buffer.data(), first_frame);
+        first_frame += kFrames;
+      });
+      sink = detector.glitch_count(0);
+    }
+  }
+}
+
+void BenchRecorderAdd(const BenchConfig &config) {
+  // Points of 480 frames are 10 ms apart. With merging, each of them is
+  // followed by a point of 1 frame 10 us later, which replaces it.
+  for (bool merge : {false, true}) {
+    struct alsa_conformance_recorder *recorder = recorder_create(0.001, 16);
+    struct timespec time = {0, 0};
+    unsigned long frames = 0;
+    bool is_period = true;
+    Measure(config, "recorder_add",
+            std::string("merge=") + (merge ? "half" : "none"), 1, [&] {
+      const long step_ns = is_period ? 10000000L : 10000L;
+      time.tv_nsec += step_ns;
+      if (time.tv_nsec >= 1000000000L) {
+        time.tv_nsec -= 1000000000L;
+        ++time.tv_sec;
+      }
+      frames += is_period ? 480 : 1;
+      sink = recorder_add(recorder, time, frames);
+      if (merge)
+        is_period = !is_period;
+    });
+    recorder_destroy(recorder);
+  }
+}
+
+void PrintUsage(const char *name) {
+  fprintf(stderr,
+          "Usage %s [options]\n"
+          "\t-f, --filter: Only run kernels whose name contains the string. "
+          "Kernels are fft, unpack, write_sample, get_frames, cached_frames, "
+          "evaluator_trial, glitch_detector and recorder_add.\n"
+          "\t-t, --min-time: Minimum time(s) of each case. (def 0.2)\n"
+          "\t-h, --help: Show this page.\n",
+          name);
+}
+
+bool ParseOptions(int argc, char *argv[], BenchConfig *config) {
+  const struct option long_options[] = {
+    {"filter", 1, NULL, 'f'},
+    {"min-time", 1, NULL, 't'},
+    {"help", 0, NULL, 'h'},
+    {NULL, 0, NULL, 0},
+  };
+  int opt;
+  while ((opt = getopt_long(argc, argv, "f:t:h", long_options, NULL)) != -1) {
+    switch (opt) {
+      case 'f':
+        config->filter = optarg;
+        break;
+      case 't':
+        config->min_time_sec = atof(optarg);
+        if (config->min_time_sec <= 0) {
+          fprintf(stderr, "Minimum time must be positive.\n");
+          return false;
+        }
+        break;
+      default:
+        return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  BenchConfig config;
+  if (!ParseOptions(argc, argv, &config)) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  printf("# kernel\tparams\tops\tns_per_op\tsamples_per_s\n");
+  BenchFFT<double>(config, "double");
+  BenchFFT<float>(config, "float");
+  BenchUnpack(config);
+  BenchWriteSample(config);
+  BenchInterleave(config);
+  BenchGenerators(config);
+  BenchOscillator(config);
+  BenchOscillatorAccuracy(config);
+  BenchEvaluator(config);
+  BenchGlitchDetector(config);
+  BenchRecorderAdd(config);
+  return 0;
+}
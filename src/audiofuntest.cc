@@ -4,20 +4,33 @@
 
 #include <assert.h>
 #include <getopt.h>
+#include <math.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <memory>
+
 #include "include/binary_client.h"
+#include "include/capture_thread.h"
 #include "include/common.h"
 #include "include/evaluator.h"
+#include "include/file_source.h"
 #include "include/generator_player.h"
+#include "include/glitch_detector.h"
+#include "include/pilot_tracker.h"
 #include "include/sample_format.h"
+#include "include/spectrogram.h"
+#include "include/sweep_analyzer.h"
 #include "include/tone_generators.h"
 
 constexpr static const char *short_options =
-    "a:m:d:n:o:w:P:f:R:F:r:t:c:C:T:l:g:i:x:hv";
+    "a:m:d:n:o:w:P:f:R:F:r:t:Ec:C:T:l:g:i:x:k:MW:H:pDGI:S:s:O:L:Y:y:z:hv";
 
 constexpr static const struct option long_options[] = {
   {"active-speaker-channels", 1, NULL, 'a'},
@@ -32,6 +45,7 @@ constexpr static const struct option long_options[] = {
   {"recorder-fifo", 1, NULL, 'F'},
   {"sample-rate", 1, NULL, 'r'},
   {"sample-format", 1, NULL, 't'},
+  {"dither", 0, NULL, 'E'},
   {"num-mic-channels", 1, NULL, 'c'},
   {"num-speaker-channels", 1, NULL, 'C'},
   {"test-rounds", 1, NULL, 'T'},
@@ -39,6 +53,21 @@ constexpr static const struct option long_options[] = {
   {"volume-gain", 1, NULL, 'g'},
   {"min-frequency", 1, NULL, 'i'},
   {"max-frequency", 1, NULL, 'x'},
+  {"num-carriers", 1, NULL, 'k'},
+  {"channel-matrix", 0, NULL, 'M'},
+  {"window", 1, NULL, 'W'},
+  {"hop-size", 1, NULL, 'H'},
+  {"single-precision", 0, NULL, 'p'},
+  {"distortion", 0, NULL, 'D'},
+  {"glitches", 0, NULL, 'G'},
+  {"input-file", 1, NULL, 'I'},
+  {"rounds-file", 1, NULL, 'S'},
+  {"stimulus", 1, NULL, 's'},
+  {"capture-file", 1, NULL, 'O'},
+  {"pilot", 1, NULL, 'L'},
+  {"spectrogram", 1, NULL, 'Y'},
+  {"spectrogram-decimation", 1, NULL, 'y'},
+  {"seed", 1, NULL, 'z'},
 
   // Other helper args.
   {"help", 0, NULL, 'h'},
@@ -61,6 +90,24 @@ SampleFormat ParseSampleFormat(const char *arg) {
   return SampleFormat(SampleFormat::kPcmS16);
 }
 
+// Broadband stimuli of --stimulus.
+const char *const kStimuli[] = {"sweep", "white", "pink", "mls"};
+
+// Parse the window function. The input should be one of the string in
+// WindowFunction::Type.
+bool ParseWindow(const char *arg, WindowFunction *window) {
+  for (int type = WindowFunction::kRectangular;
+       type != WindowFunction::kInvalid;
+       type++) {
+    *window = WindowFunction(WindowFunction::Type(type));
+    if (strcmp(window->to_string(), arg) == 0) {
+      return true;
+    }
+  }
+  fprintf(stderr, "Unknown window %s.\n", arg);
+  return false;
+}
+
 bool ParseOptions(int argc, char *const argv[], AudioFunTestConfig *config) {
   int opt = 0;
   int optindex = -1;
@@ -114,6 +161,9 @@ bool ParseOptions(int argc, char *const argv[], AudioFunTestConfig *config) {
       case 't':
         config->sample_format = ParseSampleFormat(optarg);
         break;
+      case 'E':
+        config->dither = true;
+        break;
       case 'c':
         config->num_mic_channels = atoi(optarg);
         break;
@@ -145,6 +195,63 @@ bool ParseOptions(int argc, char *const argv[], AudioFunTestConfig *config) {
       case 'x':
         config->max_frequency = atoi(optarg);
         break;
+      case 'k':
+        config->num_carriers = atoi(optarg);
+        if (config->num_carriers < 1) {
+          fprintf(stderr, "Number of carriers must be at least 1.\n");
+          return false;
+        }
+        break;
+      case 'M':
+        config->channel_matrix = true;
+        break;
+      case 'W':
+        if (!ParseWindow(optarg, &config->window))
+          return false;
+        break;
+      case 'H':
+        config->hop_size = atoi(optarg);
+        break;
+      case 'p':
+        config->single_precision = true;
+        break;
+      case 'D':
+        config->distortion = true;
+        break;
+      case 'G':
+        config->glitches = true;
+        break;
+      case 'I':
+        config->input_file = std::string(optarg);
+        break;
+      case 'S':
+        config->rounds_file = std::string(optarg);
+        break;
+      case 's':
+        config->stimulus = std::string(optarg);
+        if (std::find_if(std::begin(kStimuli), std::end(kStimuli),
+                         [](const char *name) {
+                           return strcmp(name, optarg) == 0;
+                         }) == std::end(kStimuli)) {
+          fprintf(stderr, "Unknown stimulus %s.\n", optarg);
+          return false;
+        }
+        break;
+      case 'O':
+        config->capture_file = std::string(optarg);
+        break;
+      case 'L':
+        config->pilot_frequency = atof(optarg);
+        break;
+      case 'Y':
+        config->spectrogram_file = std::string(optarg);
+        break;
+      case 'y':
+        config->spectrogram_decimation = atoi(optarg);
+        break;
+      case 'z':
+        config->seed = strtoul(optarg, NULL, 0);
+        break;
       case 'v':
         config->verbose = true;
         break;
@@ -156,13 +263,67 @@ bool ParseOptions(int argc, char *const argv[], AudioFunTestConfig *config) {
     }
   }
 
-  if (config->player_command.empty()) {
-    fprintf(stderr, "player-command is not set.\n");
-    return false;
+  if (!config->input_file.empty()) {
+    // A sweep or pilot recording is analyzed as it is, without rounds, and
+    // any recording can be written into a spectrogram alone.
+    if (config->stimulus.empty() && config->pilot_frequency == 0 &&
+        config->spectrogram_file.empty() && config->rounds_file.empty()) {
+      fprintf(stderr, "rounds-file is required with input-file.\n");
+      return false;
+    }
+    if (!config->stimulus.empty() && config->stimulus != "sweep") {
+      fprintf(stderr, "Only a sweep recording can be analyzed.\n");
+      return false;
+    }
+    // The header of a WAV file overrides the recording format.
+    AudioFile file;
+    if (!file.Open(config->input_file.c_str(), config->sample_format,
+                   config->sample_rate, config->num_mic_channels))
+      return false;
+    config->sample_format = file.format();
+    config->sample_rate = file.sample_rate();
+    config->num_mic_channels = file.num_channels();
+  } else {
+    if (config->player_command.empty()) {
+      fprintf(stderr, "player-command is not set.\n");
+      return false;
+    }
+
+    if (config->recorder_command.empty()) {
+      fprintf(stderr, "recorder-command is not set.\n");
+      return false;
+    }
   }
 
-  if (config->recorder_command.empty()) {
-    fprintf(stderr, "recorder-command is not set.\n");
+  if (!config->stimulus.empty()) {
+    if (config->input_file.empty() && config->capture_file.empty()) {
+      fprintf(stderr, "capture-file is required with stimulus.\n");
+      return false;
+    }
+    if (config->stimulus == "sweep" &&
+        (config->min_frequency <= 0 ||
+         config->max_frequency > config->sample_rate / 2)) {
+      fprintf(stderr,
+              "Range error: a sweep must be within (0, sample rate / 2]\n");
+      return false;
+    }
+  }
+
+  if (config->pilot_frequency != 0) {
+    if (!config->stimulus.empty()) {
+      fprintf(stderr, "pilot and stimulus cannot be played together.\n");
+      return false;
+    }
+    if (config->pilot_frequency < 0 ||
+        config->pilot_frequency >= config->sample_rate / 2.0) {
+      fprintf(stderr,
+              "Range error: a pilot must be within (0, sample rate / 2)\n");
+      return false;
+    }
+  }
+
+  if (config->spectrogram_decimation < 1) {
+    fprintf(stderr, "Spectrogram decimation must be positive.\n");
     return false;
   }
 
@@ -178,6 +339,18 @@ bool ParseOptions(int argc, char *const argv[], AudioFunTestConfig *config) {
     }
   }
 
+  if (config->hop_size == 0)
+    config->hop_size = config->fft_size;
+  if (config->hop_size < 0 || config->hop_size > config->fft_size ||
+      config->fft_size % config->hop_size) {
+    fprintf(stderr, "Hop size must be a divisor of FFT size.\n");
+    return false;
+  }
+
+  // Each active speaker channel plays its own carrier.
+  if (config->channel_matrix)
+    config->num_carriers = config->active_speaker_channels.size();
+
   if (config->min_frequency > config->max_frequency) {
     fprintf(stderr, "Range error: min_frequency > max_frequency\n");
     return false;
@@ -187,6 +360,23 @@ bool ParseOptions(int argc, char *const argv[], AudioFunTestConfig *config) {
     fprintf(stderr, "Range error: min_frequency < 0\n");
     return false;
   }
+
+  // Each carrier is picked from its own sub band, which must be wide enough to
+  // keep other carriers out of its match window. A single carrier has no
+  // other carrier to keep out.
+  if (config->num_carriers == 1)
+    return true;
+  const double frequency_resolution =
+      static_cast<double>(config->sample_rate) / config->fft_size;
+  const int num_bins = static_cast<int>(
+      config->max_frequency / frequency_resolution) -
+      static_cast<int>(config->min_frequency / frequency_resolution) + 1;
+  if (num_bins / config->num_carriers < config->match_window_size) {
+    fprintf(stderr,
+            "Range error: frequency range is too narrow for %d carriers\n",
+            config->num_carriers);
+    return false;
+  }
   return true;
 }
 
@@ -194,8 +384,10 @@ void PrintUsage(const char *name, FILE *fd = stderr) {
   AudioFunTestConfig default_config;
 
   fprintf(fd,
-          "Usage %s -P <player_command> -R <recorder_command> [options]\n",
-          name);
+          "Usage %s -P <player_command> -R <recorder_command> [options]\n"
+          "      %s -I <input_file> -S <rounds_file> [options]\n"
+          "      %s -I <input_file> -s sweep [options]\n",
+          name, name, name);
   fprintf(fd,
           "\t-a, --active-speaker-channels:\n"
           "\t\tComma-separated list of speaker channels to play on. "
@@ -244,8 +436,14 @@ void PrintUsage(const char *name, FILE *fd = stderr) {
   fprintf(fd,
           "\t-t, --sample-format:\n"
           "\t\tFormat of recording & playing samples, should be one of u8, "
-          "s16, s24, s32."
+          "s16, s24, s24_32, s32, float."
           "(def %s).\n", default_config.sample_format.to_string());
+  fprintf(fd,
+          "\t-E, --dither:\n"
+          "\t\tAdd TPDF dither of +-1 LSB to the played integer samples, "
+          "which turns their quantization error into white noise. Dithered "
+          "tones are generated live rather than repeated from a cached "
+          "period.\n");
   fprintf(fd,
           "\t-c, --num-mic-channels:\n"
           "\t\tThe number of microphone channels "
@@ -274,6 +472,106 @@ void PrintUsage(const char *name, FILE *fd = stderr) {
           "\t-x, --max-frequency\n"
           "\t\tThe maximum frequency of generated audio frames."
           "(def %d)\n", default_config.max_frequency);
+  fprintf(fd,
+          "\t-k, --num-carriers:\n"
+          "\t\tNumber of carriers played and evaluated at the same time in "
+          "each round. Carriers are picked from equal sub bands of the "
+          "frequency range. (def %d)\n", default_config.num_carriers);
+  fprintf(fd,
+          "\t-M, --channel-matrix:\n"
+          "\t\tPlay a different carrier on each active speaker channel and "
+          "report the power of each speaker channel in each mic channel. "
+          "Overrides --num-carriers.\n");
+  fprintf(fd,
+          "\t-W, --window:\n"
+          "\t\tWindow function of FFT frames, should be one of rectangular, "
+          "hann, blackman-harris. (def %s)\n",
+          default_config.window.to_string());
+  fprintf(fd,
+          "\t-H, --hop-size:\n"
+          "\t\tFrames between the starts of consecutive FFT frames. Should "
+          "be a divisor of fftsize. Smaller hop size overlaps frames and "
+          "evaluates more often. (def fftsize)\n");
+  fprintf(fd,
+          "\t-p, --single-precision:\n"
+          "\t\tAnalyze the recorded audio in float instead of double. It "
+          "is faster and accurate enough for up to 24-bit captures.\n");
+  fprintf(fd,
+          "\t-D, --distortion:\n"
+          "\t\tReport the THD (harmonics 2 ~ %d), THD+N (all but the match "
+          "windows of the carriers) and SNR of each carrier in each mic "
+          "channel, from the full spectrum of the decision trial of each "
+          "round. The noise floor of the SNR is measured over %d trials "
+          "before the first round.\n",
+          Evaluator::kMaxHarmonic, Evaluator::kNoiseTrials);
+  fprintf(fd,
+          "\t-G, --glitches:\n"
+          "\t\tReport the dropped, repeated or corrupted samples in each mic "
+          "channel, found as phase discontinuities of the carriers in the "
+          "blocks evaluated in each round, with the time of the first %d "
+          "from the start of the round.\n",
+          GlitchDetector::kMaxGlitchFrames);
+  fprintf(fd,
+          "\t-I, --input-file:\n"
+          "\t\tEvaluate a recorded WAV or raw file instead of playing and "
+          "recording. A raw file is read with the sample format, rate and "
+          "mic channels options. Requires --rounds-file, or --stimulus "
+          "sweep to analyze the recording of a sweep played with the same "
+          "tone length, frequency range and volume gain, or --pilot to "
+          "track a pilot in the recording, or --spectrogram to only write "
+          "its spectrogram.\n");
+  fprintf(fd,
+          "\t-S, --rounds-file:\n"
+          "\t\tFile of the carriers of each round, one round per line as "
+          "\"[@start_frame] bin [bin ...]\". It is read with --input-file "
+          "and written otherwise, so a session recorded with e.g. tee can be "
+          "replayed. Without a start frame, a round starts right after the "
+          "decision of the previous one.\n");
+  fprintf(fd,
+          "\t-s, --stimulus:\n"
+          "\t\tPlay a broadband signal once instead of the carrier rounds, "
+          "and write everything recorded meanwhile to --capture-file. Should "
+          "be one of sweep (exponential, from min to max frequency), white, "
+          "pink (noise) or mls (maximum length sequence). It plays for the "
+          "tone length, and the recording lasts the allowed delay longer. "
+          "The recording of a sweep is deconvolved into the impulse "
+          "response of each mic channel, from which the latency, the octave "
+          "band frequency response and the harmonic distortion are "
+          "reported.\n");
+  fprintf(fd,
+          "\t-O, --capture-file:\n"
+          "\t\tRaw file of the recording of --stimulus, in the sample "
+          "format, rate and mic channels of the recording. Blocks dropped by "
+          "the recorder are written as silence, so it stays aligned in "
+          "time.\n");
+  fprintf(fd,
+          "\t-L, --pilot:\n"
+          "\t\tPlay a pilot tone of the given frequency(Hz) for the tone "
+          "length instead of the carrier rounds, 20 dB below the volume "
+          "gain. Its phase is tracked in each mic channel block by block, "
+          "without storing the recording, and the drift of the playback "
+          "clock relative to the capture clock(ppm) and the RMS jitter of "
+          "the phase about the drift(us) are reported.\n");
+  fprintf(fd,
+          "\t-Y, --spectrogram:\n"
+          "\t\tWrite the log-magnitude spectrogram of each active mic "
+          "channel while it is recorded, of the evaluated blocks of the "
+          "rounds, of the recording of --stimulus or --pilot, or of the "
+          "whole --input-file. The channel is inserted before the "
+          "extension of the path, e.g. spec_0.pgm. A .pgm path writes a "
+          "binary PGM image, from -120 dB (black) to 0 dB (white) relative "
+          "to a full scale sine, and other paths a gnuplot nonuniform "
+          "matrix in dB. The columns are Hann windowed FFT bins, grouped "
+          "into at most %d columns by their peak.\n",
+          Spectrogram::kMaxColumns);
+  fprintf(fd,
+          "\t-y, --spectrogram-decimation:\n"
+          "\t\tNumber of FFT frames, hop size apart, averaged into a row of "
+          "the spectrogram. (def %d)\n", default_config.spectrogram_decimation);
+  fprintf(fd,
+          "\t-z, --seed:\n"
+          "\t\tSeed of noise and MLS stimuli, which repeat exactly for a "
+          "seed. (def %u)\n", default_config.seed);
 
   fprintf(fd,
           "\t-v, --verbose: Show debugging information.\n");
@@ -309,6 +607,8 @@ void PrintConfig(const AudioFunTestConfig &config, FILE *fd = stdout) {
   fprintf(fd, "\tRecorder parameter: %s\n", config.recorder_command.c_str());
   fprintf(fd, "\tRecorder FIFO name: %s\n", config.recorder_fifo.c_str());
   fprintf(fd, "\tSample format: %s\n", config.sample_format.to_string());
+  if (config.dither)
+    fprintf(fd, "\t** Dither **.\n");
   fprintf(fd, "\tSample rate: %d\n", config.sample_rate);
   fprintf(fd,
           "\tNumber of Microphone channels: %d\n", config.num_mic_channels);
@@ -319,11 +619,90 @@ void PrintConfig(const AudioFunTestConfig &config, FILE *fd = stdout) {
   fprintf(fd, "\tVolume gain: %d\n", config.volume_gain);
   fprintf(fd, "\tMinimum frequency: %d\n", config.min_frequency);
   fprintf(fd, "\tMaximum frequency: %d\n", config.max_frequency);
+  fprintf(fd, "\tNumber of carriers: %d\n", config.num_carriers);
+  if (config.channel_matrix)
+    fprintf(fd, "\t** Channel matrix **.\n");
+  fprintf(fd, "\tWindow: %s\n", config.window.to_string());
+  fprintf(fd, "\tHop size: %d\n", config.hop_size);
+  fprintf(fd, "\tPrecision: %s\n",
+          config.single_precision ? "float" : "double");
+  if (config.distortion)
+    fprintf(fd, "\t** Distortion **.\n");
+  if (config.glitches)
+    fprintf(fd, "\t** Glitches **.\n");
+  if (!config.input_file.empty())
+    fprintf(fd, "\tInput file: %s\n", config.input_file.c_str());
+  if (!config.rounds_file.empty())
+    fprintf(fd, "\tRounds file: %s\n", config.rounds_file.c_str());
+  if (!config.stimulus.empty()) {
+    fprintf(fd, "\tStimulus: %s, seed %u\n", config.stimulus.c_str(),
+            config.seed);
+    fprintf(fd, "\tCapture file: %s\n", config.capture_file.c_str());
+  }
+  if (config.pilot_frequency != 0)
+    fprintf(fd, "\tPilot: %.2f(Hz)\n", config.pilot_frequency);
+  if (!config.spectrogram_file.empty()) {
+    fprintf(fd, "\tSpectrogram: %s, decimation %d\n",
+            config.spectrogram_file.c_str(), config.spectrogram_decimation);
+  }
 
   if (config.verbose)
     fprintf(fd, "\t** Verbose **.\n");
 }
 
+// Carriers of a round of a recorded session.
+struct Round {
+  // Frame of the recording where the round starts, or -1 to start right after
+  // the decision of the previous round.
+  long long start_frame;
+  std::vector<int> bins;
+};
+
+// Reads the rounds file at |path|. Each line is a round of whitespace
+// separated carrier bins, optionally led by "@start_frame". Empty lines and
+// lines starting with '#' are skipped.
+bool ReadRounds(const char *path, std::vector<Round> *rounds) {
+  FILE *fp = fopen(path, "r");
+  if (!fp) {
+    perror(path);
+    return false;
+  }
+  char line[1024];
+  int line_number = 0;
+  bool ok = true;
+  while (ok && fgets(line, sizeof(line), fp)) {
+    ++line_number;
+    Round round;
+    round.start_frame = -1;
+    char *saveptr;
+    for (char *token = strtok_r(line, " \t\r\n", &saveptr); token;
+         token = strtok_r(NULL, " \t\r\n", &saveptr)) {
+      if (token[0] == '#')
+        break;
+      char *end;
+      if (token[0] == '@' && round.bins.empty()) {
+        round.start_frame = strtoll(token + 1, &end, 10);
+      } else {
+        round.bins.push_back(strtol(token, &end, 10));
+      }
+      if (*end != '\0' || round.start_frame < -1) {
+        fprintf(stderr, "%s:%d: invalid token %s\n", path, line_number,
+                token);
+        ok = false;
+        break;
+      }
+    }
+    if (!round.bins.empty())
+      rounds->push_back(round);
+  }
+  fclose(fp);
+  if (ok && rounds->empty()) {
+    fprintf(stderr, "%s: no rounds.\n", path);
+    ok = false;
+  }
+  return ok;
+}
+
 // Randomly picks an integer from the given range [min, max],
 // including both end points.
 inline int RandomPick(int min, int max) {
@@ -336,57 +715,549 @@ inline int RandomPick(int min, int max) {
   return (rand_r(&seed) % (max - min + 1)) + min;
 }
 
+// Picks |num_carriers| bins from [min_bin, max_bin]. The range is split into
+// equal sub bands and one bin is picked from each of them, keeping adjacent
+// carriers at least |match_window_size| bins apart so that they stay out of
+// the match window of each other.
+std::vector<int> PickCarriers(int min_bin, int max_bin, int num_carriers,
+                              int match_window_size) {
+  const int band = (max_bin - min_bin + 1) / num_carriers;
+  const int half_window_size = match_window_size / 2;
+  std::vector<int> bins(num_carriers);
+  for (int i = 0; i < num_carriers; ++i) {
+    int low = min_bin + i * band;
+    int high = low + band - 1;
+    if (i > 0)
+      low += half_window_size;
+    if (i < num_carriers - 1)
+      high -= half_window_size;
+    else
+      high = max_bin;
+    bins[i] = RandomPick(low, high);
+  }
+  return bins;
+}
+
+// Prints the power of each carrier in each active mic channel, where carrier i
+// is played by speaker channel |speaker_channels|[i]. "O" marks the pairs
+// which pass the evaluation.
+void PrintChannelMatrix(const AudioFunTestConfig &config,
+                        const Evaluator &evaluator,
+                        const std::vector<int> &speaker_channels,
+                        const std::vector<std::vector<bool> > &pass) {
+  printf("speaker \\ mic power(dB):");
+  for (auto c : config.active_mic_channels)
+    printf("%12d", c);
+  printf("\n");
+  for (size_t i = 0; i < speaker_channels.size(); ++i) {
+    printf("%25d", speaker_channels[i]);
+    for (auto c : config.active_mic_channels) {
+      const double power = evaluator.carrier_power(i, c);
+      printf("  %s %8.2f", pass[i][c] ? "O" : "X",
+             power > 0 ? 10 * log10(power) : -INFINITY);
+    }
+    printf("\n");
+  }
+}
+
+// Prints the distortion of |carrier| in each active mic channel.
+void PrintDistortion(const AudioFunTestConfig &config,
+                     const Evaluator &evaluator,
+                     int carrier) {
+  for (auto c : config.active_mic_channels) {
+    const Evaluator::Distortion distortion = evaluator.distortion(carrier, c);
+    printf("   channel = %d, THD = %.2f dB, THD+N = %.2f dB, ", c,
+           distortion.thd_db, distortion.thd_n_db);
+    // The SNR is not known without a noise floor, as in replay.
+    if (isnan(distortion.snr_db))
+      printf("SNR = n/a\n");
+    else
+      printf("SNR = %.2f dB\n", distortion.snr_db);
+  }
+}
+
+// Prints the glitches found in each active mic channel.
+void PrintGlitches(const AudioFunTestConfig &config,
+                   const Evaluator &evaluator) {
+  const GlitchDetector &detector = evaluator.glitch_detector();
+  printf("glitches:\n");
+  for (auto c : config.active_mic_channels) {
+    printf("   channel = %d, count = %d", c, detector.glitch_count(c));
+    const std::vector<uint64_t> &frames = detector.glitch_frames(c);
+    if (!frames.empty()) {
+      printf(", at");
+      for (uint64_t frame : frames)
+        printf(" %.6f", static_cast<double>(frame) / config.sample_rate);
+      printf("(s)");
+    }
+    printf("\n");
+  }
+}
+
+// Prints the result of a round and accumulates it into |passes| and
+// |num_tests|.
+void PrintRound(const AudioFunTestConfig &config,
+                const Evaluator &evaluator,
+                const std::vector<int> &bins,
+                const std::vector<int> &speaker_channels,
+                const std::vector<std::vector<bool> > &single_round_pass,
+                std::vector<int> *passes,
+                int *num_tests) {
+  printf("decision time = %.4f(s), audio = %.4f(s)\n",
+         evaluator.decision_time(), evaluator.decision_audio_time());
+
+  if (config.channel_matrix) {
+    printf("carriers =");
+    for (size_t i = 0; i < bins.size(); ++i)
+      printf(" %d(speaker %d)", bins[i], speaker_channels[i]);
+    printf("\n");
+    PrintChannelMatrix(config, evaluator, speaker_channels,
+                       single_round_pass);
+    if (config.distortion) {
+      for (size_t i = 0; i < bins.size(); ++i) {
+        printf("distortion of speaker %d:\n", speaker_channels[i]);
+        PrintDistortion(config, evaluator, i);
+      }
+    }
+    if (config.glitches)
+      PrintGlitches(config, evaluator);
+    return;
+  }
+
+  for (size_t i = 0; i < bins.size(); ++i) {
+    ++*num_tests;
+    for (int chn = 0; chn < config.num_mic_channels; ++chn) {
+      if (single_round_pass[i][chn]) {
+        ++(*passes)[chn];
+      }
+    }
+
+    printf("carrier = %d\n", bins[i]);
+    for (auto c : config.active_mic_channels) {
+      const char *res = single_round_pass[i][c] ? "O" : "X";
+      const int pass = (*passes)[c];
+      printf("%s: channel = %d, success = %d, fail = %d, rate = %.4f\n",
+             res, c, pass, *num_tests - pass, 100.0 * pass / *num_tests);
+    }
+    if (config.distortion) {
+      printf("distortion:\n");
+      PrintDistortion(config, evaluator, i);
+    }
+  }
+  if (config.glitches)
+    PrintGlitches(config, evaluator);
+}
+
 // Controls the main process of audiofuntest.
 void ControlLoop(const AudioFunTestConfig &config,
                  Evaluator *evaluator,
                  PlayClient *player,
-                 RecordClient *recorder) {
+                 CaptureThread *capture) {
   const double frequency_resolution =
       static_cast<double>(config.sample_rate) / config.fft_size;
   const int min_bin = config.min_frequency / frequency_resolution;
   const int max_bin = config.max_frequency / frequency_resolution;
 
   std::vector<int> passes(config.num_mic_channels);
-  std::vector<bool> single_round_pass(config.num_mic_channels);
+  std::vector<std::vector<bool> > single_round_pass(
+      config.num_carriers, std::vector<bool>(config.num_mic_channels));
+  int num_tests = 0;
 
   size_t buf_size = config.fft_size * config.num_speaker_channels *
       config.sample_format.bytes();
-  SineWaveGenerator generator(
+  SineWaveGenerator sine_generator(
+      config.sample_rate,
+      config.tone_length_sec,
+      config.volume_gain);
+  ChannelSineWaveGenerator channel_generator(
       config.sample_rate,
       config.tone_length_sec,
       config.volume_gain);
+  const std::vector<int> speaker_channels(
+      config.active_speaker_channels.begin(),
+      config.active_speaker_channels.end());
+  // MultiToneGenerator averages tones generated at half of the full scale, so
+  // its volume is doubled to match the volume gain.
+  MultiToneGenerator multi_tone_generator(
+      config.sample_rate,
+      config.tone_length_sec);
+  multi_tone_generator.SetVolumes(config.volume_gain / 50.0,
+                                  config.volume_gain / 50.0);
   GeneratorPlayer generatorPlayer(
       buf_size,
       config.num_speaker_channels,
       config.active_speaker_channels,
       config.sample_format,
+      config.dither,
       player);
 
-  for (int round = 1; round <= config.test_rounds; ++round) {
-    std::fill(single_round_pass.begin(), single_round_pass.end(), false);
-    int bin = RandomPick(min_bin, max_bin);
-    double frequency = bin * frequency_resolution;
+  // Start frames in the rounds file count from the first recorded frame.
+  FILE *rounds_file = NULL;
+  if (!config.rounds_file.empty()) {
+    rounds_file = fopen(config.rounds_file.c_str(), "w");
+    if (!rounds_file) {
+      perror(config.rounds_file.c_str());
+      exit(EXIT_FAILURE);
+    }
+  }
 
-    generator.Reset(frequency);
-    generatorPlayer.Play(&generator);
+  // The noise floor is recorded while silence plays, so it includes the
+  // noise of the playback path.
+  if (config.distortion) {
+    SineWaveGenerator silence(config.sample_rate, config.tone_length_sec, 0);
+    silence.Reset(0.0);
+    generatorPlayer.Play(&silence);
+    evaluator->MeasureNoise(capture);
+    generatorPlayer.Stop();
+  }
 
-    evaluator->Evaluate(bin, recorder, &single_round_pass);
-    for (int chn = 0; chn < config.num_mic_channels; ++chn) {
-      if (single_round_pass[chn]) {
-        ++passes[chn];
-      }
+  for (int round = 1; round <= config.test_rounds; ++round) {
+    for (auto &pass : single_round_pass)
+      std::fill(pass.begin(), pass.end(), false);
+    std::vector<int> bins = PickCarriers(min_bin, max_bin, config.num_carriers,
+                                         config.match_window_size);
+    std::vector<double> frequencies(bins.size());
+    for (size_t i = 0; i < bins.size(); ++i)
+      frequencies[i] = bins[i] * frequency_resolution;
+
+    if (config.channel_matrix) {
+      std::vector<double> channel_frequencies(config.num_speaker_channels);
+      for (size_t i = 0; i < speaker_channels.size(); ++i)
+        channel_frequencies[speaker_channels[i]] = frequencies[i];
+      channel_generator.Reset(channel_frequencies);
+      generatorPlayer.Play(&channel_generator);
+    } else if (config.num_carriers == 1) {
+      sine_generator.Reset(frequencies[0]);
+      generatorPlayer.Play(&sine_generator);
+    } else {
+      multi_tone_generator.Reset(frequencies, true);
+      generatorPlayer.Play(&multi_tone_generator);
     }
+
+    evaluator->Evaluate(bins, capture, &single_round_pass);
     generatorPlayer.Stop();
+    if (rounds_file) {
+      fprintf(rounds_file, "@%llu",
+              static_cast<unsigned long long>(evaluator->start_sequence() *
+                                              config.hop_size));
+      for (int bin : bins)
+        fprintf(rounds_file, " %d", bin);
+      fprintf(rounds_file, "\n");
+    }
+    PrintRound(config, *evaluator, bins, speaker_channels, single_round_pass,
+               &passes, &num_tests);
+  }
+  if (rounds_file)
+    fclose(rounds_file);
 
-    printf("carrier = %d\n", bin);
-    for (auto c : config.active_mic_channels) {
-      const char *res = single_round_pass[c] ? "O" : "X";
-      printf("%s: channel = %d, success = %d, fail = %d, rate = %.4f\n",
-             res, c, passes[c], round - passes[c], 100.0 * passes[c] / round);
+  if (config.verbose) {
+    const ToneCache &cache = generatorPlayer.cache();
+    const double audio_seconds =
+        static_cast<double>(cache.frames()) / config.sample_rate;
+    if (audio_seconds > 0) {
+      printf("Tone generation: %.3f ms CPU per second, %.1f%% cached.\n",
+             1000 * cache.cpu_seconds() / audio_seconds,
+             100.0 * cache.cached_frames() / cache.frames());
     }
   }
 }
 
+// Plays |first| and then |second|.
+class SequenceGenerator : public ToneGenerator {
+ public:
+  SequenceGenerator(ToneGenerator *first, ToneGenerator *second)
+      : first_(first), second_(second) {}
+
+  virtual size_t GetFrames(SampleFormat format,
+                           const std::vector<double> &channel_gains,
+                           void *data,
+                           size_t buf_size,
+                           TpdfDither *dither) {
+    return current()->GetFrames(format, channel_gains, data, buf_size,
+                                dither);
+  }
+  virtual bool HasMoreFrames() const {
+    return first_->HasMoreFrames() || second_->HasMoreFrames();
+  }
+  virtual Period GetPeriod() const {
+    Period period = current()->GetPeriod();
+    // Both generators count their serials from 0.
+    period.serial = period.serial * 2 + (current() == second_);
+    return period;
+  }
+  virtual void Skip(int num_frames) { current()->Skip(num_frames); }
+
+ private:
+  ToneGenerator *current() const {
+    return first_->HasMoreFrames() ? first_ : second_;
+  }
+
+  ToneGenerator *first_;
+  ToneGenerator *second_;
+};
+
+// Returns the generator of |config.stimulus|, played at the volume gain.
+std::unique_ptr<ToneGenerator> CreateStimulus(
+    const AudioFunTestConfig &config) {
+  std::unique_ptr<ToneGenerator> generator;
+  if (config.stimulus == "sweep") {
+    generator.reset(new SweepGenerator(
+        config.sample_rate, config.tone_length_sec, config.min_frequency,
+        config.max_frequency, config.volume_gain));
+  } else if (config.stimulus == "mls") {
+    generator.reset(new MlsGenerator(config.sample_rate,
+                                     config.tone_length_sec, 0, config.seed,
+                                     config.volume_gain));
+  } else {
+    generator.reset(new NoiseGenerator(
+        config.sample_rate, config.tone_length_sec,
+        config.stimulus == "pink" ? NoiseGenerator::kPink
+                                  : NoiseGenerator::kWhite,
+        config.seed, config.volume_gain));
+  }
+  return generator;
+}
+
+// Plays |config.stimulus| once and writes every block recorded from its start
+// until the allowed delay after its end into |config.capture_file|, and into
+// |spectrogram| if not NULL.
+void StimulusLoop(const AudioFunTestConfig &config,
+                  PlayClient *player,
+                  CaptureThread *capture,
+                  Spectrogram *spectrogram) {
+  FILE *capture_file = fopen(config.capture_file.c_str(), "wb");
+  if (!capture_file) {
+    perror(config.capture_file.c_str());
+    exit(EXIT_FAILURE);
+  }
+  // The stimulus is followed by silence until the recording ends, so the
+  // response dies away instead of the player running dry.
+  std::unique_ptr<ToneGenerator> stimulus = CreateStimulus(config);
+  const int margin_frames = 2 * config.hop_size;
+  SineWaveGenerator silence(
+      config.sample_rate,
+      config.allowed_delay_sec +
+          static_cast<double>(margin_frames) / config.sample_rate,
+      0);
+  silence.Reset(0.0);
+  SequenceGenerator generator(stimulus.get(), &silence);
+  GeneratorPlayer generator_player(
+      config.fft_size * config.num_speaker_channels *
+          config.sample_format.bytes(),
+      config.num_speaker_channels,
+      config.active_speaker_channels,
+      config.sample_format,
+      config.dither,
+      player);
+
+  const size_t block_size = capture->block_size();
+  const uint64_t num_blocks = ceil(
+      (config.tone_length_sec + config.allowed_delay_sec) *
+      config.sample_rate / config.hop_size);
+  const std::vector<uint8_t> silent_block(block_size);
+  uint64_t sequence = capture->latest_sequence();
+  uint64_t dropped = 0;
+  generator_player.Play(&generator);
+  for (uint64_t written = 0; written < num_blocks; ++written) {
+    const BlockSource::Block *block = capture->Acquire(sequence);
+    // A block the recorder replaced before it was acquired becomes silence.
+    for (; sequence + 1 < block->sequence && written < num_blocks;
+         ++sequence, ++written, ++dropped)
+      fwrite(silent_block.data(), 1, block_size, capture_file);
+    if (written < num_blocks) {
+      fwrite(block->data, 1, block_size, capture_file);
+      if (spectrogram)
+        spectrogram->AddFrames(block->data, written * config.hop_size);
+    }
+    sequence = block->sequence;
+    capture->Release(block);
+  }
+  generator_player.Stop();
+  fclose(capture_file);
+
+  printf("stimulus = %s, captured %llu frames into %s, dropped blocks = "
+         "%llu\n", config.stimulus.c_str(),
+         static_cast<unsigned long long>(num_blocks * config.hop_size),
+         config.capture_file.c_str(),
+         static_cast<unsigned long long>(dropped));
+}
+
+// Tracks the pilot of |config| in up to |max_blocks| blocks of |source| after
+// its latest block, and prints the level, drift and jitter of the pilot in
+// each active mic channel. The blocks are also written into |spectrogram| if
+// not NULL.
+void TrackPilot(const AudioFunTestConfig &config,
+                BlockSource *source,
+                uint64_t max_blocks,
+                Spectrogram *spectrogram) {
+  PilotTracker tracker(config.sample_rate, config.num_mic_channels,
+                       config.hop_size, config.sample_format,
+                       config.pilot_frequency);
+  const uint64_t start_sequence = source->latest_sequence();
+  uint64_t sequence = start_sequence;
+  while (sequence - start_sequence < max_blocks) {
+    const BlockSource::Block *block = source->Acquire(sequence);
+    if (!block)
+      break;
+    // Skipped blocks leave a gap in the phase but keep the frames in place.
+    sequence = block->sequence;
+    const uint64_t first_frame =
+        (sequence - start_sequence - 1) * config.hop_size;
+    tracker.AddFrames(block->data, first_frame);
+    if (spectrogram)
+      spectrogram->AddFrames(block->data, first_frame);
+    source->Release(block);
+  }
+
+  for (auto c : config.active_mic_channels) {
+    if (tracker.num_blocks(c) == 0) {
+      printf("pilot: channel = %d, not found\n", c);
+      continue;
+    }
+    printf("pilot: channel = %d, blocks = %d, level = %.2f dBFS, "
+           "drift = %.3f ppm, jitter = %.3f us\n",
+           c, tracker.num_blocks(c), 20 * log10(tracker.amplitude(c)),
+           tracker.drift_ppm(c), 1e6 * tracker.jitter_sec(c));
+  }
+}
+
+// Plays the pilot of |config| for the tone length and tracks it in the blocks
+// recorded meanwhile.
+void PilotLoop(const AudioFunTestConfig &config,
+               PlayClient *player,
+               CaptureThread *capture,
+               Spectrogram *spectrogram) {
+  // The pilot plays low enough to stay in the linear range of the path. It is
+  // followed by silence, so the player does not run dry before the last
+  // tracked block is recorded.
+  SineWaveGenerator pilot(config.sample_rate, config.tone_length_sec,
+                          std::max(config.volume_gain / 10, 1));
+  pilot.Reset(config.pilot_frequency);
+  const int margin_frames = 2 * config.hop_size;
+  SineWaveGenerator silence(
+      config.sample_rate,
+      config.allowed_delay_sec +
+          static_cast<double>(margin_frames) / config.sample_rate,
+      0);
+  silence.Reset(0.0);
+  SequenceGenerator generator(&pilot, &silence);
+  GeneratorPlayer generator_player(
+      config.fft_size * config.num_speaker_channels *
+          config.sample_format.bytes(),
+      config.num_speaker_channels,
+      config.active_speaker_channels,
+      config.sample_format,
+      config.dither,
+      player);
+
+  generator_player.Play(&generator);
+  TrackPilot(config, capture,
+             config.tone_length_sec * config.sample_rate / config.hop_size,
+             spectrogram);
+  generator_player.Stop();
+}
+
+// Writes the spectrogram of the whole recording at |path| into
+// |config.spectrogram_file|, a block at a time. Returns false if a file
+// cannot be opened.
+bool WriteSpectrogram(const AudioFunTestConfig &config, const char *path) {
+  AudioFile file;
+  if (!file.Open(path, config.sample_format, config.sample_rate,
+                 config.num_mic_channels))
+    return false;
+  Spectrogram spectrogram(config.sample_rate, config.num_mic_channels,
+                          config.fft_size, config.hop_size,
+                          config.sample_format,
+                          config.spectrogram_decimation);
+  if (!spectrogram.Open(config.spectrogram_file, config.active_mic_channels))
+    return false;
+  FileSource source(config.hop_size * file.frame_bytes(), &file);
+  uint64_t first_frame = 0;
+  while (const BlockSource::Block *block =
+             source.Acquire(source.latest_sequence())) {
+    spectrogram.AddFrames(block->data, first_frame);
+    first_frame += config.hop_size;
+  }
+  spectrogram.Close();
+  printf("spectrogram: %llu rows written to %s\n",
+         static_cast<unsigned long long>(spectrogram.num_rows()),
+         config.spectrogram_file.c_str());
+  return true;
+}
+
+// Deconvolves the recording of the sweep of |config| at |path| and prints the
+// latency, frequency response and harmonic distortion of each active mic
+// channel. Returns false if a channel has no response.
+bool AnalyzeSweep(const AudioFunTestConfig &config, const char *path) {
+  AudioFile file;
+  if (!file.Open(path, config.sample_format, config.sample_rate,
+                 config.num_mic_channels))
+    return false;
+  const int num_frames = file.data_size() / file.frame_bytes();
+  std::vector<std::vector<double> > samples(
+      config.num_mic_channels, std::vector<double>(num_frames));
+  std::vector<double *> planes;
+  for (auto &channel : samples)
+    planes.push_back(channel.data());
+  Deinterleave(file.data(), num_frames, config.sample_format,
+               config.num_mic_channels, planes.data());
+
+  SweepAnalyzer analyzer(config.sample_rate, config.tone_length_sec,
+                         config.min_frequency, config.max_frequency,
+                         config.volume_gain, num_frames);
+  SweepAnalyzer::Result result;
+  bool found = true;
+  for (int channel : config.active_mic_channels) {
+    if (!analyzer.Analyze(samples[channel].data(), num_frames, &result)) {
+      printf("sweep: channel = %d, no response\n", channel);
+      found = false;
+      continue;
+    }
+    printf("sweep: channel = %d, latency = %.3f ms\n", channel,
+           1000 * result.latency_sec);
+    printf("\tresponse (dB):");
+    for (size_t i = 0; i < result.band_frequencies.size(); ++i) {
+      printf(" %.0f Hz %.2f", result.band_frequencies[i],
+             result.response_db[i]);
+    }
+    printf("\n\tharmonics (dB):");
+    for (size_t i = 0; i < result.harmonic_db.size(); ++i)
+      printf(" H%zu %.2f", i + 2, result.harmonic_db[i]);
+    printf("\n");
+  }
+  return found;
+}
+
+// Evaluates the rounds recorded in |source| without playing anything, as fast
+// as the evaluator can go.
+void ReplayLoop(const AudioFunTestConfig &config,
+                Evaluator *evaluator,
+                FileSource *source,
+                const std::vector<Round> &rounds) {
+  std::vector<int> passes(config.num_mic_channels);
+  std::vector<std::vector<bool> > single_round_pass(
+      config.num_carriers, std::vector<bool>(config.num_mic_channels));
+  int num_tests = 0;
+  const std::vector<int> speaker_channels(
+      config.active_speaker_channels.begin(),
+      config.active_speaker_channels.end());
+
+  const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  for (const Round &round : rounds) {
+    for (auto &pass : single_round_pass)
+      std::fill(pass.begin(), pass.end(), false);
+    if (round.start_frame >= 0)
+      source->Seek(round.start_frame);
+    evaluator->Evaluate(round.bins, source, &single_round_pass);
+    PrintRound(config, *evaluator, round.bins, speaker_channels,
+               single_round_pass, &passes, &num_tests);
+  }
+  const double elapsed = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+  printf("replayed %zu rounds in %.4f(s)\n", rounds.size(), elapsed);
+}
+
 int main(int argc, char *argv[]) {
   // Parses configuration.ParamConfig
   AudioFunTestConfig config;
@@ -395,22 +1266,117 @@ int main(int argc, char *argv[]) {
     return 1;
   }
 
+  // A recording is written into the spectrogram in a pass of its own, before
+  // it is analyzed.
+  if (!config.input_file.empty() && !config.spectrogram_file.empty()) {
+    const bool is_analyzed = !config.stimulus.empty() ||
+                             config.pilot_frequency != 0 ||
+                             !config.rounds_file.empty();
+    if (!is_analyzed)
+      PrintConfig(config);
+    if (!WriteSpectrogram(config, config.input_file.c_str()))
+      return 1;
+    if (!is_analyzed)
+      return 0;
+  }
+
+  if (!config.input_file.empty() && !config.stimulus.empty()) {
+    PrintConfig(config);
+    return AnalyzeSweep(config, config.input_file.c_str()) ? 0 : 1;
+  }
+
+  if (!config.input_file.empty() && config.pilot_frequency != 0) {
+    PrintConfig(config);
+    AudioFile file;
+    if (!file.Open(config.input_file.c_str(), config.sample_format,
+                   config.sample_rate, config.num_mic_channels))
+      return 1;
+    FileSource source(config.hop_size * file.frame_bytes(), &file);
+    TrackPilot(config, &source, UINT64_MAX, NULL);
+    return 0;
+  }
+
+  if (!config.input_file.empty()) {
+    std::vector<Round> rounds;
+    if (!ReadRounds(config.rounds_file.c_str(), &rounds))
+      return 1;
+    // A channel matrix round plays one carrier per active speaker channel.
+    if (config.channel_matrix) {
+      const size_t num_speakers = config.active_speaker_channels.size();
+      for (size_t i = 0; i < rounds.size(); ++i) {
+        if (rounds[i].bins.size() != num_speakers) {
+          fprintf(stderr, "%s:%zu: expected %zu carriers\n",
+                  config.rounds_file.c_str(), i + 1, num_speakers);
+          return 1;
+        }
+      }
+    }
+    // The evaluator is sized for the round with the most carriers.
+    for (const Round &round : rounds) {
+      config.num_carriers =
+          std::max<int>(config.num_carriers, round.bins.size());
+    }
+    PrintConfig(config);
+
+    AudioFile file;
+    if (!file.Open(config.input_file.c_str(), config.sample_format,
+                   config.sample_rate, config.num_mic_channels))
+      return 1;
+    FileSource source(config.hop_size * file.frame_bytes(), &file);
+    Evaluator evaluator(config);
+    ReplayLoop(config, &evaluator, &source, rounds);
+    return 0;
+  }
+
   PrintConfig(config);
 
+  std::unique_ptr<Spectrogram> spectrogram;
+  if (!config.spectrogram_file.empty()) {
+    spectrogram.reset(new Spectrogram(
+        config.sample_rate, config.num_mic_channels, config.fft_size,
+        config.hop_size, config.sample_format,
+        config.spectrogram_decimation));
+    if (!spectrogram->Open(config.spectrogram_file,
+                           config.active_mic_channels))
+      return 1;
+  }
+
   PlayClient player(config);
   player.Start();
 
   RecordClient recorder(config);
   recorder.Start();
 
-  Evaluator evaluator(config);
+  // Keeps capturing while the evaluator works on the previous block.
+  CaptureThread capture(config.hop_size * config.num_mic_channels *
+                            config.sample_format.bytes(),
+                        &recorder);
+  capture.Start();
 
-  // Starts evaluation.
-  ControlLoop(config, &evaluator, &player, &recorder);
+  if (!config.stimulus.empty()) {
+    StimulusLoop(config, &player, &capture, spectrogram.get());
+  } else if (config.pilot_frequency != 0) {
+    PilotLoop(config, &player, &capture, spectrogram.get());
+  } else {
+    Evaluator evaluator(config);
+    evaluator.set_spectrogram(spectrogram.get());
+
+    // Starts evaluation.
+    ControlLoop(config, &evaluator, &player, &capture);
+  }
 
   // Terminates and cleans up.
+  capture.Stop();
   recorder.Terminate();
   player.Terminate();
+  if (spectrogram) {
+    spectrogram->Close();
+    printf("spectrogram: %llu rows written to %s\n",
+           static_cast<unsigned long long>(spectrogram->num_rows()),
+           config.spectrogram_file.c_str());
+  }
 
+  if (config.stimulus == "sweep")
+    return AnalyzeSweep(config, config.capture_file.c_str()) ? 0 : 1;
   return 0;
 }
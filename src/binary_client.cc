@@ -5,6 +5,7 @@
 #include "include/binary_client.h"
 
 #include <fcntl.h>
+#include <poll.h>
 #include <signal.h>
 #include <string.h>
 #include <sys/stat.h>
@@ -16,6 +17,9 @@
 
 namespace {
 
+// Timeout in milliseconds to check whether recording is stopped.
+const int kStopCheckIntervalMs = 100;
+
 // Fork, exec child process and set its stdin / stdout fd.
 //
 // Args:
@@ -149,12 +153,29 @@ void RecordClient::Start() {
 }
 
 void RecordClient::Record(void *buffer, size_t size) {
+  const std::atomic<bool> is_stopped(false);
+  Record(buffer, size, &is_stopped);
+}
+
+bool RecordClient::Record(void *buffer, size_t size,
+                          const std::atomic<bool> *is_stopped) {
   int res;
   int byte_to_read = size;
 
   uint8_t *ptr = static_cast<uint8_t *>(buffer);
-
-  while ((res = read(record_fd_, ptr, byte_to_read)) < byte_to_read) {
+  struct pollfd pfd = {record_fd_, POLLIN, 0};
+
+  while (byte_to_read > 0) {
+    // Waits for data with a timeout instead of blocking in read(), so it can
+    // be stopped even if the recorder stops producing data.
+    res = poll(&pfd, 1, kStopCheckIntervalMs);
+    if (res == 0) {
+      if (*is_stopped)
+        return false;
+      continue;
+    }
+    if (res > 0)
+      res = read(record_fd_, ptr, byte_to_read);
     if (res <= 0) {
       fprintf(stderr, "Retrieve recorded data error.\n");
       exit(EXIT_FAILURE);
@@ -162,6 +183,7 @@ void RecordClient::Record(void *buffer, size_t size) {
     ptr += res;
     byte_to_read -= res;
   }
+  return true;
 }
 
 void RecordClient::Terminate() {
@@ -0,0 +1,111 @@
+// Copyright 2019 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "include/capture_thread.h"
+
+#include <assert.h>
+#include <stdio.h>
+
+CaptureThread::CaptureThread(size_t block_size, RecordClient *recorder)
+    : block_size_(block_size),
+      recorder_(recorder),
+      ready_(-1),
+      latest_sequence_(0),
+      dropped_blocks_(0),
+      is_stopped_(true) {
+  for (int i = 0; i < kNumBlocks; ++i) {
+    buffers_[i].reset(new uint8_t[block_size_]);
+    blocks_[i].data = buffers_[i].get();
+    blocks_[i].sequence = 0;
+    states_[i] = kFree;
+  }
+}
+
+CaptureThread::~CaptureThread() {
+  Stop();
+}
+
+void CaptureThread::Start() {
+  if (!is_stopped_) {
+    fprintf(stderr, "Capture thread is still running.\n");
+    return;
+  }
+  is_stopped_ = false;
+  thread_ = std::thread(&CaptureThread::Run, this);
+}
+
+void CaptureThread::Stop() {
+  if (is_stopped_)
+    return;
+  is_stopped_ = true;
+  thread_.join();
+}
+
+uint64_t CaptureThread::latest_sequence() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return latest_sequence_;
+}
+
+uint64_t CaptureThread::dropped_blocks() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return dropped_blocks_;
+}
+
+const CaptureThread::Block *CaptureThread::Acquire(uint64_t sequence) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  block_ready_.wait(lock, [this, sequence] {
+    return ready_ >= 0 && blocks_[ready_].sequence > sequence;
+  });
+  int index = ready_;
+  ready_ = -1;
+  states_[index] = kHeld;
+  return &blocks_[index];
+}
+
+void CaptureThread::Release(const Block *block) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  int index = block - blocks_;
+  assert(index >= 0 && index < kNumBlocks && states_[index] == kHeld);
+  states_[index] = kFree;
+}
+
+void CaptureThread::Run() {
+  while (!is_stopped_) {
+    int index = -1;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      // At most one block is ready and one is held, so one is always free.
+      for (int i = 0; i < kNumBlocks; ++i) {
+        if (states_[i] == kFree) {
+          index = i;
+          break;
+        }
+      }
+      assert(index >= 0);
+      states_[index] = kFilling;
+    }
+
+    // Reads without holding the lock so the consumer can keep going.
+    Block *block = &blocks_[index];
+    bool is_filled =
+        recorder_->Record(buffers_[index].get(), block_size_, &is_stopped_);
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!is_filled) {
+        states_[index] = kFree;
+        break;
+      }
+      block->sequence = ++latest_sequence_;
+      block->timestamp = std::chrono::steady_clock::now();
+      if (ready_ >= 0) {
+        states_[ready_] = kFree;
+        ++dropped_blocks_;
+      }
+      states_[index] = kReady;
+      ready_ = index;
+    }
+    block_ready_.notify_one();
+  }
+}
@@ -4,94 +4,95 @@
 
 #include "include/evaluator.h"
 
+#include <algorithm>
+#include <chrono>
 #include <cmath>
 
+#include "include/allocation_counter.h"
+
 namespace {
 // Returns the square of absolute value of complex number.
 inline double SquareAbs(const double real, const double imaginary) {
   return real * real + imaginary * imaginary;
 }
 
-void ToComplex(const std::vector<double> &data, std::vector<double> *output) {
-  if (output->size() != data.size() * 2)
-    output->resize(data.size() * 2);
-  auto it = output->begin();
-  for (size_t i = 0; i < data.size(); ++i) {
-    *(it++) = data[i];
-    *(it++) = 0.0;
-  }
-}
-
-// One dimension fast fourier transform using Danielson-Lanczos lemma.
-void FFT(std::vector<double> *data_ptr) {
-  auto &data = *data_ptr;
-  unsigned order, pos = 1, size = data.size();
-
-  // Reverses binary reindexing.
-  for (unsigned i = 1; i < size; i += 2) {
-    if (pos > i) {
-      std::swap(data[pos - 1], data[i - 1]);
-      std::swap(data[pos], data[i]);
-    }
-    order = size / 2;
-    while (order >= 2 && pos > order) {
-      pos -= order;
-      order >>= 1;
-    }
-    pos += order;
-  }
-
-  // Danielson-Lanczos lemma.
-  unsigned mmax = 2, step;
-  double theta, wtemp;
-  double cur[2], pre[2], temp[2];  // [0] real, [1] complex
-
-  mmax = 2;
-  while (size > mmax) {
-    step = mmax << 1;
-    theta = -(2 * M_PI / mmax);
-    wtemp = sin(theta / 2);
-
-    pre[0] = -2.0 * wtemp * wtemp;
-    pre[1] = sin(theta);
-
-    cur[0] = 1.0;
-    cur[1] = 0.0;
-    for (unsigned k = 1; k < mmax; k += 2) {
-      for (unsigned i = k; i <= size; i += step) {
-        pos = i + mmax;
-        temp[0] = cur[0] * data[pos - 1] - cur[1] * data[pos];
-        temp[1] = cur[0] * data[pos] + cur[1] * data[pos - 1];
-
-        data[pos - 1] = data[i - 1] - temp[0];
-        data[pos] = data[i] - temp[1];
-        data[i - 1] += temp[0];
-        data[i] += temp[1];
-      }
-      wtemp = cur[0];
-      cur[0] += wtemp * pre[0] - cur[1] * pre[1];
-      cur[1] += cur[1] * pre[0] + wtemp * pre[1];
-    }
-    mmax = step;
-  }
+// Maps a bin of the full spectrum into [0, size / 2], where a harmonic above
+// the Nyquist frequency aliases to.
+inline int FoldBin(int bin, int size) {
+  bin %= size;
+  if (bin < 0)
+    bin += size;
+  return bin <= size / 2 ? bin : size - bin;
 }
 
 }  // namespace
 
 Evaluator::Evaluator(const AudioFunTestConfig &config)
-    : filter_(config.match_window_size),
+    : analyzer_(SpectrumAnalyzer::Create(config)),
+      hop_size_(config.hop_size > 0 ? config.hop_size : config.fft_size),
+      power_(config.num_carriers * config.match_window_size *
+             config.num_mic_channels),
+      filter_(config.match_window_size),
       half_window_size_(config.match_window_size / 2),
       num_channels_(config.num_mic_channels),
       active_mic_channels_(config.active_mic_channels),
-      format_(config.sample_format),
       sample_rate_(config.sample_rate),
       bin_(config.match_window_size),
+      carrier_power_(config.num_carriers * config.num_mic_channels),
+      confidence_(config.num_carriers * config.num_mic_channels),
+      distortion_(config.distortion),
+      fft_size_(config.fft_size),
+      noise_trials_(0),
+      spectrogram_(NULL),
       confidence_threshold_(config.confidence_threshold),
+      start_sequence_(0),
+      decision_time_(0.0),
+      decision_audio_time_(0.0),
       verbose_(config.verbose) {
-  // Initializes original expected filter.
-  filter_[half_window_size_] = 1;  // center
-  double mean = 1.0;
-  double sigma = 1.0;  // standard deviation
+  // Power is normalized by 2 * fft_size, the length of the interleaved complex
+  // sequence the confidence threshold was tuned with, and by the coherent
+  // power gain of the window so that a tone has the same power in its center
+  // bin with any window.
+  const int size = config.fft_size;
+  power_scale_ = 1.0 / (2 * size);
+  std::vector<double> window = config.window.Generate(size);
+  if (config.window.type() != WindowFunction::kRectangular) {
+    double gain = 0.0;
+    for (double w : window)
+      gain += w;
+    gain /= size;
+    power_scale_ /= gain * gain;
+  }
+
+  // A tone on the center bin spreads into the neighbor bins like the
+  // spectrum of the window, which is a single bin for rectangular window.
+  expected_power_.resize(filter_.size());
+  for (int index = 0; index < static_cast<int>(filter_.size()); ++index) {
+    const int k = index - half_window_size_;
+    double real = 0.0, imaginary = 0.0;
+    for (int n = 0; n < size; ++n) {
+      const double theta = -2 * M_PI * k * n / size;
+      real += window[n] * cos(theta);
+      imaginary += window[n] * sin(theta);
+    }
+    expected_power_[index] = SquareAbs(real, imaginary);
+  }
+  const double center_power = expected_power_[half_window_size_];
+  for (auto &x : expected_power_) {
+    x /= center_power;
+    // Cancels rounding errors of the bins out of the main lobe.
+    if (x < 1e-12)
+      x = 0.0;
+  }
+
+  // Initializes expected filter from the expected power.
+  filter_ = expected_power_;
+  double mean = 0.0;
+  double sigma = 0.0;  // standard deviation
+  for (auto x : filter_) {
+    mean += x;
+    sigma += x * x;
+  }
 
   // Normalization.
   mean /= filter_.size();
@@ -104,61 +105,153 @@ Evaluator::Evaluator(const AudioFunTestConfig &config)
   // max_trial_ is the reverse of allowed delay plus the threshold to pass.
   // And +2 is for the acceptable variation.
   max_trial_ =
-      config.allowed_delay_sec * sample_rate_ / config.fft_size
+      config.allowed_delay_sec * sample_rate_ / hop_size_
       + confidence_threshold_ + 2;
 
-  buf_size_ = num_channels_ * config.fft_size * format_.bytes();
-  buffer_.reset(new uint8_t[buf_size_]);
+  if (distortion_) {
+    spectrum_power_.resize((size / 2 + 1) * num_channels_);
+    fundamental_power_.resize(carrier_power_.size());
+    harmonic_power_.resize(carrier_power_.size());
+    counted_bins_.reserve(config.num_carriers + kMaxHarmonic);
+    residual_power_.resize(num_channels_);
+    noise_power_.resize(num_channels_);
+  }
+
+  if (config.glitches) {
+    glitch_detector_.reset(new GlitchDetector(
+        sample_rate_, num_channels_, hop_size_, config.sample_format,
+        config.num_carriers));
+    frequencies_.reserve(config.num_carriers);
+  }
+
+  if (verbose_) {
+    printf("Spectrum engine: %s, %s precision\n",
+           analyzer_->use_goertzel() ? "goertzel" : "fft",
+           analyzer_->precision());
+  }
 }
 
-void Evaluator::Evaluate(int center_bin,
-                         RecordClient *recorder,
-                         std::vector<bool> *result) {
+void Evaluator::Evaluate(const std::vector<int> &center_bins,
+                         BlockSource *source,
+                         std::vector<std::vector<bool> > *results) {
   bool all_pass = false;
-  std::vector<double> accum_confidence(num_channels_);
+  uint64_t sequence = source->latest_sequence();
+  start_sequence_ = sequence;
+  const uint64_t dropped_blocks = source->dropped_blocks();
+  const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  std::chrono::steady_clock::time_point decision = start;
+  std::fill(carrier_power_.begin(), carrier_power_.end(), 0.0);
+  std::fill(confidence_.begin(), confidence_.end(), 0.0);
+  analyzer_->Reset();
+  if (glitch_detector_) {
+    frequencies_.clear();
+    for (int bin : center_bins)
+      frequencies_.push_back(static_cast<double>(bin) * sample_rate_ /
+                             fft_size_);
+    glitch_detector_->Reset(frequencies_);
+  }
+  const uint64_t allocations = ThreadAllocationCount();
 
-  for (int trial = 1;
-       trial <= max_trial_ && !all_pass;
-       ++trial) {
-    all_pass = true;
-    recorder->Record(buffer_.get(), buf_size_);
+  int trial = 1;
+  bool is_transformed = false;
+  while (trial <= max_trial_ && !all_pass) {
+    const BlockSource::Block *block = source->Acquire(sequence);
+    if (!block)
+      break;
+    // Analyzed frames must be continuous, so they are refilled if any block
+    // is skipped.
+    if (block->sequence != sequence + 1) {
+      analyzer_->Reset();
+      if (glitch_detector_)
+        glitch_detector_->Restart();
+    }
+    sequence = block->sequence;
+    decision = block->timestamp;
 
-    std::vector<std::vector<double> > data;
-    int num_frames = Unpack(
-        buffer_.get(), buf_size_, format_, num_channels_, &data);
+    // Glitches are timed from the start of the evaluated audio, including
+    // skipped blocks, like the decision audio time.
+    if (glitch_detector_) {
+      glitch_detector_->AddFrames(
+          block->data, (sequence - start_sequence_ - 1) * hop_size_);
+    }
+    // Block n of the source holds the recorded frames from (n - 1) *
+    // hop_size.
+    if (spectrogram_)
+      spectrogram_->AddFrames(block->data, (sequence - 1) * hop_size_);
+    const bool is_filled = analyzer_->AddFrames(block->data);
+    source->Release(block);
+    is_transformed = is_filled;
+    if (!is_filled)
+      continue;
 
-    std::vector<double> complex_data(num_frames * 2);
+    ++trial;
+    all_pass = true;
+    analyzer_->Transform(center_bins, power_.data());
 
-    // Evaluates all channels.
-    for (int channel: active_mic_channels_) {
-      if (accum_confidence[channel] >= confidence_threshold_)
-        continue;
-      ToComplex(data[channel], &complex_data);
-      accum_confidence[channel] += std::max(
-          EstimateChannel(&complex_data, center_bin), 0.0);
-      if (accum_confidence[channel] < confidence_threshold_)
-        all_pass = false;
-      else
-        (*result)[channel] = true;
+    // Accumulates the power of the center bins.
+    for (size_t carrier = 0; carrier < center_bins.size(); ++carrier) {
+      const double *power = &power_[(carrier * bin_.size() +
+                                     half_window_size_) * num_channels_];
+      for (int channel = 0; channel < num_channels_; ++channel)
+        carrier_power_[carrier * num_channels_ + channel] +=
+            power[channel] * power_scale_;
     }
+
+    // Evaluates all carriers of all channels.
+    for (size_t carrier = 0; carrier < center_bins.size(); ++carrier) {
+      double *confidence = &confidence_[carrier * num_channels_];
+      for (int channel: active_mic_channels_) {
+        if (confidence[channel] >= confidence_threshold_)
+          continue;
+        confidence[channel] +=
+            std::max(EstimateChannel(carrier, channel), 0.0);
+        if (confidence[channel] < confidence_threshold_)
+          all_pass = false;
+        else
+          (*results)[carrier][channel] = true;
+      }
+    }
+  }
+  const uint64_t trial_allocations = ThreadAllocationCount() - allocations;
+  // Distortion is measured on the decision trial, by which a detected tone
+  // has played through the whole frame, so its onset does not count as
+  // distortion.
+  if (distortion_) {
+    std::fill(fundamental_power_.begin(), fundamental_power_.end(), 0.0);
+    std::fill(residual_power_.begin(), residual_power_.end(), 0.0);
+    if (is_transformed)
+      MeasureDistortion(center_bins);
+  }
+  if (trial > 1) {
+    for (auto &power : carrier_power_)
+      power /= trial - 1;
+  }
+  decision_time_ = std::chrono::duration<double>(decision - start).count();
+  decision_audio_time_ = static_cast<double>(sequence - start_sequence_) *
+                         hop_size_ / sample_rate_;
+  if (verbose_) {
+    printf("Skipped %llu stale blocks.\n",
+           static_cast<unsigned long long>(source->dropped_blocks() -
+                                           dropped_blocks));
+    printf("Allocations in %d trials: %llu\n", trial - 1,
+           static_cast<unsigned long long>(trial_allocations));
   }
 }
 
-double Evaluator::EstimateChannel(
-    std::vector<double> *data, int center_bin) {
-  FFT(data);
-
+double Evaluator::EstimateChannel(int carrier, int channel) {
   double confidence = 0.0, mean = 0.0, sigma = 0.0;
+  double expected = 0.0, expected_square = 0.0, matched = 0.0;
 
-  for (int bin = (center_bin - half_window_size_);
-       bin <= center_bin + half_window_size_;
-       ++bin) {
-    int index = bin - (center_bin - half_window_size_);
-    bin_[index] = SquareAbs(
-        (*data)[2 * bin], (*data)[2 * bin + 1]) / data->size();
+  const double *power = &power_[carrier * bin_.size() * num_channels_];
+  for (size_t index = 0; index < bin_.size(); ++index) {
+    bin_[index] = power[index * num_channels_ + channel] * power_scale_;
     if (verbose_)
       printf("%e ", bin_[index]);
     confidence += bin_[index] * filter_[index];
+    matched += bin_[index] * expected_power_[index];
+    expected += expected_power_[index];
+    expected_square += expected_power_[index] * expected_power_[index];
     mean += bin_[index];
     sigma += bin_[index] * bin_[index];
   }
@@ -167,7 +260,10 @@ double Evaluator::EstimateChannel(
   // Avoids divide by zero.
   if (std::abs(sigma) < 1e-9)
     return 0.0;
-  const double power_ratio = bin_[half_window_size_] / mean;
+  // Ratio of the power matching the expected shape to the total power. It is
+  // the power ratio of the center bin for rectangular window, and is 1.0 for
+  // a clean tone with any window.
+  const double power_ratio = matched / mean * expected / expected_square;
   mean /= filter_.size();
   sigma = sqrt(sigma / filter_.size() - mean * mean);
   confidence /= (sigma * filter_.size());
@@ -175,3 +271,108 @@ double Evaluator::EstimateChannel(
     printf("power: %0.4f, conf: %0.4f\n", power_ratio, confidence);
   return power_ratio * confidence;
 }
+
+void Evaluator::MeasureNoise(BlockSource *source) {
+  std::fill(noise_power_.begin(), noise_power_.end(), 0.0);
+  uint64_t sequence = source->latest_sequence();
+  analyzer_->Reset();
+  int trial = 0;
+  while (trial < kNoiseTrials) {
+    const BlockSource::Block *block = source->Acquire(sequence);
+    if (!block)
+      break;
+    if (block->sequence != sequence + 1)
+      analyzer_->Reset();
+    sequence = block->sequence;
+    const bool is_filled = analyzer_->AddFrames(block->data);
+    source->Release(block);
+    if (!is_filled)
+      continue;
+
+    ++trial;
+    analyzer_->PowerSpectrum(spectrum_power_.data());
+    for (int channel = 0; channel < num_channels_; ++channel)
+      noise_power_[channel] += TotalPower(channel);
+  }
+  if (trial > 0) {
+    for (auto &power : noise_power_)
+      power /= trial;
+  }
+  noise_trials_ = trial;
+}
+
+Evaluator::Distortion Evaluator::distortion(int carrier, int channel) const {
+  const int index = carrier * num_channels_ + channel;
+  const double fundamental = fundamental_power_[index];
+  Distortion result;
+  result.thd_db = 10 * log10(harmonic_power_[index] / fundamental);
+  result.thd_n_db = 10 * log10(residual_power_[channel] / fundamental);
+  if (noise_trials_ == 0) {
+    // The noise floor was not measured.
+    result.snr_db = NAN;
+  } else {
+    // Digital silence has no noise, and its SNR is infinite.
+    result.snr_db = 10 * log10(fundamental / noise_power_[channel]);
+  }
+  return result;
+}
+
+void Evaluator::MeasureDistortion(const std::vector<int> &center_bins) {
+  std::fill(harmonic_power_.begin(), harmonic_power_.end(), 0.0);
+  analyzer_->PowerSpectrum(spectrum_power_.data());
+  for (int channel = 0; channel < num_channels_; ++channel) {
+    // The notch takes out the match windows of all carriers, which leaves
+    // their distortion and the noise.
+    double residual = TotalPower(channel);
+    for (size_t carrier = 0; carrier < center_bins.size(); ++carrier) {
+      const double fundamental = WindowPower(center_bins[carrier], channel);
+      fundamental_power_[carrier * num_channels_ + channel] = fundamental;
+      residual -= fundamental;
+    }
+    residual_power_[channel] = std::max(residual, 0.0);
+  }
+
+  for (size_t carrier = 0; carrier < center_bins.size(); ++carrier) {
+    // A harmonic landing in the window of a carrier is not told apart from
+    // it, and one folding onto the window of a lower harmonic is already
+    // summed, so their windows are skipped to count every bin at most once.
+    counted_bins_.clear();
+    for (int center_bin : center_bins)
+      counted_bins_.push_back(FoldBin(center_bin, fft_size_));
+    for (int order = 2; order <= kMaxHarmonic; ++order) {
+      const int harmonic_bin = FoldBin(order * center_bins[carrier],
+                                       fft_size_);
+      bool is_counted = false;
+      for (int counted_bin : counted_bins_) {
+        if (std::abs(harmonic_bin - counted_bin) <= 2 * half_window_size_)
+          is_counted = true;
+      }
+      if (is_counted)
+        continue;
+      counted_bins_.push_back(harmonic_bin);
+      for (int channel = 0; channel < num_channels_; ++channel) {
+        harmonic_power_[carrier * num_channels_ + channel] +=
+            WindowPower(harmonic_bin, channel);
+      }
+    }
+  }
+}
+
+double Evaluator::WindowPower(int center_bin, int channel) const {
+  // The window is clipped to the bins summed by TotalPower(), so that bins
+  // past DC or the Nyquist frequency are not folded back and counted twice.
+  const int first = std::max(center_bin - half_window_size_,
+                             half_window_size_ + 1);
+  const int last = std::min(center_bin + half_window_size_, fft_size_ / 2);
+  double power = 0.0;
+  for (int bin = first; bin <= last; ++bin)
+    power += spectrum_power_[bin * num_channels_ + channel];
+  return power;
+}
+
+double Evaluator::TotalPower(int channel) const {
+  double power = 0.0;
+  for (int bin = half_window_size_ + 1; bin <= fft_size_ / 2; ++bin)
+    power += spectrum_power_[bin * num_channels_ + channel];
+  return power;
+}
@@ -0,0 +1,400 @@
+// Copyright 2019 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "include/block_source.h"
+#include "include/common.h"
+#include "include/evaluator.h"
+#include "include/file_source.h"
+#include "include/sample_format.h"
+#include "include/spectrum_analyzer.h"
+
+namespace {
+
+const int kSampleRate = 64000;
+const int kFFTSize = 2048;
+const int kHopSize = 512;
+const int kNumChannels = 2;
+const int kNumBlocks = 24;
+const int kCenterBin = 300;
+
+// Serves a recording held in memory in blocks, like FileSource.
+class MemorySource : public BlockSource {
+ public:
+  MemorySource(size_t block_size, const std::vector<uint8_t> &data)
+      : block_size_(block_size), data_(data), offset_(0) {
+    block_.data = NULL;
+    block_.sequence = 0;
+  }
+
+  size_t block_size() const override { return block_size_; }
+  uint64_t latest_sequence() override { return block_.sequence; }
+  uint64_t dropped_blocks() override { return 0; }
+  const Block *Acquire(uint64_t sequence) override {
+    if (offset_ + block_size_ > data_.size())
+      return NULL;
+    block_.data = &data_[offset_];
+    block_.sequence = sequence + 1;
+    block_.timestamp = std::chrono::steady_clock::now();
+    offset_ += block_size_;
+    return &block_;
+  }
+  void Release(const Block *) override {}
+
+ private:
+  size_t block_size_;
+  const std::vector<uint8_t> &data_;
+  size_t offset_;
+  Block block_;
+};
+
+AudioFunTestConfig MakeConfig() {
+  AudioFunTestConfig config;
+  config.sample_rate = kSampleRate;
+  config.fft_size = kFFTSize;
+  config.hop_size = kHopSize;
+  config.num_mic_channels = kNumChannels;
+  config.active_mic_channels = {0, 1};
+  config.window = WindowFunction(WindowFunction::kHann);
+  return config;
+}
+
+// Records |num_frames| s16 frames of a tone between two bins above
+// |center_bin| with noise, loud in channel 0 and 40 dB softer in channel 1.
+std::vector<uint8_t> RecordTone(int center_bin, int num_frames) {
+  const SampleFormat format(SampleFormat::kPcmS16);
+  std::vector<uint8_t> data(num_frames * kNumChannels * format.bytes());
+  srand(1);
+  void *buf = data.data();
+  for (int i = 0; i < num_frames; ++i) {
+    const double tone = sin(2 * M_PI * (center_bin + 0.25) * i / kFFTSize);
+    const double noise0 = 2.0 * rand() / RAND_MAX - 1;
+    const double noise1 = 2.0 * rand() / RAND_MAX - 1;
+    buf = WriteSample(0.5 * tone + 1e-3 * noise0, format, buf);
+    buf = WriteSample(0.005 * tone + 1e-3 * noise1, format, buf);
+  }
+  return data;
+}
+
+// The float pipeline keeps the match window within 1e-5 of the center bin
+// power of the double one, which is well below the 16-bit quantization of
+// the recording.
+TEST(SpectrumAnalyzerTest, FloatMatchesDouble) {
+  const int kFrames = kNumBlocks * kHopSize;
+  const std::vector<uint8_t> data = RecordTone(kCenterBin, kFrames);
+  const size_t block_size = kHopSize * kNumChannels * 2;
+  const std::vector<int> center_bins = {kCenterBin};
+
+  AudioFunTestConfig config = MakeConfig();
+  std::unique_ptr<SpectrumAnalyzer> analyzer_double =
+      SpectrumAnalyzer::Create(config);
+  config.single_precision = true;
+  std::unique_ptr<SpectrumAnalyzer> analyzer_float =
+      SpectrumAnalyzer::Create(config);
+  ASSERT_STREQ("double", analyzer_double->precision());
+  ASSERT_STREQ("float", analyzer_float->precision());
+
+  const int num_values = config.match_window_size * kNumChannels;
+  std::vector<double> power_double(num_values);
+  std::vector<double> power_float(num_values);
+  int num_transforms = 0;
+  for (size_t offset = 0; offset + block_size <= data.size();
+       offset += block_size) {
+    const bool filled_double = analyzer_double->AddFrames(&data[offset]);
+    const bool filled_float = analyzer_float->AddFrames(&data[offset]);
+    ASSERT_EQ(filled_double, filled_float);
+    if (!filled_double)
+      continue;
+    ++num_transforms;
+    analyzer_double->Transform(center_bins, power_double.data());
+    analyzer_float->Transform(center_bins, power_float.data());
+    const int center = config.match_window_size / 2 * kNumChannels;
+    for (int c = 0; c < kNumChannels; ++c) {
+      const double center_power = power_double[center + c];
+      for (int b = 0; b < config.match_window_size; ++b) {
+        const int index = b * kNumChannels + c;
+        EXPECT_NEAR(power_double[index], power_float[index],
+                    1e-5 * center_power)
+            << "bin " << b << ", channel " << c;
+      }
+    }
+  }
+  EXPECT_EQ(kNumBlocks - kFFTSize / kHopSize + 1, num_transforms);
+}
+
+// Evaluating the same recording in float and double gives the same
+// confidence and carrier power within 1e-5, relative to the double values.
+TEST(EvaluatorTest, FloatMatchesDouble) {
+  const std::vector<uint8_t> data =
+      RecordTone(kCenterBin, kNumBlocks * kHopSize);
+  const size_t block_size = kHopSize * kNumChannels * 2;
+  const std::vector<int> center_bins = {kCenterBin};
+
+  AudioFunTestConfig config = MakeConfig();
+  // Keeps the confidence growing over all blocks.
+  config.confidence_threshold = 1e9;
+  std::vector<std::vector<bool> > results(1,
+                                          std::vector<bool>(kNumChannels));
+  Evaluator evaluator_double(config);
+  MemorySource source_double(block_size, data);
+  evaluator_double.Evaluate(center_bins, &source_double, &results);
+  config.single_precision = true;
+  Evaluator evaluator_float(config);
+  MemorySource source_float(block_size, data);
+  evaluator_float.Evaluate(center_bins, &source_float, &results);
+
+  for (int c = 0; c < kNumChannels; ++c) {
+    const double power = evaluator_double.carrier_power(0, c);
+    const double confidence = evaluator_double.confidence(0, c);
+    EXPECT_GT(confidence, 0.0);
+    EXPECT_NEAR(power, evaluator_float.carrier_power(0, c), 1e-5 * power)
+        << "channel " << c;
+    EXPECT_NEAR(confidence, evaluator_float.confidence(0, c),
+                1e-5 * confidence)
+        << "channel " << c;
+  }
+}
+
+// A round of a rounds file.
+struct Round {
+  long long start_frame;
+  std::vector<int> bins;
+};
+
+// Returns the path of |name| in the testdata directory of the source tree.
+std::string TestDataPath(const std::string &name) {
+  const char *src = getenv("SRC");
+  return std::string(src ? src : ".") + "/testdata/" + name;
+}
+
+// Reads the rounds of a rounds file of "@start_frame bin..." lines.
+std::vector<Round> ReadRounds(const std::string &path) {
+  std::vector<Round> rounds;
+  std::ifstream file(path);
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.empty() || line[0] == '#')
+      continue;
+    std::istringstream stream(line);
+    Round round;
+    char at;
+    stream >> at >> round.start_frame;
+    int bin;
+    while (stream >> bin)
+      round.bins.push_back(bin);
+    rounds.push_back(round);
+  }
+  return rounds;
+}
+
+// Replays a loopback capture with noise, an interferer and clock drift in
+// float and double, with each window and hop size and with 1 and 3
+// carriers. The match windows of the float pipeline stay within 1e-5 of the
+// peak of each window of the double one over the first frames of a round.
+TEST(SpectrumAnalyzerTest, FloatMatchesDoubleOnRecording) {
+  const int kFramesPerRound = 4 * kFFTSize;
+  AudioFile file;
+  ASSERT_TRUE(file.Open(TestDataPath("evaluator_loopback.wav").c_str(),
+                        SampleFormat(SampleFormat::kPcmS16), 0, 0));
+  const std::vector<Round> rounds =
+      ReadRounds(TestDataPath("evaluator_loopback.rounds"));
+  ASSERT_EQ(4u, rounds.size());
+
+  struct Analysis {
+    WindowFunction::Type window;
+    int hop_size;
+  };
+  const Analysis kAnalyses[] = {
+      {WindowFunction::kRectangular, kFFTSize},
+      {WindowFunction::kHann, kHopSize},
+  };
+  for (const Analysis &analysis : kAnalyses) {
+    for (size_t num_carriers : {1, 3}) {
+      AudioFunTestConfig config = MakeConfig();
+      config.sample_rate = file.sample_rate();
+      config.window = WindowFunction(analysis.window);
+      config.hop_size = analysis.hop_size;
+      config.num_carriers = num_carriers;
+      std::unique_ptr<SpectrumAnalyzer> analyzer_double =
+          SpectrumAnalyzer::Create(config);
+      config.single_precision = true;
+      std::unique_ptr<SpectrumAnalyzer> analyzer_float =
+          SpectrumAnalyzer::Create(config);
+      const int window_size = config.match_window_size;
+      std::vector<double> power_double(num_carriers * window_size *
+                                       kNumChannels);
+      std::vector<double> power_float(power_double.size());
+      const size_t block_size = analysis.hop_size * file.frame_bytes();
+
+      for (const Round &round : rounds) {
+        const std::vector<int> bins(round.bins.begin(),
+                                    round.bins.begin() + num_carriers);
+        const size_t begin = round.start_frame * file.frame_bytes();
+        const size_t end = begin + kFramesPerRound * file.frame_bytes();
+        ASSERT_LE(end, file.data_size());
+        analyzer_double->Reset();
+        analyzer_float->Reset();
+        for (size_t offset = begin; offset + block_size <= end;
+             offset += block_size) {
+          const bool filled = analyzer_double->AddFrames(file.data() + offset);
+          ASSERT_EQ(filled, analyzer_float->AddFrames(file.data() + offset));
+          if (!filled)
+            continue;
+          analyzer_double->Transform(bins, power_double.data());
+          analyzer_float->Transform(bins, power_float.data());
+          for (size_t k = 0; k < num_carriers; ++k) {
+            for (int c = 0; c < kNumChannels; ++c) {
+              double peak = 0;
+              for (int b = 0; b < window_size; ++b) {
+                peak = std::max(
+                    peak,
+                    power_double[(k * window_size + b) * kNumChannels + c]);
+              }
+              for (int b = 0; b < window_size; ++b) {
+                const int index = (k * window_size + b) * kNumChannels + c;
+                EXPECT_NEAR(power_double[index], power_float[index],
+                            1e-5 * peak)
+                    << "bin " << bins[k] - window_size / 2 + b
+                    << ", channel " << c;
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+// Replays a loopback capture with noise, an interferer and clock drift in
+// float and double, with each window and hop size and with 1 and 3
+// carriers. The float pipeline gives the same pass results, and carrier
+// power and confidence within 1e-5 of the double ones.
+TEST(EvaluatorTest, FloatMatchesDoubleOnRecording) {
+  AudioFile file;
+  ASSERT_TRUE(file.Open(TestDataPath("evaluator_loopback.wav").c_str(),
+                        SampleFormat(SampleFormat::kPcmS16), 0, 0));
+  const std::vector<Round> rounds =
+      ReadRounds(TestDataPath("evaluator_loopback.rounds"));
+  ASSERT_EQ(4u, rounds.size());
+
+  struct Analysis {
+    WindowFunction::Type window;
+    int hop_size;
+  };
+  const Analysis kAnalyses[] = {
+      {WindowFunction::kRectangular, kFFTSize},
+      {WindowFunction::kHann, kHopSize},
+  };
+  for (const Analysis &analysis : kAnalyses) {
+    for (size_t num_carriers : {1, 3}) {
+      AudioFunTestConfig config = MakeConfig();
+      config.sample_rate = file.sample_rate();
+      config.window = WindowFunction(analysis.window);
+      config.hop_size = analysis.hop_size;
+      config.num_carriers = num_carriers;
+      // Keeps the confidence growing over all blocks of a round.
+      config.confidence_threshold = 1e9;
+      Evaluator evaluator_double(config);
+      config.single_precision = true;
+      Evaluator evaluator_float(config);
+      const size_t block_size = analysis.hop_size * file.frame_bytes();
+      FileSource source_double(block_size, &file);
+      FileSource source_float(block_size, &file);
+
+      for (const Round &round : rounds) {
+        const std::vector<int> bins(round.bins.begin(),
+                                    round.bins.begin() + num_carriers);
+        std::vector<std::vector<bool> > results_double(
+            num_carriers, std::vector<bool>(kNumChannels));
+        std::vector<std::vector<bool> > results_float = results_double;
+        source_double.Seek(round.start_frame);
+        source_float.Seek(round.start_frame);
+        evaluator_double.Evaluate(bins, &source_double, &results_double);
+        evaluator_float.Evaluate(bins, &source_float, &results_float);
+
+        EXPECT_EQ(results_double, results_float);
+        for (size_t i = 0; i < num_carriers; ++i) {
+          for (int c = 0; c < kNumChannels; ++c) {
+            const double power = evaluator_double.carrier_power(i, c);
+            const double confidence = evaluator_double.confidence(i, c);
+            EXPECT_GT(confidence, 0.0);
+            EXPECT_NEAR(power, evaluator_float.carrier_power(i, c),
+                        1e-5 * power)
+                << "bin " << bins[i] << ", channel " << c;
+            EXPECT_NEAR(confidence, evaluator_float.confidence(i, c),
+                        1e-5 * confidence)
+                << "bin " << bins[i] << ", channel " << c;
+          }
+        }
+      }
+    }
+  }
+}
+
+// A tone on bin 256 of 2048 has its 4th harmonic on the Nyquist bin and its
+// 5th folding onto the 3rd, and each of their bins counts once into the THD,
+// which cannot exceed the THD+N.
+TEST(EvaluatorTest, DistortionCountsFoldedHarmonicsOnce) {
+  const int kBin = 256;
+  const double kAmplitude = 0.5;
+  const double kHarmonic = 0.01;
+  const int kFrames = kNumBlocks * kFFTSize;
+  const SampleFormat format(SampleFormat::kPcmS16);
+  std::vector<uint8_t> data(kFrames * kNumChannels * format.bytes());
+  // Without noise, the quantization error of the periodic tone would fall
+  // on the harmonics too, and THD+N would equal the THD.
+  std::vector<double> noise(kFrames * kNumChannels);
+  UniformNoise(1).Generate(noise.size(), noise.data());
+  void *buf = data.data();
+  for (int i = 0; i < kFrames; ++i) {
+    double sample = kAmplitude * cos(2 * M_PI * kBin * i / kFFTSize);
+    for (int order = 2; order <= Evaluator::kMaxHarmonic; ++order)
+      sample += kHarmonic * cos(2 * M_PI * order * kBin * i / kFFTSize);
+    for (int c = 0; c < kNumChannels; ++c)
+      buf = WriteSample(sample + 1e-4 * noise[i * kNumChannels + c], format,
+                        buf);
+  }
+
+  AudioFunTestConfig config = MakeConfig();
+  config.window = WindowFunction(WindowFunction::kRectangular);
+  config.hop_size = 0;
+  config.distortion = true;
+  Evaluator evaluator(config);
+  MemorySource source(kFFTSize * kNumChannels * format.bytes(), data);
+  std::vector<std::vector<bool> > results(1,
+                                          std::vector<bool>(kNumChannels));
+  evaluator.Evaluate({kBin}, &source, &results);
+
+  // The 2nd harmonic is on its own bin, the 3rd and the 5th add up on the
+  // same bin, and a cosine on the Nyquist bin has twice the magnitude of one
+  // on another bin.
+  const double harmonic_power = kHarmonic * kHarmonic +
+                                (2 * kHarmonic) * (2 * kHarmonic) +
+                                (2 * kHarmonic) * (2 * kHarmonic);
+  const double expected_db =
+      10 * log10(harmonic_power / (kAmplitude * kAmplitude));
+  for (int c = 0; c < kNumChannels; ++c) {
+    ASSERT_TRUE(results[0][c]);
+    const Evaluator::Distortion distortion = evaluator.distortion(0, c);
+    EXPECT_NEAR(expected_db, distortion.thd_db, 0.01);
+    EXPECT_LE(distortion.thd_db, distortion.thd_n_db);
+    // No noise floor was measured.
+    EXPECT_TRUE(isnan(distortion.snr_db));
+  }
+}
+
+}  // namespace
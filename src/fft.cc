@@ -0,0 +1,209 @@
+// Copyright 2019 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "include/fft.h"
+
+#include <assert.h>
+
+#include <cmath>
+
+namespace {
+
+// Radix-2 butterfly on |lanes| points. Each point is |lanes| real parts
+// followed by |lanes| imaginary parts. Both points are distinct, which lets
+// the compiler vectorize the lane loop.
+template <typename T>
+inline void Butterfly(T w_real, T w_imag, size_t lanes, T *__restrict even,
+                      T *__restrict odd) {
+  for (size_t c = 0; c < lanes; ++c) {
+    const T real = w_real * odd[c] - w_imag * odd[lanes + c];
+    const T imag = w_real * odd[lanes + c] + w_imag * odd[c];
+    odd[c] = even[c] - real;
+    odd[lanes + c] = even[lanes + c] - imag;
+    even[c] += real;
+    even[lanes + c] += imag;
+  }
+}
+
+}  // namespace
+
+template <typename T>
+BasicRealFFT<T>::BasicRealFFT(int size)
+    : size_(size),
+      half_size_(size / 2),
+      bit_reverse_(half_size_),
+      twiddle_(half_size_ > 1 ? half_size_ : 0),
+      split_twiddle_((half_size_ + 1) * 2),
+      work_(size_) {
+  assert(size_ >= 2 && (size_ & (size_ - 1)) == 0);
+
+  // Bit-reversal permutation of the half size complex FFT.
+  int bits = 0;
+  while ((1 << bits) < half_size_)
+    ++bits;
+  for (int i = 0; i < half_size_; ++i) {
+    int reversed = 0;
+    for (int b = 0; b < bits; ++b) {
+      if (i & (1 << b))
+        reversed |= 1 << (bits - 1 - b);
+    }
+    bit_reverse_[i] = reversed;
+  }
+
+  for (int k = 0; k < half_size_ / 2; ++k) {
+    const double theta = -2 * M_PI * k / half_size_;
+    twiddle_[2 * k] = cos(theta);
+    twiddle_[2 * k + 1] = sin(theta);
+  }
+
+  for (int k = 0; k <= half_size_; ++k) {
+    const double theta = -2 * M_PI * k / size_;
+    split_twiddle_[2 * k] = cos(theta);
+    split_twiddle_[2 * k + 1] = sin(theta);
+  }
+}
+
+template <typename T>
+void BasicRealFFT<T>::Transform(const T *input, T *output) {
+  TransformLanes<1>(input, 1, output);
+}
+
+template <typename T>
+void BasicRealFFT<T>::TransformBatch(const T *input, int batch, T *output) {
+  // Common mic channel counts get a constant lane count, which lets the
+  // compiler unroll and vectorize the lane loops.
+  switch (batch) {
+    case 1:
+      TransformLanes<1>(input, batch, output);
+      break;
+    case 2:
+      TransformLanes<2>(input, batch, output);
+      break;
+    case 4:
+      TransformLanes<4>(input, batch, output);
+      break;
+    case 8:
+      TransformLanes<8>(input, batch, output);
+      break;
+    default:
+      TransformLanes<0>(input, batch, output);
+      break;
+  }
+}
+
+template <typename T>
+void BasicRealFFT<T>::Reserve(int batch) {
+  if (work_.size() < static_cast<size_t>(size_ * batch))
+    work_.resize(size_ * batch);
+}
+
+template <typename T>
+template <int kLanes>
+void BasicRealFFT<T>::TransformLanes(const T *input, int batch, T *output) {
+  // Each point holds |batch| lanes, one for each sequence. All the loops below
+  // run over lanes innermost, so the sequences are transformed together.
+  const size_t lanes = kLanes > 0 ? kLanes : batch;
+  const size_t point = 2 * lanes;
+  Reserve(lanes);
+  T *data = work_.data();
+
+  // Packs even samples as real part and odd samples as imaginary part, and
+  // reorders them into bit-reversed positions in the same pass.
+  for (int i = 0; i < half_size_; ++i) {
+    T *real = data + bit_reverse_[i] * point;
+    T *imag = real + lanes;
+    const T *even = input + 2 * i * lanes;
+    const T *odd = even + lanes;
+    for (size_t c = 0; c < lanes; ++c) {
+      real[c] = even[c];
+      imag[c] = odd[c];
+    }
+  }
+
+  Butterflies<kLanes>(batch);
+
+  // Splits the packed spectrum Z into the spectrum X of the real input:
+  //   X[k] = (Z[k] + Z*[M - k]) / 2 - i * W^k * (Z[k] - Z*[M - k]) / 2,
+  // where M is half_size_ and W = exp(-2 * pi * i / size).
+  for (int k = 0; k <= half_size_; ++k) {
+    const T *a_real = data + (k == half_size_ ? 0 : k) * point;
+    const T *a_imag = a_real + lanes;
+    const T *b_real = data + (k == 0 ? 0 : half_size_ - k) * point;
+    const T *b_imag = b_real + lanes;
+    const T w_real = split_twiddle_[2 * k];
+    const T w_imag = split_twiddle_[2 * k + 1];
+    T *out_real = output + k * point;
+    T *out_imag = out_real + lanes;
+    for (size_t c = 0; c < lanes; ++c) {
+      const T even_real = (a_real[c] + b_real[c]) / 2;
+      const T even_imag = (a_imag[c] - b_imag[c]) / 2;
+      const T odd_real = (a_imag[c] + b_imag[c]) / 2;
+      const T odd_imag = -(a_real[c] - b_real[c]) / 2;
+      out_real[c] = even_real + w_real * odd_real - w_imag * odd_imag;
+      out_imag[c] = even_imag + w_real * odd_imag + w_imag * odd_real;
+    }
+  }
+}
+
+template <typename T>
+void BasicRealFFT<T>::InverseTransform(const T *input, T *output) {
+  Reserve(1);
+  T *data = work_.data();
+
+  // Merges the spectrum X back into the packed spectrum Z of the even and odd
+  // samples, reversing the split of TransformLanes():
+  //   Z[k] = (X[k] + X*[M - k]) / 2 + i * W^-k * (X[k] - X*[M - k]) / 2.
+  // The inverse DFT is the conjugate of the forward DFT of the conjugate, so
+  // Z is conjugated into bit-reversed positions and transformed forward.
+  for (int k = 0; k < half_size_; ++k) {
+    const int j = half_size_ - k;
+    const T a_real = input[2 * k];
+    const T a_imag = k == 0 ? 0 : input[2 * k + 1];
+    const T b_real = input[2 * j];
+    const T b_imag = j == half_size_ ? 0 : -input[2 * j + 1];
+    const T w_real = split_twiddle_[2 * k];
+    const T w_imag = split_twiddle_[2 * k + 1];
+    const T diff_real = (a_real - b_real) / 2;
+    const T diff_imag = (a_imag - b_imag) / 2;
+    const T odd_real = diff_real * w_real + diff_imag * w_imag;
+    const T odd_imag = diff_imag * w_real - diff_real * w_imag;
+    T *point = data + bit_reverse_[k] * 2;
+    point[0] = (a_real + b_real) / 2 - odd_imag;
+    point[1] = -((a_imag + b_imag) / 2 + odd_real);
+  }
+
+  Butterflies<1>(1);
+
+  // Point n holds the conjugate of z[n] = x[2n] + i * x[2n + 1], times M.
+  const T scale = T(1) / half_size_;
+  for (int n = 0; n < half_size_; ++n) {
+    output[2 * n] = data[2 * n] * scale;
+    output[2 * n + 1] = -data[2 * n + 1] * scale;
+  }
+}
+
+template <typename T>
+template <int kLanes>
+void BasicRealFFT<T>::Butterflies(int batch) {
+  const size_t lanes = kLanes > 0 ? kLanes : batch;
+  const size_t point = 2 * lanes;
+  T *data = work_.data();
+
+  // Danielson-Lanczos lemma with precomputed twiddle factors.
+  for (int length = 2; length <= half_size_; length <<= 1) {
+    const int half_length = length / 2;
+    const int step = half_size_ / length;
+    for (int start = 0; start < half_size_; start += length) {
+      T *even = data + start * point;
+      T *odd = even + half_length * point;
+      for (int k = 0; k < half_length; ++k) {
+        Butterfly(twiddle_[2 * k * step], twiddle_[2 * k * step + 1], lanes,
+                  even + k * point, odd + k * point);
+      }
+    }
+  }
+}
+
+template class BasicRealFFT<float>;
+template class BasicRealFFT<double>;
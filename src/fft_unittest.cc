@@ -0,0 +1,134 @@
+// Copyright 2019 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <math.h>
+#include <stdlib.h>
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "include/fft.h"
+
+namespace {
+
+const int kSizes[] = {2, 8, 256, 4096};
+const int kBatches[] = {1, 2, 3, 8};
+
+// Returns |size| samples of noise in [-1, 1] from rand() seeded by |seed|.
+std::vector<double> Noise(int size, unsigned int seed) {
+  srand(seed);
+  std::vector<double> noise(size);
+  for (double &sample : noise)
+    sample = 2.0 * rand() / RAND_MAX - 1;
+  return noise;
+}
+
+// Returns bins 0 ~ size / 2 of the DFT of |input| computed by its
+// definition in long double, interleaved like BasicRealFFT::Transform().
+std::vector<long double> NaiveDFT(const std::vector<double> &input) {
+  const int size = input.size();
+  // exp(-2 * pi * i * m / size), indexed by k * n modulo the size.
+  std::vector<long double> cosine(size);
+  std::vector<long double> sine(size);
+  for (int m = 0; m < size; ++m) {
+    cosine[m] = cosl(2 * M_PIl * m / size);
+    sine[m] = -sinl(2 * M_PIl * m / size);
+  }
+  std::vector<long double> output(size + 2);
+  for (int k = 0; k <= size / 2; ++k) {
+    long double real = 0;
+    long double imag = 0;
+    for (int n = 0; n < size; ++n) {
+      const int m = (static_cast<long long>(k) * n) % size;
+      real += input[n] * cosine[m];
+      imag += input[n] * sine[m];
+    }
+    output[2 * k] = real;
+    output[2 * k + 1] = imag;
+  }
+  return output;
+}
+
+template <typename T>
+class FFTTest : public ::testing::Test {
+ protected:
+  // Noise in [-1, 1] peaks at |size| in any bin, and the rounding error of
+  // the transform grows with the number of its stages.
+  double Tolerance(int size) const {
+    const double epsilon = sizeof(T) == sizeof(float) ? 1e-6 : 1e-15;
+    return 4 * epsilon * size * log2(size);
+  }
+};
+
+typedef ::testing::Types<float, double> Precisions;
+TYPED_TEST_SUITE(FFTTest, Precisions);
+
+// Every bin, including the packed DC and Nyquist bins, equals the DFT.
+TYPED_TEST(FFTTest, TransformEqualsDFT) {
+  for (int size : kSizes) {
+    const std::vector<double> noise = Noise(size, size);
+    const std::vector<long double> expected = NaiveDFT(noise);
+
+    BasicRealFFT<TypeParam> fft(size);
+    ASSERT_EQ(size + 2, fft.output_size());
+    const std::vector<TypeParam> input(noise.begin(), noise.end());
+    std::vector<TypeParam> output(fft.output_size());
+    fft.Transform(input.data(), output.data());
+    for (int i = 0; i < fft.output_size(); ++i) {
+      EXPECT_NEAR(expected[i], output[i], this->Tolerance(size))
+          << "size " << size << ", bin " << i / 2
+          << (i % 2 ? " imaginary" : " real");
+    }
+  }
+}
+
+// Each sequence of a batch equals its own DFT, including batch sizes which
+// are not specialized.
+TYPED_TEST(FFTTest, TransformBatchEqualsDFT) {
+  for (int size : kSizes) {
+    for (int batch : kBatches) {
+      std::vector<std::vector<long double> > expected(batch);
+      std::vector<TypeParam> input(size * batch);
+      for (int c = 0; c < batch; ++c) {
+        const std::vector<double> noise = Noise(size, size * batch + c);
+        expected[c] = NaiveDFT(noise);
+        for (int n = 0; n < size; ++n)
+          input[n * batch + c] = noise[n];
+      }
+
+      BasicRealFFT<TypeParam> fft(size);
+      std::vector<TypeParam> output(fft.output_size() * batch);
+      fft.TransformBatch(input.data(), batch, output.data());
+      for (int i = 0; i < fft.output_size(); ++i) {
+        for (int c = 0; c < batch; ++c) {
+          EXPECT_NEAR(expected[c][i], output[i * batch + c],
+                      this->Tolerance(size))
+              << "size " << size << ", batch " << batch << ", sequence "
+              << c << ", bin " << i / 2 << (i % 2 ? " imaginary" : " real");
+        }
+      }
+    }
+  }
+}
+
+// InverseTransform() gives back the input of Transform().
+TYPED_TEST(FFTTest, InverseTransformRoundTrips) {
+  for (int size : kSizes) {
+    const std::vector<double> noise = Noise(size, size);
+    const std::vector<TypeParam> input(noise.begin(), noise.end());
+
+    BasicRealFFT<TypeParam> fft(size);
+    std::vector<TypeParam> spectrum(fft.output_size());
+    std::vector<TypeParam> output(size);
+    fft.Transform(input.data(), spectrum.data());
+    fft.InverseTransform(spectrum.data(), output.data());
+    for (int n = 0; n < size; ++n) {
+      EXPECT_NEAR(input[n], output[n], this->Tolerance(size) / size)
+          << "size " << size << ", sample " << n;
+    }
+  }
+}
+
+}  // namespace
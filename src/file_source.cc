@@ -0,0 +1,172 @@
+// Copyright 2019 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "include/file_source.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+namespace {
+const uint16_t kWaveFormatPcm = 1;
+const uint16_t kWaveFormatIeeeFloat = 3;
+const uint16_t kWaveFormatExtensible = 0xfffe;
+
+// WAV files are little endian, like all the targets of the tool.
+uint16_t ReadLe16(const uint8_t *data) {
+  uint16_t value;
+  memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+uint32_t ReadLe32(const uint8_t *data) {
+  uint32_t value;
+  memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+// Returns the PCM format stored in |bytes| bytes per sample.
+SampleFormat FormatOfBytes(int bytes) {
+  switch (bytes) {
+    case 1:
+      return SampleFormat(SampleFormat::kPcmU8);
+    case 2:
+      return SampleFormat(SampleFormat::kPcmS16);
+    case 3:
+      return SampleFormat(SampleFormat::kPcmS24);
+    case 4:
+      return SampleFormat(SampleFormat::kPcmS32);
+    default:
+      return SampleFormat(SampleFormat::kPcmInvalid);
+  }
+}
+
+}  // namespace
+
+AudioFile::AudioFile()
+    : map_(NULL),
+      map_size_(0),
+      data_offset_(0),
+      data_size_(0),
+      sample_rate_(0),
+      num_channels_(0) {}
+
+AudioFile::~AudioFile() {
+  if (map_)
+    munmap(const_cast<uint8_t *>(map_), map_size_);
+}
+
+bool AudioFile::Open(const char *path, SampleFormat format, int sample_rate,
+                     int num_channels) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    perror(path);
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) < 0 || st.st_size == 0) {
+    fprintf(stderr, "Cannot read %s.\n", path);
+    close(fd);
+    return false;
+  }
+  map_size_ = st.st_size;
+  void *map = mmap(NULL, map_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    perror("mmap");
+    return false;
+  }
+  // The file is replayed from the start to the end once.
+  madvise(map, map_size_, MADV_SEQUENTIAL);
+  map_ = static_cast<const uint8_t *>(map);
+
+  if (map_size_ >= 12 && memcmp(map_, "RIFF", 4) == 0 &&
+      memcmp(map_ + 8, "WAVE", 4) == 0)
+    return ParseWaveHeader(path);
+
+  format_ = format;
+  sample_rate_ = sample_rate;
+  num_channels_ = num_channels;
+  data_offset_ = 0;
+  data_size_ = map_size_;
+  return true;
+}
+
+bool AudioFile::ParseWaveHeader(const char *path) {
+  bool has_format = false;
+  size_t pos = 12;
+  while (pos + 8 <= map_size_) {
+    const uint8_t *chunk = map_ + pos;
+    const size_t chunk_size = ReadLe32(chunk + 4);
+    pos += 8;
+    if (memcmp(chunk, "fmt ", 4) == 0) {
+      if (chunk_size < 16 || pos + chunk_size > map_size_)
+        break;
+      uint16_t tag = ReadLe16(chunk + 8);
+      num_channels_ = ReadLe16(chunk + 10);
+      sample_rate_ = ReadLe32(chunk + 12);
+      const int block_align = ReadLe16(chunk + 20);
+      // The sub format GUID of an extensible header starts with the tag.
+      if (tag == kWaveFormatExtensible && chunk_size >= 40)
+        tag = ReadLe16(chunk + 32);
+      if ((tag != kWaveFormatPcm && tag != kWaveFormatIeeeFloat) ||
+          num_channels_ <= 0) {
+        fprintf(stderr, "%s: only PCM and float WAV are supported.\n", path);
+        return false;
+      }
+      // Samples narrower than their container, like 24 bits in 32, are
+      // aligned to the most significant bits, so they are read as the
+      // container.
+      if (tag == kWaveFormatIeeeFloat) {
+        format_ = SampleFormat(block_align == 4 * num_channels_
+                                   ? SampleFormat::kPcmFloat
+                                   : SampleFormat::kPcmInvalid);
+      } else {
+        format_ = FormatOfBytes(block_align / num_channels_);
+      }
+      if (format_.type() == SampleFormat::kPcmInvalid) {
+        fprintf(stderr, "%s: unsupported block align %d.\n", path,
+                block_align);
+        return false;
+      }
+      has_format = true;
+    } else if (memcmp(chunk, "data", 4) == 0) {
+      if (!has_format)
+        break;
+      data_offset_ = pos;
+      // Streamed files may not have the final size in the header.
+      data_size_ = std::min(chunk_size, map_size_ - pos);
+      return true;
+    }
+    // Chunks are padded to even sizes.
+    pos += chunk_size + (chunk_size & 1);
+  }
+  fprintf(stderr, "%s: malformed WAV header.\n", path);
+  return false;
+}
+
+FileSource::FileSource(size_t block_size, const AudioFile *file)
+    : block_size_(block_size), file_(file), offset_(0) {
+  block_.data = NULL;
+  block_.sequence = 0;
+}
+
+const BlockSource::Block *FileSource::Acquire(uint64_t sequence) {
+  if (offset_ + block_size_ > file_->data_size())
+    return NULL;
+  block_.data = file_->data() + offset_;
+  block_.sequence = sequence + 1;
+  block_.timestamp = std::chrono::steady_clock::now();
+  offset_ += block_size_;
+  return &block_;
+}
+
+void FileSource::Seek(uint64_t frame) {
+  offset_ = frame * file_->frame_bytes();
+}
@@ -11,11 +11,11 @@ GeneratorPlayer::GeneratorPlayer(size_t buf_size,
                                  int num_channels,
                                  const std::set<int> &active_channels,
                                  SampleFormat format,
+                                 bool dither,
                                  PlayClient *player)
     : buf_size_(buf_size),
-      num_channels_(num_channels),
-      active_channels_(active_channels),
-      format_(format),
+      cache_(format, ChannelGains(num_channels, active_channels),
+             dither ? &dither_ : NULL),
       player_(player),
       is_stopped_(true),
       buffer_(new uint8_t[buf_size_]) {}
@@ -26,6 +26,7 @@ void GeneratorPlayer::Play(ToneGenerator *generator) {
     return;
   }
   is_stopped_ = false;
+  cache_.Reset();
   thread_ = std::thread(&GeneratorPlayer::Run, this, generator);
 }
 
@@ -38,10 +39,8 @@ void GeneratorPlayer::Stop() {
 
 void GeneratorPlayer::Run(ToneGenerator *generator) {
   while (!is_stopped_ && generator->HasMoreFrames()) {
-    size_t frame_read = generator->GetFrames(
-        format_, num_channels_, active_channels_, buffer_.get(), buf_size_);
-    player_->Play(buffer_.get(), frame_read * num_channels_ * format_.bytes(),
-	&is_stopped_);
+    size_t bytes_read = cache_.GetFrames(generator, buffer_.get(), buf_size_);
+    player_->Play(buffer_.get(), bytes_read, &is_stopped_);
   }
   is_stopped_ = true;
 }
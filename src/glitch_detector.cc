@@ -0,0 +1,209 @@
+// Copyright 2019 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "include/glitch_detector.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// A channel is checked while the residual power of its last block is below
+// this ratio of its signal power, i.e. the tones are steady.
+const double kMaxResidualRatio = 1e-2;
+// A channel below this signal power has no tone to check.
+const double kMinSignalPower = 1e-6;
+// A spike exceeds the RMS residual of the last block by this ratio. Rounding
+// noise peaks at a few times its RMS through the stages.
+const double kSpikeRatio = 10.0;
+// A spike is also at least this ratio of the RMS signal, which keeps the
+// threshold above rounding noise on clean digital paths.
+const double kMinSpikeRatio = 1e-3;
+
+// Number of values of a stage computed in a block. The constant trip count
+// of the inner loop lets the compiler vectorize it.
+const int kBlockSize = 16;
+
+// Runs the stage x[n] - coefficient * x[n - 1] + x[n - 2] over |count|
+// interleaved values of |input|, whose first 2 * |stride| values are history.
+inline void RunStage(const double *__restrict input, int count, int stride,
+                     double coefficient, double *__restrict output) {
+  const double *previous = input + stride;
+  const double *current = input + 2 * stride;
+  int i = 0;
+  for (; i + kBlockSize <= count; i += kBlockSize) {
+    for (int j = 0; j < kBlockSize; ++j)
+      output[i + j] = current[i + j] - coefficient * previous[i + j] +
+                      input[i + j];
+  }
+  for (; i < count; ++i)
+    output[i] = current[i] - coefficient * previous[i] + input[i];
+}
+
+// Sums the squares of |input| and of |residual| and finds the peak of
+// |residual| of each channel over |num_frames| frames. |kChannels| is the
+// channel count known at compile time, or 0 to use |channels|, so the channel
+// loop vectorizes.
+template <int kChannels>
+void ChannelStats(const double *__restrict input,
+                  const double *__restrict residual, int num_frames,
+                  int channels, double *__restrict signal_power,
+                  double *__restrict residual_power, double *__restrict peak) {
+  const int lanes = kChannels > 0 ? kChannels : channels;
+  for (int frame = 0; frame < num_frames; ++frame) {
+    const double *x = input + frame * lanes;
+    const double *r = residual + frame * lanes;
+    for (int c = 0; c < lanes; ++c) {
+      signal_power[c] += x[c] * x[c];
+      residual_power[c] += r[c] * r[c];
+      peak[c] = std::max(peak[c], std::abs(r[c]));
+    }
+  }
+}
+
+}  // namespace
+
+GlitchDetector::GlitchDetector(int sample_rate, int num_channels,
+                               int block_frames, SampleFormat format,
+                               int max_tones)
+    : sample_rate_(sample_rate),
+      num_channels_(num_channels),
+      block_frames_(block_frames),
+      format_(format),
+      samples_(block_frames * num_channels),
+      stage_input_((block_frames + 2) * num_channels),
+      stage_output_((block_frames + 2) * num_channels),
+      history_(max_tones * 2 * num_channels),
+      warm_frames_(0),
+      signal_power_(num_channels),
+      residual_power_(num_channels),
+      block_signal_(num_channels),
+      block_residual_(num_channels),
+      block_peak_(num_channels),
+      last_spike_(num_channels, -1),
+      glitch_count_(num_channels),
+      glitch_frames_(num_channels) {
+  coefficients_.reserve(max_tones);
+  for (auto &frames : glitch_frames_)
+    frames.reserve(kMaxGlitchFrames);
+}
+
+void GlitchDetector::Reset(const std::vector<double> &frequencies) {
+  coefficients_.clear();
+  const size_t max_tones = history_.size() / (2 * num_channels_);
+  for (size_t i = 0; i < std::min(frequencies.size(), max_tones); ++i) {
+    coefficients_.push_back(
+        2 * cos(2 * M_PI * frequencies[i] / sample_rate_));
+  }
+  std::fill(glitch_count_.begin(), glitch_count_.end(), 0);
+  for (auto &frames : glitch_frames_)
+    frames.clear();
+  Restart();
+}
+
+void GlitchDetector::Restart() {
+  std::fill(history_.begin(), history_.end(), 0.0);
+  std::fill(signal_power_.begin(), signal_power_.end(), 0.0);
+  std::fill(residual_power_.begin(), residual_power_.end(), 0.0);
+  std::fill(last_spike_.begin(), last_spike_.end(), -1);
+  warm_frames_ = 0;
+}
+
+void GlitchDetector::AddFrames(const void *data, uint64_t first_frame) {
+  if (coefficients_.empty())
+    return;
+  const int history_size = 2 * num_channels_;
+  const int count = block_frames_ * num_channels_;
+  ConvertSamples(data, count, format_, samples_.data());
+
+  // Each stage reads its last 2 input frames of the previous block followed
+  // by its input, and writes its output after the history of the next stage.
+  std::vector<double> *in = &stage_input_;
+  std::vector<double> *out = &stage_output_;
+  std::copy(samples_.begin(), samples_.end(), in->begin() + history_size);
+  for (size_t stage = 0; stage < coefficients_.size(); ++stage) {
+    double *history = &history_[stage * history_size];
+    std::copy(history, history + history_size, in->begin());
+    std::copy(in->end() - history_size, in->end(), history);
+    RunStage(in->data(), count, num_channels_, coefficients_[stage],
+             out->data() + history_size);
+    std::swap(in, out);
+  }
+
+  // The residual depends on the zeros before the first frame after
+  // Restart() until 2 frames per stage have been added.
+  const int warmup = 2 * coefficients_.size();
+  const int first_valid = std::max(warmup - warm_frames_, 0);
+  warm_frames_ = std::min(warm_frames_ + block_frames_, warmup);
+  if (first_valid < block_frames_)
+    CheckResidual(in->data() + history_size, first_valid, first_frame);
+}
+
+void GlitchDetector::CheckResidual(const double *residual, int first_valid,
+                                   uint64_t first_frame) {
+  const double *signal = samples_.data();
+  std::fill(block_signal_.begin(), block_signal_.end(), 0.0);
+  std::fill(block_residual_.begin(), block_residual_.end(), 0.0);
+  std::fill(block_peak_.begin(), block_peak_.end(), 0.0);
+  const int num_frames = block_frames_ - first_valid;
+  const int offset = first_valid * num_channels_;
+  switch (num_channels_) {
+    case 1:
+      ChannelStats<1>(signal + offset, residual + offset, num_frames, 1,
+                      block_signal_.data(), block_residual_.data(),
+                      block_peak_.data());
+      break;
+    case 2:
+      ChannelStats<2>(signal + offset, residual + offset, num_frames, 2,
+                      block_signal_.data(), block_residual_.data(),
+                      block_peak_.data());
+      break;
+    case 4:
+      ChannelStats<4>(signal + offset, residual + offset, num_frames, 4,
+                      block_signal_.data(), block_residual_.data(),
+                      block_peak_.data());
+      break;
+    case 8:
+      ChannelStats<8>(signal + offset, residual + offset, num_frames, 8,
+                      block_signal_.data(), block_residual_.data(),
+                      block_peak_.data());
+      break;
+    default:
+      ChannelStats<0>(signal + offset, residual + offset, num_frames,
+                      num_channels_, block_signal_.data(),
+                      block_residual_.data(), block_peak_.data());
+      break;
+  }
+
+  // Hold off of a glitch, within which further spikes are the response of
+  // the stages to the same discontinuity.
+  const int hold_frames = 2 * coefficients_.size() + 1;
+  for (int c = 0; c < num_channels_; ++c) {
+    const double signal_power = signal_power_[c];
+    const double residual_power = residual_power_[c];
+    signal_power_[c] = block_signal_[c] / num_frames;
+    residual_power_[c] = block_residual_[c] / num_frames;
+    if (signal_power < kMinSignalPower ||
+        residual_power > kMaxResidualRatio * signal_power)
+      continue;
+    const double threshold =
+        std::max(kSpikeRatio * sqrt(residual_power),
+                 kMinSpikeRatio * sqrt(signal_power));
+    if (block_peak_[c] <= threshold)
+      continue;
+    // Glitches are rare, so the spikes are only located in blocks which
+    // have one.
+    for (int i = first_valid; i < block_frames_; ++i) {
+      if (std::abs(residual[i * num_channels_ + c]) <= threshold)
+        continue;
+      const int64_t frame = first_frame + i;
+      if (last_spike_[c] < 0 || frame - last_spike_[c] > hold_frames) {
+        if (glitch_count_[c] < kMaxGlitchFrames)
+          glitch_frames_[c].push_back(frame);
+        ++glitch_count_[c];
+      }
+      last_spike_[c] = frame;
+    }
+  }
+}
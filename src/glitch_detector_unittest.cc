@@ -0,0 +1,78 @@
+// Copyright 2019 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <math.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "include/glitch_detector.h"
+#include "include/sample_format.h"
+
+namespace {
+
+const int kSampleRate = 48000;
+const int kNumChannels = 4;
+const int kBlockFrames = 1024;
+const int kNumFrames = 2 * kSampleRate;
+const int kMaxTones = 4;
+
+// Frames where channel 0 drops a sample and channel 2 repeats one.
+const int kDroppedFrame = 30000;
+const int kRepeatedFrame = 70001;
+
+// Records two tones with noise in all channels, with a sample dropped in
+// channel 0 and one repeated in channel 2. Channels 1 and 3 are clean.
+std::vector<uint8_t> Record(const std::vector<double> &frequencies) {
+  const SampleFormat format(SampleFormat::kPcmS16);
+  std::vector<uint8_t> data(kNumFrames * kNumChannels * format.bytes());
+  std::vector<double> noise(kNumFrames * kNumChannels);
+  UniformNoise(1).Generate(noise.size(), noise.data());
+  void *buf = data.data();
+  for (int n = 0; n < kNumFrames; ++n) {
+    for (int c = 0; c < kNumChannels; ++c) {
+      // Frame of the tones which is recorded as frame n.
+      int source = n;
+      if (c == 0 && n >= kDroppedFrame)
+        ++source;
+      if (c == 2 && n >= kRepeatedFrame)
+        --source;
+      double sample = 1e-4 * noise[n * kNumChannels + c];
+      for (double frequency : frequencies)
+        sample += 0.25 * sin(2 * M_PI * frequency * source / kSampleRate);
+      buf = WriteSample(sample, format, buf);
+    }
+  }
+  return data;
+}
+
+// A dropped and a repeated sample are each found once, at the frame where
+// they happened, and the clean channels have no glitch.
+TEST(GlitchDetectorTest, FindsGlitchAtItsFrame) {
+  const std::vector<double> frequencies = {1000.0, 3000.5};
+  const std::vector<uint8_t> data = Record(frequencies);
+  const SampleFormat format(SampleFormat::kPcmS16);
+  GlitchDetector detector(kSampleRate, kNumChannels, kBlockFrames, format,
+                          kMaxTones);
+  detector.Reset(frequencies);
+  const size_t block_bytes = kBlockFrames * kNumChannels * format.bytes();
+  for (int n = 0; n + kBlockFrames <= kNumFrames; n += kBlockFrames)
+    detector.AddFrames(&data[n / kBlockFrames * block_bytes], n);
+
+  const int kGlitchFrames[kNumChannels] = {kDroppedFrame, -1, kRepeatedFrame,
+                                           -1};
+  for (int c = 0; c < kNumChannels; ++c) {
+    if (kGlitchFrames[c] < 0) {
+      EXPECT_EQ(0, detector.glitch_count(c)) << "channel " << c;
+      continue;
+    }
+    ASSERT_EQ(1, detector.glitch_count(c)) << "channel " << c;
+    EXPECT_EQ(kGlitchFrames[c], detector.glitch_frames(c)[0])
+        << "channel " << c;
+  }
+}
+
+}  // namespace
@@ -0,0 +1,134 @@
+// Copyright 2019 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "include/goertzel.h"
+
+#include <cmath>
+#include <limits>
+
+namespace {
+// Relative cost of one Goertzel filter step (1 multiplication and 2
+// additions) to one radix-2 butterfly (4 multiplications and 6 additions)
+// of the FFT, measured with 2048 ~ 8192 points transforms.
+const double kGoertzelStepCost = 0.5;
+
+// Returns |X[k]|^2 from the last two filter states s[N - 1] and s[N - 2].
+template <typename T>
+inline T Power(T coeff, T s1, T s2) {
+  return s1 * s1 + s2 * s2 - coeff * s1 * s2;
+}
+
+// Runs 4 filters over |size| points of |input|, which are |stride| values
+// apart. Filter j reads input[n * stride + j * lane_step] with |coeff|[j], so
+// it covers both 4 bins of one sequence (lane_step = 0) and one bin of 4
+// sequences (lane_step = 1). The filters are independent, so running them
+// together hides the latency of each recurrence. States are kept in local
+// variables so that they stay in registers.
+template <typename T>
+void RunFourFilters(const T *input, int size, size_t stride, size_t lane_step,
+                    const T *coeff, T *power, size_t power_step) {
+  const T c0 = coeff[0], c1 = coeff[1], c2 = coeff[2], c3 = coeff[3];
+  const T *x0 = input;
+  const T *x1 = x0 + lane_step;
+  const T *x2 = x1 + lane_step;
+  const T *x3 = x2 + lane_step;
+  T a1 = 0, a2 = 0, b1 = 0, b2 = 0;
+  T d1 = 0, d2 = 0, e1 = 0, e2 = 0;
+  for (size_t i = 0; i < size * stride; i += stride) {
+    const T a0 = c0 * a1 + (x0[i] - a2);
+    const T b0 = c1 * b1 + (x1[i] - b2);
+    const T d0 = c2 * d1 + (x2[i] - d2);
+    const T e0 = c3 * e1 + (x3[i] - e2);
+    a2 = a1;
+    a1 = a0;
+    b2 = b1;
+    b1 = b0;
+    d2 = d1;
+    d1 = d0;
+    e2 = e1;
+    e1 = e0;
+  }
+  power[0] = Power(c0, a1, a2);
+  power[power_step] = Power(c1, b1, b2);
+  power[2 * power_step] = Power(c2, d1, d2);
+  power[3 * power_step] = Power(c3, e1, e2);
+}
+
+// Runs a single filter over |size| points of |input|, which are |stride|
+// values apart.
+template <typename T>
+T RunFilter(const T *input, int size, size_t stride, T coeff) {
+  T s1 = 0, s2 = 0;
+  for (size_t i = 0; i < size * stride; i += stride) {
+    const T s0 = coeff * s1 + (input[i] - s2);
+    s2 = s1;
+    s1 = s0;
+  }
+  return Power(coeff, s1, s2);
+}
+
+}  // namespace
+
+template <typename T>
+BasicGoertzelBank<T>::BasicGoertzelBank(int size, int num_bins)
+    : size_(size),
+      num_bins_(num_bins),
+      first_bin_(std::numeric_limits<int>::min()),
+      coeff_(num_bins) {}
+
+template <typename T>
+bool BasicGoertzelBank<T>::IsCheaperThanFFT(int size, int num_bins) {
+  // RealFFT runs size / 4 * log2(size / 2) butterflies plus a split pass of
+  // size / 2 butterflies.
+  const double half_size = size / 2.0;
+  const double fft_cost = half_size / 2 * std::log2(half_size) + half_size;
+  const double goertzel_cost = kGoertzelStepCost * size * num_bins;
+  return goertzel_cost < fft_cost;
+}
+
+template <typename T>
+void BasicGoertzelBank<T>::SetFirstBin(int first_bin) {
+  if (first_bin == first_bin_)
+    return;
+  first_bin_ = first_bin;
+  for (int b = 0; b < num_bins_; ++b)
+    coeff_[b] = 2 * cos(2 * M_PI * (first_bin + b) / size_);
+}
+
+template <typename T>
+void BasicGoertzelBank<T>::Transform(const T *input, int first_bin,
+                                     T *power) {
+  TransformBatch(input, 1, first_bin, power);
+}
+
+template <typename T>
+void BasicGoertzelBank<T>::TransformBatch(const T *input, int batch,
+                                          int first_bin, T *power) {
+  SetFirstBin(first_bin);
+
+  const size_t stride = batch;
+  const T *coeff = coeff_.data();
+  int c = 0;
+  // Runs each bin of 4 sequences at a time.
+  for (; c + 4 <= batch; c += 4) {
+    for (int b = 0; b < num_bins_; ++b) {
+      const T lane_coeff[4] = {coeff[b], coeff[b], coeff[b], coeff[b]};
+      RunFourFilters(input + c, size_, stride, 1, lane_coeff,
+                     power + b * stride + c, 1);
+    }
+  }
+  // Runs 4 bins at a time for each remaining sequence.
+  for (; c < batch; ++c) {
+    int b = 0;
+    for (; b + 4 <= num_bins_; b += 4) {
+      RunFourFilters(input + c, size_, stride, 0, coeff + b,
+                     power + b * stride + c, stride);
+    }
+    for (; b < num_bins_; ++b)
+      power[b * stride + c] = RunFilter(input + c, size_, stride, coeff[b]);
+  }
+}
+
+template class BasicGoertzelBank<float>;
+template class BasicGoertzelBank<double>;
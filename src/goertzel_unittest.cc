@@ -0,0 +1,86 @@
+// Copyright 2019 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <math.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "include/fft.h"
+#include "include/goertzel.h"
+
+namespace {
+
+const int kSize = 2048;
+const int kNumBins = 5;
+const int kBatch = 3;
+
+template <typename T>
+class GoertzelTest : public ::testing::Test {
+ protected:
+  // Fills |input_| with an off-bin tone and noise in each sequence of the
+  // batch, a different one in each.
+  void SetUp() override {
+    srand(1);
+    input_.resize(kSize * kBatch);
+    for (int n = 0; n < kSize; ++n) {
+      for (int c = 0; c < kBatch; ++c) {
+        const double noise = static_cast<double>(rand()) / RAND_MAX - 0.5;
+        input_[n * kBatch + c] =
+            0.5 * sin(2 * M_PI * (300.3 + 100 * c) * n / kSize) +
+            0.01 * noise;
+      }
+    }
+  }
+
+  // Checks the Goertzel bins from |first_bin| against the power of the FFT
+  // bins, within |tolerance| of the peak power.
+  void ExpectBinsEqualFFT(int first_bin, double tolerance) {
+    BasicRealFFT<T> fft(kSize);
+    std::vector<T> spectrum(fft.output_size() * kBatch);
+    fft.TransformBatch(input_.data(), kBatch, spectrum.data());
+
+    BasicGoertzelBank<T> bank(kSize, kNumBins);
+    std::vector<T> power(kNumBins * kBatch);
+    bank.TransformBatch(input_.data(), kBatch, first_bin, power.data());
+
+    // A full scale tone peaks at (size / 2)^2 with any bin.
+    const double peak = 0.25 * kSize * kSize;
+    for (int b = 0; b < kNumBins; ++b) {
+      // Bins below DC are the mirror of the bins above it.
+      const int bin = std::abs(first_bin + b);
+      for (int c = 0; c < kBatch; ++c) {
+        const double real = spectrum[2 * bin * kBatch + c];
+        const double imag = spectrum[(2 * bin + 1) * kBatch + c];
+        EXPECT_NEAR(real * real + imag * imag, power[b * kBatch + c],
+                    tolerance * peak)
+            << "bin " << first_bin + b << ", sequence " << c;
+      }
+    }
+  }
+
+  std::vector<T> input_;
+};
+
+typedef ::testing::Types<float, double> Precisions;
+TYPED_TEST_SUITE(GoertzelTest, Precisions);
+
+// The match window of each carrier equals the FFT bins within 1e-4 of the
+// peak in float and 1e-9 in double, a margin over the rounding errors of the
+// two algorithms which is far below what a confidence decision depends on.
+TYPED_TEST(GoertzelTest, MatchWindowEqualsFFT) {
+  const double tolerance = sizeof(TypeParam) == sizeof(float) ? 1e-4 : 1e-9;
+  for (int c = 0; c < kBatch; ++c)
+    this->ExpectBinsEqualFFT(300 + 100 * c - kNumBins / 2, tolerance);
+}
+
+TYPED_TEST(GoertzelTest, WindowAroundDCEqualsFFT) {
+  const double tolerance = sizeof(TypeParam) == sizeof(float) ? 1e-4 : 1e-9;
+  this->ExpectBinsEqualFFT(-kNumBins / 2, tolerance);
+}
+
+}  // namespace
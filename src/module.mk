@@ -11,15 +11,30 @@ ALSA_CFLAGS := $(shell $(PKG_CONFIG) --cflags alsa)
 ALSA_LIBS := $(shell $(PKG_CONFIG) --libs alsa)
 CRAS_CFLAGS := $(shell $(PKG_CONFIG) --cflags libcras)
 CRAS_LIBS := $(shell $(PKG_CONFIG) --libs libcras)
+GTEST_CFLAGS := $(shell $(PKG_CONFIG) --cflags gtest_main)
+GTEST_LIBS := $(shell $(PKG_CONFIG) --libs gtest_main)
 
 CXX_BINARY(src/audiofuntest): \
+	src/allocation_counter.o \
 	src/audiofuntest.o \
 	src/common.o \
 	src/binary_client.o \
+	src/capture_thread.o \
 	src/evaluator.o \
+	src/fft.o \
+	src/file_source.o \
+	src/goertzel.o \
 	src/generator_player.o \
+	src/glitch_detector.o \
+	src/oscillator.o \
+	src/pilot_tracker.o \
 	src/sample_format.o \
-	src/tone_generators.o
+	src/spectrogram.o \
+	src/spectrum_analyzer.o \
+	src/sweep_analyzer.o \
+	src/tone_cache.o \
+	src/tone_generators.o \
+	src/window.o
 CXX_BINARY(src/audiofuntest): \
 	CPPFLAGS += -std=c++11
 clean: CLEAN(src/audiofuntest)
@@ -28,9 +43,12 @@ all: CXX_BINARY(src/audiofuntest)
 CXX_BINARY(src/test_tones): \
 	src/alsa_client.o \
 	src/common.o \
+	src/oscillator.o \
 	src/sample_format.o \
 	src/test_tones.o \
-	src/tone_generators.o
+	src/tone_cache.o \
+	src/tone_generators.o \
+	src/window.o
 CXX_BINARY(src/test_tones): \
 	CPPFLAGS += $(ALSA_CFLAGS) -std=c++11
 CXX_BINARY(src/test_tones): \
@@ -38,6 +56,182 @@ CXX_BINARY(src/test_tones): \
 clean: CLEAN(src/test_tones)
 all: CXX_BINARY(src/test_tones)
 
+CXX_BINARY(src/audio_bench): \
+	alsa_conformance_test/alsa_conformance_recorder.o \
+	alsa_conformance_test/alsa_conformance_timer.o \
+	src/allocation_counter.o \
+	src/audio_bench.o \
+	src/common.o \
+	src/evaluator.o \
+	src/fft.o \
+	src/glitch_detector.o \
+	src/goertzel.o \
+	src/oscillator.o \
+	src/sample_format.o \
+	src/spectrogram.o \
+	src/spectrum_analyzer.o \
+	src/tone_cache.o \
+	src/tone_generators.o \
+	src/window.o
+CXX_BINARY(src/audio_bench): \
+	CPPFLAGS += $(ALSA_CFLAGS)
+CXX_BINARY(src/audio_bench): \
+	CXXFLAGS += -std=c++11
+CXX_BINARY(src/audio_bench): \
+	LDLIBS += $(ALSA_LIBS)
+clean: CLEAN(src/audio_bench)
+all: CXX_BINARY(src/audio_bench)
+
+CXX_BINARY(src/evaluator_unittest): \
+	src/allocation_counter.o \
+	src/common.o \
+	src/evaluator.o \
+	src/evaluator_unittest.o \
+	src/fft.o \
+	src/file_source.o \
+	src/glitch_detector.o \
+	src/goertzel.o \
+	src/sample_format.o \
+	src/spectrogram.o \
+	src/spectrum_analyzer.o \
+	src/window.o
+CXX_BINARY(src/evaluator_unittest): \
+	CPPFLAGS += $(GTEST_CFLAGS)
+CXX_BINARY(src/evaluator_unittest): \
+	CXXFLAGS += -std=c++14
+CXX_BINARY(src/evaluator_unittest): \
+	LDLIBS += $(GTEST_LIBS)
+clean: CLEAN(src/evaluator_unittest)
+tests: TEST(CXX_BINARY(src/evaluator_unittest))
+
+CXX_BINARY(src/fft_unittest): \
+	src/fft.o \
+	src/fft_unittest.o
+CXX_BINARY(src/fft_unittest): \
+	CPPFLAGS += $(GTEST_CFLAGS)
+CXX_BINARY(src/fft_unittest): \
+	CXXFLAGS += -std=c++14
+CXX_BINARY(src/fft_unittest): \
+	LDLIBS += $(GTEST_LIBS)
+clean: CLEAN(src/fft_unittest)
+tests: TEST(CXX_BINARY(src/fft_unittest))
+
+CXX_BINARY(src/glitch_detector_unittest): \
+	src/glitch_detector.o \
+	src/glitch_detector_unittest.o \
+	src/sample_format.o
+CXX_BINARY(src/glitch_detector_unittest): \
+	CPPFLAGS += $(GTEST_CFLAGS)
+CXX_BINARY(src/glitch_detector_unittest): \
+	CXXFLAGS += -std=c++14
+CXX_BINARY(src/glitch_detector_unittest): \
+	LDLIBS += $(GTEST_LIBS)
+clean: CLEAN(src/glitch_detector_unittest)
+tests: TEST(CXX_BINARY(src/glitch_detector_unittest))
+
+CXX_BINARY(src/goertzel_unittest): \
+	src/fft.o \
+	src/goertzel.o \
+	src/goertzel_unittest.o
+CXX_BINARY(src/goertzel_unittest): \
+	CPPFLAGS += $(GTEST_CFLAGS)
+CXX_BINARY(src/goertzel_unittest): \
+	CXXFLAGS += -std=c++14
+CXX_BINARY(src/goertzel_unittest): \
+	LDLIBS += $(GTEST_LIBS)
+clean: CLEAN(src/goertzel_unittest)
+tests: TEST(CXX_BINARY(src/goertzel_unittest))
+
+CXX_BINARY(src/oscillator_unittest): \
+	src/fft.o \
+	src/oscillator.o \
+	src/oscillator_unittest.o
+CXX_BINARY(src/oscillator_unittest): \
+	CPPFLAGS += $(GTEST_CFLAGS)
+CXX_BINARY(src/oscillator_unittest): \
+	CXXFLAGS += -std=c++14
+CXX_BINARY(src/oscillator_unittest): \
+	LDLIBS += $(GTEST_LIBS)
+clean: CLEAN(src/oscillator_unittest)
+tests: TEST(CXX_BINARY(src/oscillator_unittest))
+
+CXX_BINARY(src/pilot_tracker_unittest): \
+	src/pilot_tracker.o \
+	src/pilot_tracker_unittest.o \
+	src/sample_format.o \
+	src/window.o
+CXX_BINARY(src/pilot_tracker_unittest): \
+	CPPFLAGS += $(GTEST_CFLAGS)
+CXX_BINARY(src/pilot_tracker_unittest): \
+	CXXFLAGS += -std=c++14
+CXX_BINARY(src/pilot_tracker_unittest): \
+	LDLIBS += $(GTEST_LIBS)
+clean: CLEAN(src/pilot_tracker_unittest)
+tests: TEST(CXX_BINARY(src/pilot_tracker_unittest))
+
+CXX_BINARY(src/sample_format_unittest): \
+	src/sample_format.o \
+	src/sample_format_unittest.o
+CXX_BINARY(src/sample_format_unittest): \
+	CPPFLAGS += $(GTEST_CFLAGS)
+CXX_BINARY(src/sample_format_unittest): \
+	CXXFLAGS += -std=c++14
+CXX_BINARY(src/sample_format_unittest): \
+	LDLIBS += $(GTEST_LIBS)
+clean: CLEAN(src/sample_format_unittest)
+tests: TEST(CXX_BINARY(src/sample_format_unittest))
+
+CXX_BINARY(src/sweep_analyzer_unittest): \
+	src/common.o \
+	src/fft.o \
+	src/oscillator.o \
+	src/sample_format.o \
+	src/sweep_analyzer.o \
+	src/sweep_analyzer_unittest.o \
+	src/tone_generators.o \
+	src/window.o
+CXX_BINARY(src/sweep_analyzer_unittest): \
+	CPPFLAGS += $(GTEST_CFLAGS)
+CXX_BINARY(src/sweep_analyzer_unittest): \
+	CXXFLAGS += -std=c++14
+CXX_BINARY(src/sweep_analyzer_unittest): \
+	LDLIBS += $(GTEST_LIBS)
+clean: CLEAN(src/sweep_analyzer_unittest)
+tests: TEST(CXX_BINARY(src/sweep_analyzer_unittest))
+
+CXX_BINARY(src/tone_cache_unittest): \
+	src/common.o \
+	src/oscillator.o \
+	src/sample_format.o \
+	src/tone_cache.o \
+	src/tone_cache_unittest.o \
+	src/tone_generators.o \
+	src/window.o
+CXX_BINARY(src/tone_cache_unittest): \
+	CPPFLAGS += $(GTEST_CFLAGS)
+CXX_BINARY(src/tone_cache_unittest): \
+	CXXFLAGS += -std=c++14
+CXX_BINARY(src/tone_cache_unittest): \
+	LDLIBS += $(GTEST_LIBS)
+clean: CLEAN(src/tone_cache_unittest)
+tests: TEST(CXX_BINARY(src/tone_cache_unittest))
+
+CXX_BINARY(src/tone_generators_unittest): \
+	src/common.o \
+	src/oscillator.o \
+	src/sample_format.o \
+	src/tone_generators.o \
+	src/tone_generators_unittest.o \
+	src/window.o
+CXX_BINARY(src/tone_generators_unittest): \
+	CPPFLAGS += $(GTEST_CFLAGS)
+CXX_BINARY(src/tone_generators_unittest): \
+	CXXFLAGS += -std=c++14
+CXX_BINARY(src/tone_generators_unittest): \
+	LDLIBS += $(GTEST_LIBS)
+clean: CLEAN(src/tone_generators_unittest)
+tests: TEST(CXX_BINARY(src/tone_generators_unittest))
+
 CC_BINARY(src/looptest): \
 	src/libaudiodev.o  \
 	src/looptest.o
@@ -0,0 +1,191 @@
+// Copyright 2019 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "include/oscillator.h"
+
+#include <assert.h>
+
+#include <cmath>
+#include <vector>
+
+namespace {
+
+// The sine table has 2^kTableBits intervals. Linear interpolation errs by at
+// most (2 * pi / 2^kTableBits)^2 / 8, about -130 dB of full scale.
+const int kTableBits = 12;
+const int kTableSize = 1 << kTableBits;
+// Bits of the phase below the table index, which interpolate within an
+// interval.
+const int kFractionBits = 64 - kTableBits;
+
+// One cycle of sine with a guard point, so interpolation never wraps.
+const std::vector<double> &SineTable() {
+  static const std::vector<double> table = [] {
+    std::vector<double> values(kTableSize + 1);
+    for (int i = 0; i <= kTableSize; ++i)
+      values[i] = sin(2 * M_PI * i / kTableSize);
+    return values;
+  }();
+  return table;
+}
+
+// 2^-64, which maps the fixed point phase to cycles.
+const double kPhaseScale = 1.0 / 18446744073709551616.0;
+
+}  // namespace
+
+Oscillator::Oscillator() : Oscillator(kQuadrature) {}
+
+Oscillator::Oscillator(Engine engine)
+    : engine_(engine),
+      sample_rate_(1),
+      phase_(0),
+      increment_(0),
+      real_(1.0),
+      imag_(0.0),
+      rotate_real_(1.0),
+      rotate_imag_(0.0),
+      step_real_(1.0),
+      step_imag_(0.0) {
+  for (int j = 0; j < kBlockSize; ++j) {
+    block_real_[j] = 1.0;
+    block_imag_[j] = 0.0;
+  }
+}
+
+Oscillator::Engine Oscillator::engine() const {
+  return engine_;
+}
+
+const char *Oscillator::to_string() const {
+  switch (engine_) {
+    case kPhaseAccumulator:
+      return "accumulator";
+    case kQuadrature:
+      return "quadrature";
+    case kTableLookup:
+      return "table";
+    default:
+      return "INVALID";
+  }
+}
+
+void Oscillator::Reset(double frequency, int sample_rate) {
+  sample_rate_ = sample_rate;
+  phase_ = 0;
+  real_ = 1.0;
+  imag_ = 0.0;
+  SetFrequency(frequency);
+}
+
+void Oscillator::SetFrequency(double frequency) {
+  // Wraps the frequency into [0, sample_rate) first, which aliases to the
+  // same tone and keeps the increment in range.
+  double cycles = frequency / sample_rate_;
+  cycles -= floor(cycles);
+  increment_ = static_cast<uint64_t>(ldexp(cycles, 64));
+
+  // Rotations are computed directly rather than by repeated multiplies, so
+  // each of them is accurate to an ulp.
+  const double omega = 2 * M_PI * cycles;
+  rotate_real_ = cos(omega);
+  rotate_imag_ = sin(omega);
+  for (int j = 0; j < kBlockSize; ++j) {
+    block_real_[j] = cos(omega * j);
+    block_imag_[j] = sin(omega * j);
+  }
+  step_real_ = cos(omega * kBlockSize);
+  step_imag_ = sin(omega * kBlockSize);
+}
+
+double Oscillator::phase() const {
+  if (engine_ == kQuadrature) {
+    const double cycles = atan2(imag_, real_) / (2 * M_PI);
+    return cycles < 0 ? cycles + 1.0 : cycles;
+  }
+  return phase_ * kPhaseScale;
+}
+
+double Oscillator::Next() {
+  double sample;
+  Generate(1, &sample);
+  return sample;
+}
+
+void Oscillator::Generate(int count, double *output) {
+  switch (engine_) {
+    case kPhaseAccumulator:
+      for (int i = 0; i < count; ++i) {
+        output[i] = sin(2 * M_PI * (phase_ * kPhaseScale));
+        phase_ += increment_;
+      }
+      break;
+    case kQuadrature:
+      GenerateQuadrature(count, output);
+      break;
+    case kTableLookup:
+      GenerateTable(count, output);
+      break;
+    default:
+      assert(false);
+  }
+}
+
+void Oscillator::Skip(long long count) {
+  // The product wraps modulo 2^64 like the accumulation of each sample.
+  phase_ += increment_ * static_cast<uint64_t>(count);
+  // The rotation angle is reduced to a cycle before it loses precision.
+  const double cycles = (increment_ * static_cast<uint64_t>(count)) *
+                        kPhaseScale;
+  const double omega = 2 * M_PI * cycles;
+  const double real = real_;
+  real_ = real * cos(omega) - imag_ * sin(omega);
+  imag_ = real * sin(omega) + imag_ * cos(omega);
+  Renormalize();
+}
+
+void Oscillator::GenerateQuadrature(int count, double *output) {
+  int i = 0;
+  // Sample j of a block is the phasor rotated by j samples. Every sample
+  // depends only on the phasor at the start of the block, so the block loop
+  // vectorizes, and rounding errors accumulate once per block instead of once
+  // per sample.
+  for (; i + kBlockSize <= count; i += kBlockSize) {
+    const double real = real_;
+    const double imag = imag_;
+    for (int j = 0; j < kBlockSize; ++j)
+      output[i + j] = real * block_imag_[j] + imag * block_real_[j];
+    real_ = real * step_real_ - imag * step_imag_;
+    imag_ = real * step_imag_ + imag * step_real_;
+    Renormalize();
+  }
+  if (i == count)
+    return;
+  for (; i < count; ++i) {
+    output[i] = imag_;
+    const double real = real_;
+    real_ = real * rotate_real_ - imag_ * rotate_imag_;
+    imag_ = real * rotate_imag_ + imag_ * rotate_real_;
+  }
+  Renormalize();
+}
+
+void Oscillator::Renormalize() {
+  // One Newton step towards magnitude 1 cancels the drift of the rotation.
+  const double gain = (3.0 - real_ * real_ - imag_ * imag_) / 2;
+  real_ *= gain;
+  imag_ *= gain;
+}
+
+void Oscillator::GenerateTable(int count, double *output) {
+  const double *table = SineTable().data();
+  const double kFractionScale = 1.0 / (1ULL << kFractionBits);
+  for (int i = 0; i < count; ++i) {
+    const uint64_t index = phase_ >> kFractionBits;
+    const double fraction =
+        (phase_ & ((1ULL << kFractionBits) - 1)) * kFractionScale;
+    output[i] = table[index] + (table[index + 1] - table[index]) * fraction;
+    phase_ += increment_;
+  }
+}
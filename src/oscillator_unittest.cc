@@ -0,0 +1,91 @@
+// Copyright 2019 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <math.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "include/fft.h"
+#include "include/oscillator.h"
+
+namespace {
+
+const int kSampleRate = 48000;
+// A tone on bin kBin of a kSize points DFT is periodic in the transform, so
+// all the power outside its bin is distortion without a window.
+const int kSize = 65536;
+const int kBin = 1361;
+// Samples played before the second checked block, about 1.5 minutes.
+const long long kOffset = 1LL << 22;
+
+struct Bounds {
+  Oscillator::Engine engine;
+  // Minimum spurious free dynamic range in dB, and maximum error against
+  // sin() in long double.
+  double sfdr_db;
+  double max_error;
+};
+
+// Each engine keeps its accuracy however long it plays. The SFDR bounds sit
+// a few dB under the values audio_bench measures, and the error of the table
+// lookup is bounded by its interpolation error of (2 * pi / 4096)^2 / 8.
+const Bounds kBounds[] = {
+    {Oscillator::kPhaseAccumulator, 290.0, 1e-14},
+    {Oscillator::kQuadrature, 250.0, 1e-9},
+    {Oscillator::kTableLookup, 140.0, 3e-7},
+};
+
+// Generates kSize samples from |offset| on, and returns the SFDR of the
+// block in dB and its max error in |max_error|.
+double MeasureSfdr(Oscillator::Engine engine, long long offset,
+                   double *max_error) {
+  Oscillator oscillator(engine);
+  oscillator.Reset(static_cast<double>(kBin) * kSampleRate / kSize,
+                   kSampleRate);
+  std::vector<double> samples(kSize);
+  for (long long n = 0; n < offset; n += kSize)
+    oscillator.Generate(kSize, samples.data());
+  oscillator.Generate(kSize, samples.data());
+
+  *max_error = 0.0;
+  for (int n = 0; n < kSize; ++n) {
+    const long long cycle = (kBin * (offset + n)) % kSize;
+    const double expected = sinl(2 * M_PIl * cycle / kSize);
+    *max_error = std::max(*max_error, fabs(samples[n] - expected));
+  }
+
+  RealFFT fft(kSize);
+  std::vector<double> spectrum(fft.output_size());
+  fft.Transform(samples.data(), spectrum.data());
+  double carrier = 0.0;
+  double spur = 0.0;
+  for (int k = 1; k < kSize / 2; ++k) {
+    const double power = spectrum[2 * k] * spectrum[2 * k] +
+                         spectrum[2 * k + 1] * spectrum[2 * k + 1];
+    if (k == kBin)
+      carrier = power;
+    else
+      spur = std::max(spur, power);
+  }
+  return 10 * log10(carrier / std::max(spur, 1e-300));
+}
+
+TEST(OscillatorTest, SfdrIsBounded) {
+  for (const Bounds &bounds : kBounds) {
+    for (long long offset : {0LL, kOffset}) {
+      double max_error;
+      const double sfdr_db = MeasureSfdr(bounds.engine, offset, &max_error);
+      const char *name = Oscillator(bounds.engine).to_string();
+      EXPECT_GE(sfdr_db, bounds.sfdr_db)
+          << name << " after " << offset << " samples";
+      EXPECT_LE(max_error, bounds.max_error)
+          << name << " after " << offset << " samples";
+    }
+  }
+}
+
+}  // namespace
@@ -0,0 +1,150 @@
+// Copyright 2019 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "include/pilot_tracker.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "include/window.h"
+
+namespace {
+
+// A block holds the pilot if the pilot is at least this ratio of the windowed
+// power of the block, and its amplitude is above kMinAmplitude of full scale.
+// Noise alone leaves a ratio of about 3 / block_frames, so the noise before
+// and after the pilot is not tracked, and digital silence fails the
+// amplitude.
+const double kMinPilotRatio = 0.5;
+const double kMinAmplitude = 1e-4;
+
+// A cycle of the 64-bit phase.
+const double kCycle = 18446744073709551616.0;
+
+// Sums the samples of each channel times |cosine| and |sine| over
+// |num_frames| interleaved frames into |real| and |imag|, and their squares
+// times the squared window into |power|.
+void Demodulate(const double *__restrict samples,
+                const double *__restrict cosine,
+                const double *__restrict sine, int num_frames,
+                int num_channels, double *__restrict real,
+                double *__restrict imag, double *__restrict power) {
+  for (int i = 0; i < num_frames; ++i) {
+    const double *x = samples + i * num_channels;
+    const double window_square = cosine[i] * cosine[i] + sine[i] * sine[i];
+    for (int c = 0; c < num_channels; ++c) {
+      real[c] += x[c] * cosine[i];
+      imag[c] += x[c] * sine[i];
+      power[c] += x[c] * x[c] * window_square;
+    }
+  }
+}
+
+}  // namespace
+
+PilotTracker::PilotTracker(int sample_rate, int num_channels,
+                           int block_frames, SampleFormat format,
+                           double frequency)
+    : sample_rate_(sample_rate),
+      num_channels_(num_channels),
+      block_frames_(block_frames),
+      format_(format),
+      frequency_(frequency),
+      increment_(frequency / sample_rate * kCycle),
+      cosine_(block_frames),
+      sine_(block_frames),
+      window_sum_(0.0),
+      window_square_sum_(0.0),
+      samples_(block_frames * num_channels),
+      real_(num_channels),
+      imag_(num_channels),
+      power_(num_channels),
+      amplitude_(num_channels),
+      fits_(num_channels) {
+  const std::vector<double> window =
+      WindowFunction(WindowFunction::kHann).Generate(block_frames);
+  for (int i = 0; i < block_frames; ++i) {
+    const double theta =
+        2 * M_PI * static_cast<double>(i * increment_) / kCycle;
+    cosine_[i] = window[i] * cos(theta);
+    sine_[i] = window[i] * sin(theta);
+    window_sum_ += window[i];
+    window_square_sum_ += window[i] * window[i];
+  }
+  Reset();
+}
+
+void PilotTracker::Reset() {
+  std::fill(amplitude_.begin(), amplitude_.end(), 0.0);
+  for (Fit &fit : fits_)
+    fit = Fit();
+}
+
+void PilotTracker::AddFrames(const void *data, uint64_t first_frame) {
+  ConvertSamples(data, block_frames_ * num_channels_, format_,
+                 samples_.data());
+  std::fill(real_.begin(), real_.end(), 0.0);
+  std::fill(imag_.begin(), imag_.end(), 0.0);
+  std::fill(power_.begin(), power_.end(), 0.0);
+  Demodulate(samples_.data(), cosine_.data(), sine_.data(), block_frames_,
+             num_channels_, real_.data(), imag_.data(), power_.data());
+
+  // The sums are relative to the first frame, so they are rotated by its
+  // phase. The symmetric window centers the phase on the block.
+  const double start =
+      2 * M_PI * static_cast<double>(first_frame * increment_) / kCycle;
+  const double start_cos = cos(start);
+  const double start_sin = sin(start);
+  const double time =
+      (first_frame + (block_frames_ - 1) / 2.0) / sample_rate_;
+  for (int c = 0; c < num_channels_; ++c) {
+    // (real - j * imag) * exp(-j * start)
+    const double real = real_[c] * start_cos - imag_[c] * start_sin;
+    const double imag = -(real_[c] * start_sin + imag_[c] * start_cos);
+    // A sine of amplitude A demodulates to A / 2 times the window sum, and
+    // its windowed power is A^2 / 2 times the sum of the squared window.
+    const double amplitude = 2 * hypot(real, imag) / window_sum_;
+    const double pilot_power =
+        amplitude * amplitude / 2 * window_square_sum_;
+    if (amplitude < kMinAmplitude ||
+        pilot_power < kMinPilotRatio * power_[c])
+      continue;
+    amplitude_[c] = amplitude;
+    AddPhase(time, atan2(imag, real), &fits_[c]);
+  }
+}
+
+double PilotTracker::drift_ppm(int channel) const {
+  const Fit &fit = fits_[channel];
+  if (fit.count < 3)
+    return NAN;
+  return fit.time_phase / fit.time_time / (2 * M_PI * frequency_) * 1e6;
+}
+
+double PilotTracker::jitter_sec(int channel) const {
+  const Fit &fit = fits_[channel];
+  if (fit.count < 3)
+    return NAN;
+  const double residual =
+      fit.phase_phase - fit.time_phase * fit.time_phase / fit.time_time;
+  return sqrt(std::max(residual, 0.0) / (fit.count - 2)) /
+         (2 * M_PI * frequency_);
+}
+
+void PilotTracker::AddPhase(double time, double phase, Fit *fit) {
+  // The phase moves by far less than half a cycle between blocks for any
+  // realistic drift, so the nearest turn continues the last phase.
+  if (fit->count > 0)
+    phase = fit->phase + remainder(phase - fit->phase, 2 * M_PI);
+  fit->phase = phase;
+
+  ++fit->count;
+  const double time_delta = time - fit->mean_time;
+  const double phase_delta = phase - fit->mean_phase;
+  fit->mean_time += time_delta / fit->count;
+  fit->mean_phase += phase_delta / fit->count;
+  fit->time_time += time_delta * (time - fit->mean_time);
+  fit->time_phase += time_delta * (phase - fit->mean_phase);
+  fit->phase_phase += phase_delta * (phase - fit->mean_phase);
+}
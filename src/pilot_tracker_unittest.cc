@@ -0,0 +1,74 @@
+// Copyright 2019 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <math.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "include/pilot_tracker.h"
+#include "include/sample_format.h"
+
+namespace {
+
+const int kSampleRate = 48000;
+const int kNumChannels = 3;
+const int kBlockFrames = 2048;
+const double kPilotFrequency = 1000.0;
+const int kNumFrames = 10 * kSampleRate;
+// The pilot starts after half a second of noise.
+const int kOnsetFrame = kSampleRate / 2;
+
+// Drift of the playback clock of each channel in ppm. Channel 2 is silent.
+const double kDriftPpm[kNumChannels] = {100.0, -100.0, 0.0};
+
+// A pilot played by a clock running 100 ppm fast or slow is recorded as the
+// pilot resampled to 1 +- 1e-4 times its frequency. The tracker reads the
+// drift within 0.01 ppm under noise at -70 dBFS, skips the noise before the
+// pilot, and finds no pilot in a silent channel.
+TEST(PilotTrackerTest, ReadsResampledPilot) {
+  const SampleFormat format(SampleFormat::kPcmS16);
+  std::vector<uint8_t> data(kNumFrames * kNumChannels * format.bytes());
+  std::vector<double> noise(kNumFrames * kNumChannels);
+  UniformNoise(1).Generate(noise.size(), noise.data());
+  void *buf = data.data();
+  for (int n = 0; n < kNumFrames; ++n) {
+    for (int c = 0; c < kNumChannels; ++c) {
+      double sample = 0.0;
+      if (c < 2) {
+        sample = 3e-4 * noise[n * kNumChannels + c];
+        if (n >= kOnsetFrame) {
+          const double cycles = kPilotFrequency *
+                                (1 + kDriftPpm[c] * 1e-6) * n / kSampleRate;
+          sample += 0.1 * sin(2 * M_PI * cycles + 0.3);
+        }
+      }
+      buf = WriteSample(sample, format, buf);
+    }
+  }
+
+  PilotTracker tracker(kSampleRate, kNumChannels, kBlockFrames, format,
+                       kPilotFrequency);
+  const size_t block_bytes = kBlockFrames * kNumChannels * format.bytes();
+  int num_blocks = 0;
+  for (int n = 0; n + kBlockFrames <= kNumFrames; n += kBlockFrames) {
+    tracker.AddFrames(&data[n / kBlockFrames * block_bytes], n);
+    ++num_blocks;
+  }
+
+  // Blocks before the onset and the one across it have no pilot to track.
+  const int pilot_blocks = num_blocks - kOnsetFrame / kBlockFrames - 1;
+  for (int c = 0; c < 2; ++c) {
+    EXPECT_EQ(pilot_blocks, tracker.num_blocks(c)) << "channel " << c;
+    EXPECT_NEAR(kDriftPpm[c], tracker.drift_ppm(c), 0.01)
+        << "channel " << c;
+    EXPECT_NEAR(0.1, tracker.amplitude(c), 1e-3) << "channel " << c;
+  }
+  EXPECT_EQ(0, tracker.num_blocks(2));
+  EXPECT_TRUE(isnan(tracker.drift_ppm(2)));
+}
+
+}  // namespace
@@ -7,50 +7,556 @@
 #include <assert.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 
+#include <algorithm>
+#include <cmath>
 #include <limits>
 
 namespace {
 
+// Accessors of a single sample in native byte order. Read() returns the
+// sample as a Value, a signed integer or float, and multiplying it by Scale()
+// maps the sample into [-1.0, 1.0). Write() stores a Value the other way
+// around, in [kMin, kMax] for integer formats. kBytes is the container size
+// of a sample, which SampleFormat::bytes() reports.
+struct U8Sample {
+  typedef int32_t Value;
+  static const int kBytes = 1;
+  static const int32_t kMin = -(1 << 7);
+  static const int32_t kMax = (1 << 7) - 1;
+  static int32_t Read(const uint8_t *data) {
+    return static_cast<int32_t>(data[0]) - 128;
+  }
+  static void Write(uint8_t *data, int32_t value) { data[0] = value + 128; }
+  static double Scale() { return 1.0 / (1 << 7); }
+};
+
+struct S16Sample {
+  typedef int32_t Value;
+  static const int kBytes = 2;
+  static const int32_t kMin = -(1 << 15);
+  static const int32_t kMax = (1 << 15) - 1;
+  static int32_t Read(const uint8_t *data) {
+    int16_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+  }
+  static void Write(uint8_t *data, int32_t value) {
+    const int16_t sample = value;
+    memcpy(data, &sample, sizeof(sample));
+  }
+  static double Scale() { return 1.0 / (1 << 15); }
+};
+
+// 24-bit samples packed in 3 bytes.
+struct S24PackedSample {
+  typedef int32_t Value;
+  static const int kBytes = 3;
+  static const int32_t kMin = -(1 << 23);
+  static const int32_t kMax = (1 << 23) - 1;
+  static int32_t Read(const uint8_t *data) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    const uint32_t value = (static_cast<uint32_t>(data[0]) << 24) |
+                           (static_cast<uint32_t>(data[1]) << 16) |
+                           (static_cast<uint32_t>(data[2]) << 8);
+#else
+    const uint32_t value = (static_cast<uint32_t>(data[0]) << 8) |
+                           (static_cast<uint32_t>(data[1]) << 16) |
+                           (static_cast<uint32_t>(data[2]) << 24);
+#endif
+    // Arithmetic shift extends the sign bit.
+    return static_cast<int32_t>(value) >> 8;
+  }
+  static void Write(uint8_t *data, int32_t value) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    data[0] = value >> 16;
+    data[1] = value >> 8;
+    data[2] = value;
+#else
+    data[0] = value;
+    data[1] = value >> 8;
+    data[2] = value >> 16;
+#endif
+  }
+  static double Scale() { return 1.0 / (1 << 23); }
+};
+
+// 24-bit samples in the lower 3 bytes of 4 bytes.
+struct S24In32Sample {
+  typedef int32_t Value;
+  static const int kBytes = 4;
+  static const int32_t kMin = -(1 << 23);
+  static const int32_t kMax = (1 << 23) - 1;
+  static int32_t Read(const uint8_t *data) {
+    uint32_t value;
+    memcpy(&value, data, sizeof(value));
+    return static_cast<int32_t>(value << 8) >> 8;
+  }
+  static void Write(uint8_t *data, int32_t value) {
+    memcpy(data, &value, sizeof(value));
+  }
+  static double Scale() { return 1.0 / (1 << 23); }
+};
+
+struct S32Sample {
+  typedef int32_t Value;
+  static const int kBytes = 4;
+  static const int32_t kMin = std::numeric_limits<int32_t>::min();
+  static const int32_t kMax = std::numeric_limits<int32_t>::max();
+  static int32_t Read(const uint8_t *data) {
+    int32_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+  }
+  static void Write(uint8_t *data, int32_t value) {
+    memcpy(data, &value, sizeof(value));
+  }
+  static double Scale() { return 1.0 / (1u << 31); }
+};
+
+// 32-bit float samples, nominally in [-1.0, 1.0].
+struct FloatSample {
+  typedef float Value;
+  static const int kBytes = 4;
+  static float Read(const uint8_t *data) {
+    float value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+  }
+  static void Write(uint8_t *data, float value) {
+    memcpy(data, &value, sizeof(value));
+  }
+  static double Scale() { return 1.0; }
+};
+
+// Number of samples converted in a block. The constant trip count of the
+// inner loops lets the compiler vectorize them.
+const int kBlockSize = 16;
+
+// Converts |count| samples |stride| samples apart in |data| into |output|.
+template <typename Format, typename T>
+void ConvertStrided(const uint8_t *data, int count, int stride, T *output) {
+  const T scale = Format::Scale();
+  const size_t step = static_cast<size_t>(stride) * Format::kBytes;
+  int i = 0;
+  for (; i + kBlockSize <= count; i += kBlockSize) {
+    // Reads the whole block before writing, since |output| may alias |data|
+    // as far as the compiler knows.
+    T block[kBlockSize];
+    for (int j = 0; j < kBlockSize; ++j)
+      block[j] = static_cast<T>(Format::Read(data + j * step)) * scale;
+    for (int j = 0; j < kBlockSize; ++j)
+      output[i + j] = block[j];
+    data += kBlockSize * step;
+  }
+  for (; i < count; ++i) {
+    output[i] = static_cast<T>(Format::Read(data)) * scale;
+    data += step;
+  }
+}
+
+// Deinterleaves |num_frames| frames into |planes|. |kChannels| is the
+// number of channels known at compile time, or 0 to use |num_channels|.
+template <typename Format, int kChannels, typename T>
+void DeinterleaveChannels(const uint8_t *data, int num_frames,
+                          int num_channels, T *const *planes) {
+  const int channels = kChannels > 0 ? kChannels : num_channels;
+  for (int c = 0; c < channels; ++c) {
+    ConvertStrided<Format, T>(data + c * Format::kBytes, num_frames, channels,
+                              planes[c]);
+  }
+}
+
+template <typename Format, typename T>
+void DeinterleaveSamples(const uint8_t *data, int num_frames, int num_channels,
+                  T *const *planes) {
+  switch (num_channels) {
+    case 1:
+      ConvertStrided<Format, T>(data, num_frames, 1, planes[0]);
+      break;
+    case 2:
+      DeinterleaveChannels<Format, 2, T>(data, num_frames, 2, planes);
+      break;
+    case 4:
+      DeinterleaveChannels<Format, 4, T>(data, num_frames, 4, planes);
+      break;
+    case 8:
+      DeinterleaveChannels<Format, 8, T>(data, num_frames, 8, planes);
+      break;
+    default:
+      DeinterleaveChannels<Format, 0, T>(data, num_frames, num_channels,
+                                         planes);
+      break;
+  }
+}
+
+template <typename T>
+void DeinterleaveFormat(const void *data, int num_frames, SampleFormat format,
+                        int num_channels, T *const *planes) {
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+  switch (format.type()) {
+    case SampleFormat::kPcmU8:
+      DeinterleaveSamples<U8Sample>(bytes, num_frames, num_channels, planes);
+      break;
+    case SampleFormat::kPcmS16:
+      DeinterleaveSamples<S16Sample>(bytes, num_frames, num_channels, planes);
+      break;
+    case SampleFormat::kPcmS24:
+      DeinterleaveSamples<S24PackedSample>(bytes, num_frames, num_channels,
+                                           planes);
+      break;
+    case SampleFormat::kPcmS24In32:
+      DeinterleaveSamples<S24In32Sample>(bytes, num_frames, num_channels,
+                                         planes);
+      break;
+    case SampleFormat::kPcmS32:
+      DeinterleaveSamples<S32Sample>(bytes, num_frames, num_channels, planes);
+      break;
+    case SampleFormat::kPcmFloat:
+      DeinterleaveSamples<FloatSample>(bytes, num_frames, num_channels,
+                                       planes);
+      break;
+    default:
+      assert(false);
+  }
+}
+
+template <typename T>
+void ConvertFormat(const void *data, int num_samples, SampleFormat format,
+                   T *output) {
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+  switch (format.type()) {
+    case SampleFormat::kPcmU8:
+      ConvertStrided<U8Sample>(bytes, num_samples, 1, output);
+      break;
+    case SampleFormat::kPcmS16:
+      ConvertStrided<S16Sample>(bytes, num_samples, 1, output);
+      break;
+    case SampleFormat::kPcmS24:
+      ConvertStrided<S24PackedSample>(bytes, num_samples, 1, output);
+      break;
+    case SampleFormat::kPcmS24In32:
+      ConvertStrided<S24In32Sample>(bytes, num_samples, 1, output);
+      break;
+    case SampleFormat::kPcmS32:
+      ConvertStrided<S32Sample>(bytes, num_samples, 1, output);
+      break;
+    case SampleFormat::kPcmFloat:
+      ConvertStrided<FloatSample>(bytes, num_samples, 1, output);
+      break;
+    default:
+      assert(false);
+  }
+}
+
+// Rounds |value| half away from zero into [Format::kMin, Format::kMax].
+// Clamping before the conversion keeps full scale from wrapping around, and
+// the truncating conversion with a sign-dependent offset vectorizes, unlike
+// lrint() and floor(). The clamps and the offset compile to min, max and sign
+// bit operations rather than branches, which noise would mispredict on every
+// sample where the loop stays scalar.
+template <typename Format>
+inline typename Format::Value Quantize(double value) {
+  value = std::max(value, static_cast<double>(Format::kMin));
+  value = std::min(value, static_cast<double>(Format::kMax));
+  return static_cast<int32_t>(value + std::copysign(0.5, value));
+}
+
+// Float samples are stored as they are, since they have headroom above full
+// scale.
+template <>
+inline float Quantize<FloatSample>(double value) {
+  return static_cast<float>(value);
+}
+
+// Quantizes |count| samples of |input| multiplied by |gain| plus |noise|.
+// Called with |count| = kBlockSize, the loop is unrolled and vectorized.
+template <typename Format, typename T>
+inline void QuantizeBlock(const T *__restrict input, double gain,
+                          const double *__restrict noise, int count,
+                          typename Format::Value *__restrict output) {
+  for (int j = 0; j < count; ++j)
+    output[j] = Quantize<Format>(input[j] * gain + noise[j]);
+}
+
+// Interleaves |num_frames| frames of |planes| into |data|. |kChannels| is the
+// number of channels known at compile time, or 0 to use |num_channels|.
+template <typename Format, int kChannels, typename T>
+void InterleaveChannels(const T *const *planes, const double *gains,
+                        int num_frames, int num_channels, TpdfDither *dither,
+                        uint8_t *data) {
+  const int channels = kChannels > 0 ? kChannels : num_channels;
+  const size_t step = static_cast<size_t>(channels) * Format::kBytes;
+  const double scale = 1.0 / Format::Scale();
+  double noise[kBlockSize] = {};
+  typename Format::Value block[kBlockSize];
+  for (int i = 0; i < num_frames; i += kBlockSize) {
+    const int count = std::min(kBlockSize, num_frames - i);
+    for (int c = 0; c < channels; ++c) {
+      uint8_t *output = data + i * step + c * Format::kBytes;
+      if (!planes[c] || gains[c] == 0) {
+        for (int j = 0; j < count; ++j)
+          Format::Write(output + j * step, 0);
+        continue;
+      }
+      if (dither)
+        dither->Generate(kBlockSize, noise);
+      if (count == kBlockSize) {
+        QuantizeBlock<Format>(planes[c] + i, gains[c] * scale, noise,
+                              kBlockSize, block);
+      } else {
+        QuantizeBlock<Format>(planes[c] + i, gains[c] * scale, noise, count,
+                              block);
+      }
+      for (int j = 0; j < count; ++j)
+        Format::Write(output + j * step, block[j]);
+    }
+  }
+}
+
+template <typename Format, typename T>
+void InterleaveSamples(const T *const *planes, const double *gains,
+                       int num_frames, int num_channels, TpdfDither *dither,
+                       uint8_t *data) {
+  switch (num_channels) {
+    case 1:
+      InterleaveChannels<Format, 1, T>(planes, gains, num_frames, 1, dither,
+                                       data);
+      break;
+    case 2:
+      InterleaveChannels<Format, 2, T>(planes, gains, num_frames, 2, dither,
+                                       data);
+      break;
+    case 4:
+      InterleaveChannels<Format, 4, T>(planes, gains, num_frames, 4, dither,
+                                       data);
+      break;
+    case 8:
+      InterleaveChannels<Format, 8, T>(planes, gains, num_frames, 8, dither,
+                                       data);
+      break;
+    default:
+      InterleaveChannels<Format, 0, T>(planes, gains, num_frames,
+                                       num_channels, dither, data);
+      break;
+  }
+}
+
 template <typename T>
-void *WriteSample(double sample, void *data) {
-  // Handle unsigned.
-  if (std::numeric_limits<T>::min() == 0) {
-    sample = (sample + 1.0) / 2.0;
+void *InterleaveFormat(const T *const *planes, const double *gains,
+                       int num_frames, int num_channels, SampleFormat format,
+                       void *data, TpdfDither *dither) {
+  uint8_t *bytes = static_cast<uint8_t *>(data);
+  switch (format.type()) {
+    case SampleFormat::kPcmU8:
+      InterleaveSamples<U8Sample>(planes, gains, num_frames, num_channels,
+                                  dither, bytes);
+      break;
+    case SampleFormat::kPcmS16:
+      InterleaveSamples<S16Sample>(planes, gains, num_frames, num_channels,
+                                   dither, bytes);
+      break;
+    case SampleFormat::kPcmS24:
+      InterleaveSamples<S24PackedSample>(planes, gains, num_frames,
+                                         num_channels, dither, bytes);
+      break;
+    case SampleFormat::kPcmS24In32:
+      InterleaveSamples<S24In32Sample>(planes, gains, num_frames, num_channels,
+                                       dither, bytes);
+      break;
+    case SampleFormat::kPcmS32:
+      InterleaveSamples<S32Sample>(planes, gains, num_frames, num_channels,
+                                   dither, bytes);
+      break;
+    case SampleFormat::kPcmFloat:
+      // Float samples have no LSB to dither.
+      InterleaveSamples<FloatSample>(planes, gains, num_frames, num_channels,
+                                     NULL, bytes);
+      break;
+    default:
+      assert(false);
+      return NULL;
   }
+  return bytes + static_cast<size_t>(num_frames) * num_channels *
+                     format.bytes();
+}
 
-  *(reinterpret_cast<T *>(data)) = sample * std::numeric_limits<T>::max();
-  return reinterpret_cast<T *>(data) + 1;
+// Writes |samples| into every channel with a non-zero gain, all of which are
+// |gain|, and silence into the others. Each sample is quantized once, and
+// the constant number of channels |kChannels| turns the stores of a frame
+// into a few vector stores.
+template <typename Format, int kChannels, typename T>
+void BroadcastChannels(const T *samples, double gain, const double *gains,
+                       int num_frames, uint8_t *data) {
+  const size_t step = kChannels * Format::kBytes;
+  // 1 for active channels and 0 for silent ones, which multiplies the
+  // samples into their channels without branches. Adding 0 turns the -0.0 of
+  // negative float samples into silence like Interleave() writes.
+  typename Format::Value active[kChannels];
+  for (int c = 0; c < kChannels; ++c)
+    active[c] = gains[c] != 0;
+  const typename Format::Value silence = 0;
+  const double noise[kBlockSize] = {};
+  typename Format::Value block[kBlockSize];
+  for (int i = 0; i < num_frames; i += kBlockSize) {
+    const int count = std::min(kBlockSize, num_frames - i);
+    if (count == kBlockSize) {
+      QuantizeBlock<Format>(samples + i, gain / Format::Scale(), noise,
+                            kBlockSize, block);
+    } else {
+      QuantizeBlock<Format>(samples + i, gain / Format::Scale(), noise, count,
+                            block);
+    }
+    uint8_t *output = data + i * step;
+    for (int j = 0; j < count; ++j) {
+      for (int c = 0; c < kChannels; ++c)
+        Format::Write(output + c * Format::kBytes,
+                      block[j] * active[c] + silence);
+      output += step;
+    }
+  }
 }
 
-// Detects big endian at run time.
-bool *gIsBigEndian = 0;
-bool IsBigEndian() {
-  if (!gIsBigEndian) {
-    gIsBigEndian = new bool;
-    union {
-      uint32_t i;
-      char c[4];
-    } combine = {0x01020304};
-    *gIsBigEndian = combine.c[0] == 1;
+// Returns false if the channel count or gains have no broadcast path, which
+// then falls back to Interleave().
+template <typename Format, typename T>
+bool BroadcastSamples(const T *samples, double gain, const double *gains,
+                      int num_frames, int num_channels, uint8_t *data) {
+  switch (num_channels) {
+    case 1:
+      BroadcastChannels<Format, 1>(samples, gain, gains, num_frames, data);
+      return true;
+    case 2:
+      BroadcastChannels<Format, 2>(samples, gain, gains, num_frames, data);
+      return true;
+    case 4:
+      BroadcastChannels<Format, 4>(samples, gain, gains, num_frames, data);
+      return true;
+    case 8:
+      BroadcastChannels<Format, 8>(samples, gain, gains, num_frames, data);
+      return true;
+    // TDM test configurations.
+    case 16:
+      BroadcastChannels<Format, 16>(samples, gain, gains, num_frames, data);
+      return true;
+    case 32:
+      BroadcastChannels<Format, 32>(samples, gain, gains, num_frames, data);
+      return true;
+    default:
+      return false;
   }
-  return *gIsBigEndian;
 }
 
-#define BYTE(X, i) (reinterpret_cast<uint8_t *>(&(X))[(i)])
+template <typename T>
+void *BroadcastFormat(const T *samples, const double *gains, int num_frames,
+                      int num_channels, SampleFormat format, void *data,
+                      TpdfDither *dither) {
+  // Broadcasting needs all active channels to have the same gain. Dithered
+  // channels get independent noise, so they are not broadcast either.
+  double gain = 0.0;
+  bool uniform = !dither || format.type() == SampleFormat::kPcmFloat;
+  for (int c = 0; c < num_channels && uniform; ++c) {
+    if (gains[c] == 0)
+      continue;
+    if (gain == 0)
+      gain = gains[c];
+    else
+      uniform = gains[c] == gain;
+  }
 
-// Reads from raw data and returns a sample between 1.0 ~ -1.0.
-template<typename T>
-double ReadSample(T data) {
-  double val = static_cast<double>(data) / std::numeric_limits<T>::max();
-  if (std::numeric_limits<T>::min() == 0) {
-    val = val * 2.0 - 1.0;
+  uint8_t *bytes = static_cast<uint8_t *>(data);
+  bool done = false;
+  if (uniform) {
+    switch (format.type()) {
+      case SampleFormat::kPcmU8:
+        done = BroadcastSamples<U8Sample>(samples, gain, gains, num_frames,
+                                          num_channels, bytes);
+        break;
+      case SampleFormat::kPcmS16:
+        done = BroadcastSamples<S16Sample>(samples, gain, gains, num_frames,
+                                           num_channels, bytes);
+        break;
+      case SampleFormat::kPcmS24:
+        done = BroadcastSamples<S24PackedSample>(samples, gain, gains,
+                                                 num_frames, num_channels,
+                                                 bytes);
+        break;
+      case SampleFormat::kPcmS24In32:
+        done = BroadcastSamples<S24In32Sample>(samples, gain, gains,
+                                               num_frames, num_channels,
+                                               bytes);
+        break;
+      case SampleFormat::kPcmS32:
+        done = BroadcastSamples<S32Sample>(samples, gain, gains, num_frames,
+                                           num_channels, bytes);
+        break;
+      case SampleFormat::kPcmFloat:
+        done = BroadcastSamples<FloatSample>(samples, gain, gains, num_frames,
+                                             num_channels, bytes);
+        break;
+      default:
+        assert(false);
+        return NULL;
+    }
+  }
+  if (!done) {
+    const std::vector<const T *> planes(num_channels, samples);
+    return InterleaveFormat(planes.data(), gains, num_frames, num_channels,
+                            format, data, dither);
   }
-  return val;
+  return bytes + static_cast<size_t>(num_frames) * num_channels *
+                     format.bytes();
+}
+
+template <typename Format>
+void *WriteFormat(double sample, void *buf) {
+  uint8_t *data = static_cast<uint8_t *>(buf);
+  Format::Write(data, Quantize<Format>(sample / Format::Scale()));
+  return data + Format::kBytes;
+}
+
+// Hashes a 32-bit counter into uniformly distributed bits. It is a few
+// multiplies and shifts without state carried between samples, so a block of
+// counters is hashed in vector registers.
+inline uint32_t HashCounter(uint32_t x) {
+  x ^= x >> 16;
+  x *= 0x7feb352dU;
+  x ^= x >> 15;
+  x *= 0x846ca68bU;
+  x ^= x >> 16;
+  return x;
 }
 
 }  // namespace
 
+TpdfDither::TpdfDither(uint32_t seed)
+    : counter_(HashCounter(seed)) {}
+
+void TpdfDither::Generate(int count, double *noise) {
+  // The difference of two independent uniform values in [0, 1) has a
+  // triangular distribution in (-1, 1).
+  const double kScale = 1.0 / (1 << 16);
+  const uint32_t counter = counter_;
+  for (int i = 0; i < count; ++i) {
+    const uint32_t bits = HashCounter(counter + i);
+    noise[i] = (static_cast<int32_t>(bits & 0xffff) -
+                static_cast<int32_t>(bits >> 16)) * kScale;
+  }
+  counter_ += count;
+}
+
+UniformNoise::UniformNoise(uint32_t seed)
+    : counter_(HashCounter(seed)) {}
+
+void UniformNoise::Generate(int count, double *noise) {
+  const double kScale = 1.0 / 2147483648.0;
+  const uint32_t counter = counter_;
+  for (int i = 0; i < count; ++i)
+    noise[i] = static_cast<int32_t>(HashCounter(counter + i)) * kScale;
+  counter_ += count;
+}
+
 SampleFormat::SampleFormat(): type_(kPcmInvalid) {}
 SampleFormat::SampleFormat(Type type): type_(type) {}
 
@@ -69,8 +575,12 @@ const char *SampleFormat::to_string() const {
       return "s16";
     case kPcmS24:
       return "s24";
+    case kPcmS24In32:
+      return "s24_32";
     case kPcmS32:
       return "s32";
+    case kPcmFloat:
+      return "float";
     default:
       return "INVALID";
   }
@@ -79,13 +589,17 @@ const char *SampleFormat::to_string() const {
 size_t SampleFormat::bytes() const {
   switch (type_) {
     case kPcmU8:
-      return 1;
+      return U8Sample::kBytes;
     case kPcmS16:
-      return 2;
+      return S16Sample::kBytes;
     case kPcmS24:
-      return 3;
+      return S24PackedSample::kBytes;
+    case kPcmS24In32:
+      return S24In32Sample::kBytes;
     case kPcmS32:
-      return 4;
+      return S32Sample::kBytes;
+    case kPcmFloat:
+      return FloatSample::kBytes;
     default:
       return -1;
   }
@@ -96,67 +610,88 @@ bool SampleFormat::operator==(const SampleFormat &format) const {
 }
 
 void *WriteSample(double sample, SampleFormat format, void *buf) {
-  if (format.type() == SampleFormat::kPcmU8) {
-    return WriteSample<uint8_t>(sample, buf);
-  } else if (format.type() == SampleFormat::kPcmS16) {
-    return WriteSample<int16_t>(sample, buf);
-  } else if (format.type() == SampleFormat::kPcmS24) {
-    uint8_t *sample_data = reinterpret_cast<uint8_t *>(buf);
-    int32_t value = sample * (1 << 23);  // 1 << 23 24-bit singed max().
-    if (IsBigEndian()) {
-      for (int i = 0; i < 3; i++) {
-        sample_data[i] = BYTE(value, i+1);
-      }
-    } else {
-      for (int i = 0; i < 3; i++) {
-        sample_data[i] = BYTE(value, i);
-      }
-    }
-    return sample_data + 3;
-  } else if (format.type() == SampleFormat::kPcmS32) {
-    return WriteSample<int32_t>(sample, buf);
+  switch (format.type()) {
+    case SampleFormat::kPcmU8:
+      return WriteFormat<U8Sample>(sample, buf);
+    case SampleFormat::kPcmS16:
+      return WriteFormat<S16Sample>(sample, buf);
+    case SampleFormat::kPcmS24:
+      return WriteFormat<S24PackedSample>(sample, buf);
+    case SampleFormat::kPcmS24In32:
+      return WriteFormat<S24In32Sample>(sample, buf);
+    case SampleFormat::kPcmS32:
+      return WriteFormat<S32Sample>(sample, buf);
+    case SampleFormat::kPcmFloat:
+      return WriteFormat<FloatSample>(sample, buf);
+    default:
+      assert(false);
+      return NULL;
   }
-  assert(false);
-  return NULL;
+}
+
+void *Interleave(const double *const *planes, const double *gains,
+                 int num_frames, int num_channels, SampleFormat format,
+                 void *data, TpdfDither *dither) {
+  return InterleaveFormat(planes, gains, num_frames, num_channels, format,
+                          data, dither);
+}
+
+void *Interleave(const float *const *planes, const double *gains,
+                 int num_frames, int num_channels, SampleFormat format,
+                 void *data, TpdfDither *dither) {
+  return InterleaveFormat(planes, gains, num_frames, num_channels, format,
+                          data, dither);
+}
+
+void *Broadcast(const double *samples, const double *gains, int num_frames,
+                int num_channels, SampleFormat format, void *data,
+                TpdfDither *dither) {
+  return BroadcastFormat(samples, gains, num_frames, num_channels, format,
+                         data, dither);
+}
+
+void *Broadcast(const float *samples, const double *gains, int num_frames,
+                int num_channels, SampleFormat format, void *data,
+                TpdfDither *dither) {
+  return BroadcastFormat(samples, gains, num_frames, num_channels, format,
+                         data, dither);
 }
 
 void *ReadSample(SampleFormat format, void *data, double *sample) {
-  if (format.type() == SampleFormat::kPcmU8) {
-    *sample = ReadSample<>(*reinterpret_cast<uint8_t *>(data));
-    return reinterpret_cast<uint8_t *>(data) + 1;
-  } else if (format.type() == SampleFormat::kPcmS16) {
-    *sample = ReadSample<>(*reinterpret_cast<uint16_t *>(data));
-    return reinterpret_cast<uint16_t *>(data) + 1;
-  } else if (format.type() == SampleFormat::kPcmS24) {
-    int32_t value = 0;
-    uint8_t *ptr = static_cast<uint8_t *>(data);
-    if (IsBigEndian()) {
-      for (int i = 2; i >= 0; i--)
-        value |= (static_cast<int>(*(ptr++))) << (8 * i);
-    } else {
-      for (int i = 0; i < 3; i++)
-        value |= (static_cast<int>(*(ptr++))) << (8 * i);
-    }
-    *sample = static_cast<double>(value) / (1 << 23);
-    return ptr + 3;
-  } else if (format.type() == SampleFormat::kPcmS32) {
-    *sample = ReadSample<>(*reinterpret_cast<uint32_t *>(data));
-    return reinterpret_cast<uint32_t *>(data) + 1;
-  }
-  assert(false);
-  return NULL;
+  ConvertFormat(data, 1, format, sample);
+  return static_cast<uint8_t *>(data) + format.bytes();
+}
+
+void Deinterleave(const void *data, int num_frames, SampleFormat format,
+                  int num_channels, double *const *planes) {
+  DeinterleaveFormat(data, num_frames, format, num_channels, planes);
+}
+
+void Deinterleave(const void *data, int num_frames, SampleFormat format,
+                  int num_channels, float *const *planes) {
+  DeinterleaveFormat(data, num_frames, format, num_channels, planes);
+}
+
+void ConvertSamples(const void *data, int num_samples, SampleFormat format,
+                    double *output) {
+  ConvertFormat(data, num_samples, format, output);
+}
+
+void ConvertSamples(const void *data, int num_samples, SampleFormat format,
+                    float *output) {
+  ConvertFormat(data, num_samples, format, output);
 }
 
 int Unpack(void *data, size_t data_size,
            SampleFormat format, int num_channels,
            std::vector<std::vector<double> > *output) {
   int num_frames = data_size / format.bytes() / num_channels;
-  output->clear();
-  output->resize(num_channels, std::vector<double>(num_frames));
-  for (int i = 0; i < num_frames; ++i) {
-    for (int c = 0; c < num_channels; ++c) {
-      data = ReadSample(format, data, &(*output)[c][i]);
-    }
+  output->resize(num_channels);
+  std::vector<double *> planes(num_channels);
+  for (int c = 0; c < num_channels; ++c) {
+    (*output)[c].resize(num_frames);
+    planes[c] = (*output)[c].data();
   }
+  Deinterleave(data, num_frames, format, num_channels, planes.data());
   return num_frames;
 }
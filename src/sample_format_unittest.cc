@@ -0,0 +1,296 @@
+// Copyright 2019 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "include/sample_format.h"
+
+namespace {
+
+// Little endian bytes of a sample and the value it is read as.
+struct Sample {
+  uint8_t bytes[4];
+  double value;
+};
+
+// Minimum, maximum, zero and -1 LSB of a format, which is where sign
+// extension and offsets go wrong.
+struct FormatSamples {
+  SampleFormat::Type type;
+  Sample samples[4];
+};
+
+const float kFloatMin = -1.0f;
+const float kFloatMax = 1.0f;
+const float kFloatLsb = -1.0f / (1 << 23);
+
+const FormatSamples kFormats[] = {
+    {SampleFormat::kPcmU8,
+     {{{0x00}, -1.0},
+      {{0xff}, 127.0 / 128},
+      {{0x80}, 0.0},
+      {{0x7f}, -1.0 / 128}}},
+    {SampleFormat::kPcmS16,
+     {{{0x00, 0x80}, -1.0},
+      {{0xff, 0x7f}, 32767.0 / 32768},
+      {{0x00, 0x00}, 0.0},
+      {{0xff, 0xff}, -1.0 / 32768}}},
+    {SampleFormat::kPcmS24,
+     {{{0x00, 0x00, 0x80}, -1.0},
+      {{0xff, 0xff, 0x7f}, 8388607.0 / 8388608},
+      {{0x00, 0x00, 0x00}, 0.0},
+      {{0xff, 0xff, 0xff}, -1.0 / 8388608}}},
+    // The upper byte is padding, and does not change the value.
+    {SampleFormat::kPcmS24In32,
+     {{{0x00, 0x00, 0x80, 0x00}, -1.0},
+      {{0xff, 0xff, 0x7f, 0xff}, 8388607.0 / 8388608},
+      {{0x00, 0x00, 0x00, 0xff}, 0.0},
+      {{0xff, 0xff, 0xff, 0x00}, -1.0 / 8388608}}},
+    {SampleFormat::kPcmS32,
+     {{{0x00, 0x00, 0x00, 0x80}, -1.0},
+      {{0xff, 0xff, 0xff, 0x7f}, 2147483647.0 / 2147483648.0},
+      {{0x00, 0x00, 0x00, 0x00}, 0.0},
+      {{0xff, 0xff, 0xff, 0xff}, -1.0 / 2147483648.0}}},
+    {SampleFormat::kPcmFloat,
+     {{{0}, kFloatMin},
+      {{0}, kFloatMax},
+      {{0}, 0.0},
+      {{0}, kFloatLsb}}},
+};
+
+// Returns the samples of |format| with the bytes of the float samples filled
+// in from their values.
+FormatSamples GetSamples(const FormatSamples &format) {
+  FormatSamples result = format;
+  if (format.type == SampleFormat::kPcmFloat) {
+    for (Sample &sample : result.samples) {
+      const float value = sample.value;
+      memcpy(sample.bytes, &value, sizeof(value));
+    }
+  }
+  return result;
+}
+
+// Builds |num_frames| frames of |num_channels| channels, sample of channel c
+// in frame i being sample (i + c) % 4 of |format|.
+std::vector<uint8_t> MakeFrames(const FormatSamples &format, int num_frames,
+                                int num_channels) {
+  const size_t bytes = SampleFormat(format.type).bytes();
+  std::vector<uint8_t> data(num_frames * num_channels * bytes);
+  for (int i = 0; i < num_frames; ++i) {
+    for (int c = 0; c < num_channels; ++c) {
+      memcpy(&data[(i * num_channels + c) * bytes],
+             format.samples[(i + c) % 4].bytes, bytes);
+    }
+  }
+  return data;
+}
+
+// Returns |num_samples| samples of noise in [-1, 1] from rand() seeded by
+// |seed|.
+std::vector<double> Noise(int num_samples, unsigned int seed) {
+  srand(seed);
+  std::vector<double> noise(num_samples);
+  for (double &sample : noise)
+    sample = 2.0 * rand() / RAND_MAX - 1;
+  return noise;
+}
+
+template <typename T>
+class SampleFormatTest : public ::testing::Test {};
+
+typedef ::testing::Types<float, double> Precisions;
+TYPED_TEST_SUITE(SampleFormatTest, Precisions);
+
+// Frames of a whole block of the converters and a tail.
+const int kNumFrames = 37;
+
+TYPED_TEST(SampleFormatTest, DeinterleaveExactValues) {
+  // 1, 2, 4 and 8 channels are specialized, and 3 uses the generic loop.
+  const int kChannels[] = {1, 2, 3, 4, 8};
+  for (const FormatSamples &entry : kFormats) {
+    const FormatSamples format = GetSamples(entry);
+    const SampleFormat sample_format(format.type);
+    for (int num_channels : kChannels) {
+      const std::vector<uint8_t> data =
+          MakeFrames(format, kNumFrames, num_channels);
+      std::vector<std::vector<TypeParam> > planes(
+          num_channels, std::vector<TypeParam>(kNumFrames));
+      std::vector<TypeParam *> plane_pointers;
+      for (auto &plane : planes)
+        plane_pointers.push_back(plane.data());
+      Deinterleave(data.data(), kNumFrames, sample_format, num_channels,
+                   plane_pointers.data());
+      for (int i = 0; i < kNumFrames; ++i) {
+        for (int c = 0; c < num_channels; ++c) {
+          EXPECT_EQ(static_cast<TypeParam>(format.samples[(i + c) % 4].value),
+                    planes[c][i])
+              << sample_format.to_string() << ", " << num_channels
+              << " channels, frame " << i << ", channel " << c;
+        }
+      }
+    }
+  }
+}
+
+TYPED_TEST(SampleFormatTest, ConvertSamplesExactValues) {
+  for (const FormatSamples &entry : kFormats) {
+    const FormatSamples format = GetSamples(entry);
+    const SampleFormat sample_format(format.type);
+    const std::vector<uint8_t> data = MakeFrames(format, kNumFrames, 1);
+    std::vector<TypeParam> output(kNumFrames);
+    ConvertSamples(data.data(), kNumFrames, sample_format, output.data());
+    for (int i = 0; i < kNumFrames; ++i) {
+      EXPECT_EQ(static_cast<TypeParam>(format.samples[i % 4].value),
+                output[i])
+          << sample_format.to_string() << ", sample " << i;
+    }
+  }
+}
+
+// Interleave() writes the same bytes as WriteSample() of each sample times
+// its gain, including clamped samples, silent channels and the samples after
+// the last whole block.
+TYPED_TEST(SampleFormatTest, InterleaveEqualsWriteSample) {
+  const int kChannels[] = {1, 2, 3, 4, 8};
+  for (const FormatSamples &entry : kFormats) {
+    const SampleFormat format(entry.type);
+    for (int num_channels : kChannels) {
+      // Samples reach beyond full scale to be clamped.
+      std::vector<std::vector<TypeParam> > planes(num_channels);
+      std::vector<const TypeParam *> plane_pointers(num_channels);
+      std::vector<double> gains(num_channels);
+      for (int c = 0; c < num_channels; ++c) {
+        const std::vector<double> noise = Noise(kNumFrames, c + 1);
+        planes[c].assign(noise.begin(), noise.end());
+        for (TypeParam &sample : planes[c])
+          sample *= 1.25;
+        plane_pointers[c] = planes[c].data();
+        gains[c] = 1.0 - 0.1 * c;
+      }
+      // The last channel has no plane and the one before it a zero gain,
+      // which both write silence.
+      if (num_channels > 1)
+        plane_pointers[num_channels - 1] = NULL;
+      if (num_channels > 2)
+        gains[num_channels - 2] = 0.0;
+
+      std::vector<uint8_t> expected(kNumFrames * num_channels *
+                                    format.bytes());
+      void *buf = expected.data();
+      for (int i = 0; i < kNumFrames; ++i) {
+        for (int c = 0; c < num_channels; ++c) {
+          // Silence is +0.0 even for negative float samples.
+          const double sample = plane_pointers[c] && gains[c] != 0
+                                    ? planes[c][i] * gains[c]
+                                    : 0.0;
+          buf = WriteSample(sample, format, buf);
+        }
+      }
+      std::vector<uint8_t> actual(expected.size());
+      EXPECT_EQ(actual.data() + actual.size(),
+                Interleave(plane_pointers.data(), gains.data(), kNumFrames,
+                           num_channels, format, actual.data()));
+      EXPECT_EQ(expected, actual)
+          << format.to_string() << ", " << num_channels << " channels";
+    }
+  }
+}
+
+// Broadcast() writes the same bytes as Interleave() with every plane being
+// the broadcast samples, both in its specialized path with equal gains and
+// silent channels, and when it falls back to Interleave() for mixed gains or
+// dither.
+TYPED_TEST(SampleFormatTest, BroadcastEqualsInterleave) {
+  const int kChannels[] = {1, 2, 3, 4, 8, 16, 32};
+  const std::vector<double> noise = Noise(kNumFrames, 1);
+  // Samples reach beyond full scale to be clamped.
+  std::vector<TypeParam> samples(noise.begin(), noise.end());
+  for (TypeParam &sample : samples)
+    sample *= 1.25;
+  for (const FormatSamples &entry : kFormats) {
+    const SampleFormat format(entry.type);
+    for (int num_channels : kChannels) {
+      const std::vector<const TypeParam *> planes(num_channels,
+                                                  samples.data());
+      // Every third channel is silent.
+      std::vector<double> equal_gains(num_channels, 0.5);
+      for (int c = 1; c < num_channels; c += 3)
+        equal_gains[c] = 0.0;
+      std::vector<double> mixed_gains(num_channels);
+      for (int c = 0; c < num_channels; ++c)
+        mixed_gains[c] = 1.0 - 0.02 * c;
+
+      for (bool dithered : {false, true}) {
+        for (const std::vector<double> *gains : {&equal_gains, &mixed_gains}) {
+          TpdfDither dither_expected(1);
+          TpdfDither dither_actual(1);
+          std::vector<uint8_t> expected(kNumFrames * num_channels *
+                                        format.bytes());
+          std::vector<uint8_t> actual(expected.size());
+          Interleave(planes.data(), gains->data(), kNumFrames, num_channels,
+                     format, expected.data(),
+                     dithered ? &dither_expected : NULL);
+          EXPECT_EQ(actual.data() + actual.size(),
+                    Broadcast(samples.data(), gains->data(), kNumFrames,
+                              num_channels, format, actual.data(),
+                              dithered ? &dither_actual : NULL));
+          EXPECT_EQ(expected, actual)
+              << format.to_string() << ", " << num_channels << " channels, "
+              << (gains == &equal_gains ? "equal" : "mixed") << " gains"
+              << (dithered ? ", dithered" : "");
+        }
+      }
+    }
+  }
+}
+
+// Samples on the grid of a format come back exactly from Interleave() and
+// Deinterleave(), in every format and channel layout.
+TYPED_TEST(SampleFormatTest, InterleaveRoundTrip) {
+  const int kChannels[] = {1, 2, 3, 4, 8};
+  for (const FormatSamples &entry : kFormats) {
+    const SampleFormat format(entry.type);
+    // Steps of the grid in full scale, from the -1 LSB sample of the format.
+    // A float plane holds 24 bits, which bounds the grid of s32.
+    double scale = 1.0 / (-entry.samples[3].value);
+    if (sizeof(TypeParam) == sizeof(float))
+      scale = std::min(scale, 8388608.0);
+    for (int num_channels : kChannels) {
+      std::vector<std::vector<TypeParam> > planes(num_channels);
+      std::vector<const TypeParam *> input(num_channels);
+      std::vector<std::vector<TypeParam> > output(
+          num_channels, std::vector<TypeParam>(kNumFrames));
+      std::vector<TypeParam *> output_pointers(num_channels);
+      const std::vector<double> gains(num_channels, 1.0);
+      for (int c = 0; c < num_channels; ++c) {
+        for (double sample : Noise(kNumFrames, c + 1))
+          planes[c].push_back(floor(sample * scale) / scale);
+        // Both ends of the range.
+        planes[c][0] = -1.0;
+        planes[c][1] = 1.0 - 1.0 / scale;
+        input[c] = planes[c].data();
+        output_pointers[c] = output[c].data();
+      }
+
+      std::vector<uint8_t> data(kNumFrames * num_channels * format.bytes());
+      Interleave(input.data(), gains.data(), kNumFrames, num_channels, format,
+                 data.data());
+      Deinterleave(data.data(), kNumFrames, format, num_channels,
+                   output_pointers.data());
+      EXPECT_EQ(planes, output)
+          << format.to_string() << ", " << num_channels << " channels";
+    }
+  }
+}
+
+}  // namespace
@@ -0,0 +1,199 @@
+// Copyright 2019 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "include/spectrogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "include/window.h"
+
+namespace {
+
+// Lowest level written, in dB relative to a full scale sine. The PGM gray
+// levels span from it to 0 dB.
+const double kFloorDb = -120.0;
+
+// Returns |path| with "_<channel>" inserted before its extension.
+std::string ChannelPath(const std::string &path, int channel) {
+  const size_t slash = path.rfind('/');
+  size_t dot = path.rfind('.');
+  if (dot == std::string::npos ||
+      (slash != std::string::npos && dot < slash))
+    dot = path.size();
+  return path.substr(0, dot) + "_" + std::to_string(channel) +
+         path.substr(dot);
+}
+
+bool IsPgmPath(const std::string &path) {
+  const std::string extension = ".pgm";
+  return path.size() >= extension.size() &&
+         path.compare(path.size() - extension.size(), extension.size(),
+                      extension) == 0;
+}
+
+}  // namespace
+
+Spectrogram::Spectrogram(int sample_rate, int num_channels, int fft_size,
+                         int hop_size, SampleFormat format, int decimation)
+    : sample_rate_(sample_rate),
+      num_channels_(num_channels),
+      hop_size_(hop_size),
+      format_(format),
+      decimation_(std::max(decimation, 1)),
+      is_pgm_(false),
+      fft_(fft_size),
+      window_(WindowFunction(WindowFunction::kHann).Generate(fft_size)),
+      ring_(fft_size * num_channels),
+      ring_pos_(0),
+      filled_frames_(0),
+      next_frame_(0),
+      frame_(fft_size * num_channels),
+      spectrum_(fft_.output_size() * num_channels),
+      row_frames_(0),
+      row_start_frame_(0),
+      row_end_frame_(0),
+      num_rows_(0) {
+  fft_.Reserve(num_channels);
+  // A full scale sine makes a bin of half the window sum.
+  double window_sum = 0.0;
+  for (double w : window_)
+    window_sum += w;
+  power_scale_ = 4.0 / (window_sum * window_sum);
+
+  const int num_bins = fft_size / 2 + 1;
+  bins_per_column_ = (num_bins + kMaxColumns - 1) / kMaxColumns;
+  num_columns_ = (num_bins + bins_per_column_ - 1) / bins_per_column_;
+  row_.resize(num_columns_ * num_channels);
+  pixels_.resize(num_columns_);
+}
+
+Spectrogram::~Spectrogram() {
+  Close();
+}
+
+bool Spectrogram::Open(const std::string &path,
+                       const std::set<int> &channels) {
+  is_pgm_ = IsPgmPath(path);
+  for (int channel : channels) {
+    const std::string channel_path = ChannelPath(path, channel);
+    Output output;
+    output.channel = channel;
+    output.file = fopen(channel_path.c_str(), is_pgm_ ? "wb" : "w");
+    output.height_offset = 0;
+    if (!output.file) {
+      perror(channel_path.c_str());
+      return false;
+    }
+    if (is_pgm_) {
+      // The height is left blank until the number of rows is known. PGM
+      // allows any whitespace between the header fields.
+      fprintf(output.file, "P5\n%d ", num_columns_);
+      output.height_offset = ftell(output.file);
+      fprintf(output.file, "%20d\n255\n", 0);
+    } else {
+      fprintf(output.file, "# plot '%s' nonuniform matrix with image\n",
+              channel_path.c_str());
+      fprintf(output.file, "%d", num_columns_);
+      for (int j = 0; j < num_columns_; ++j) {
+        // Each column is labeled with the center of its bins.
+        const int first = j * bins_per_column_;
+        const int last =
+            std::min(first + bins_per_column_, fft_.size() / 2 + 1) - 1;
+        fprintf(output.file, " %.1f",
+                0.5 * (first + last) * sample_rate_ / fft_.size());
+      }
+      fprintf(output.file, "\n");
+    }
+    outputs_.push_back(output);
+  }
+  return true;
+}
+
+void Spectrogram::AddFrames(const void *data, uint64_t first_frame) {
+  const int size = fft_.size();
+  if (first_frame != next_frame_) {
+    WriteRow();
+    ring_pos_ = 0;
+    filled_frames_ = 0;
+  }
+  next_frame_ = first_frame + hop_size_;
+  ConvertSamples(data, hop_size_ * num_channels_, format_,
+                 &ring_[ring_pos_ * num_channels_]);
+  ring_pos_ = (ring_pos_ + hop_size_) % size;
+  filled_frames_ = std::min(filled_frames_ + hop_size_, size);
+  if (filled_frames_ < size)
+    return;
+
+  for (int n = 0; n < size; ++n) {
+    const double *src = &ring_[((ring_pos_ + n) % size) * num_channels_];
+    double *dst = &frame_[n * num_channels_];
+    for (int c = 0; c < num_channels_; ++c)
+      dst[c] = src[c] * window_[n];
+  }
+  fft_.TransformBatch(frame_.data(), num_channels_, spectrum_.data());
+
+  if (row_frames_ == 0)
+    row_start_frame_ = next_frame_ - size;
+  row_end_frame_ = next_frame_;
+  const int num_bins = size / 2 + 1;
+  for (int j = 0; j < num_columns_; ++j) {
+    const int first = j * bins_per_column_;
+    const int last = std::min(first + bins_per_column_, num_bins);
+    double *row = &row_[j * num_channels_];
+    for (int c = 0; c < num_channels_; ++c) {
+      double peak = 0.0;
+      for (int k = first; k < last; ++k) {
+        const double real = spectrum_[2 * k * num_channels_ + c];
+        const double imag = spectrum_[(2 * k + 1) * num_channels_ + c];
+        peak = std::max(peak, real * real + imag * imag);
+      }
+      row[c] += peak;
+    }
+  }
+  if (++row_frames_ == decimation_)
+    WriteRow();
+}
+
+void Spectrogram::Close() {
+  WriteRow();
+  for (const Output &output : outputs_) {
+    if (is_pgm_) {
+      fseek(output.file, output.height_offset, SEEK_SET);
+      fprintf(output.file, "%20llu",
+              static_cast<unsigned long long>(num_rows_));
+    }
+    fclose(output.file);
+  }
+  outputs_.clear();
+}
+
+void Spectrogram::WriteRow() {
+  if (row_frames_ == 0)
+    return;
+  const double scale = power_scale_ / row_frames_;
+  const double time =
+      0.5 * (row_start_frame_ + row_end_frame_) / sample_rate_;
+  for (const Output &output : outputs_) {
+    if (!is_pgm_)
+      fprintf(output.file, "%.4f", time);
+    for (int j = 0; j < num_columns_; ++j) {
+      const double power = row_[j * num_channels_ + output.channel] * scale;
+      const double db =
+          power > 0 ? std::max(10 * log10(power), kFloorDb) : kFloorDb;
+      if (is_pgm_) {
+        pixels_[j] = lround(std::min(1 - db / kFloorDb, 1.0) * 255);
+      } else {
+        fprintf(output.file, " %.1f", db);
+      }
+    }
+    if (is_pgm_)
+      fwrite(pixels_.data(), 1, pixels_.size(), output.file);
+    else
+      fprintf(output.file, "\n");
+  }
+  std::fill(row_.begin(), row_.end(), 0.0);
+  row_frames_ = 0;
+  ++num_rows_;
+}
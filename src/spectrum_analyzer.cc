@@ -0,0 +1,196 @@
+// Copyright 2019 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "include/spectrum_analyzer.h"
+
+#include <algorithm>
+
+#include "include/fft.h"
+#include "include/goertzel.h"
+#include "include/sample_format.h"
+
+namespace {
+
+// Maps a bin of the full spectrum into [0, size / 2]. The spectrum of real
+// input is conjugate symmetric, so the power of the mirrored bin is the same.
+inline int SpectrumIndex(int bin, int size) {
+  bin %= size;
+  if (bin < 0)
+    bin += size;
+  return bin <= size / 2 ? bin : size - bin;
+}
+
+const char *PrecisionName(float) {
+  return "float";
+}
+
+const char *PrecisionName(double) {
+  return "double";
+}
+
+// Analyzer computing in |T|. All buffers are allocated in the constructor.
+template <typename T>
+class SpectrumAnalyzerImpl : public SpectrumAnalyzer {
+ public:
+  explicit SpectrumAnalyzerImpl(const AudioFunTestConfig &config);
+
+  bool use_goertzel() const override { return use_goertzel_; }
+  const char *precision() const override { return PrecisionName(T()); }
+  void Reset() override {
+    filled_frames_ = 0;
+    is_transformed_ = false;
+  }
+  bool AddFrames(const void *data) override;
+  void Transform(const std::vector<int> &center_bins, double *power) override;
+  void PowerSpectrum(double *power) override;
+
+ private:
+  // Returns the frame of the last fft_size recorded frames in ring_,
+  // multiplied by the window.
+  const T *PrepareFrame();
+
+  BasicRealFFT<T> fft_;
+  int hop_size_;
+  int num_channels_;
+  int num_bins_;
+  SampleFormat format_;
+  // Window of the FFT frame, or empty for the rectangular window.
+  std::vector<T> window_;
+  // Ring of the last fft_size recorded frames of all channels in frame order.
+  // Each block of hop_size frames is unpacked into it in place.
+  std::vector<T> ring_;
+  // Frame index of the oldest frame in ring_.
+  int ring_pos_;
+  // Number of valid frames in ring_.
+  int filled_frames_;
+  // Windowed FFT frame of all channels in frame order.
+  std::vector<T> frame_;
+  // Spectrum of all channels, laid out by RealFFT::TransformBatch().
+  std::vector<T> spectrum_;
+  // Whether spectrum_ holds the transform of the current frame.
+  bool is_transformed_;
+  // One bank for the match window of each carrier.
+  std::vector<BasicGoertzelBank<T> > goertzel_;
+  // Power of the match window of one carrier computed by goertzel_.
+  std::vector<T> goertzel_power_;
+  bool use_goertzel_;
+};
+
+template <typename T>
+SpectrumAnalyzerImpl<T>::SpectrumAnalyzerImpl(
+    const AudioFunTestConfig &config)
+    : fft_(config.fft_size),
+      hop_size_(config.hop_size > 0 ? config.hop_size : config.fft_size),
+      num_channels_(config.num_mic_channels),
+      num_bins_(config.match_window_size),
+      format_(config.sample_format),
+      ring_(config.fft_size * config.num_mic_channels),
+      ring_pos_(0),
+      filled_frames_(0),
+      frame_(config.fft_size * config.num_mic_channels),
+      is_transformed_(false),
+      goertzel_(config.num_carriers,
+                BasicGoertzelBank<T>(config.fft_size,
+                                     config.match_window_size)),
+      goertzel_power_(config.match_window_size * config.num_mic_channels),
+      use_goertzel_(GoertzelBank::IsCheaperThanFFT(
+          config.fft_size, config.num_carriers * config.match_window_size)) {
+  if (config.window.type() != WindowFunction::kRectangular) {
+    std::vector<double> window = config.window.Generate(config.fft_size);
+    window_.assign(window.begin(), window.end());
+  }
+  if (!use_goertzel_ || config.distortion) {
+    spectrum_.resize(fft_.output_size() * num_channels_);
+    fft_.Reserve(num_channels_);
+  }
+}
+
+template <typename T>
+bool SpectrumAnalyzerImpl<T>::AddFrames(const void *data) {
+  ConvertSamples(data, hop_size_ * num_channels_, format_,
+                 &ring_[ring_pos_ * num_channels_]);
+  ring_pos_ = (ring_pos_ + hop_size_) % fft_.size();
+  filled_frames_ = std::min(filled_frames_ + hop_size_, fft_.size());
+  is_transformed_ = false;
+  return filled_frames_ == fft_.size();
+}
+
+template <typename T>
+const T *SpectrumAnalyzerImpl<T>::PrepareFrame() {
+  // Without window and overlap, ring_ is exactly the frame.
+  if (window_.empty() && hop_size_ == fft_.size())
+    return ring_.data();
+
+  const int size = fft_.size();
+  for (int n = 0; n < size; ++n) {
+    const T w = window_.empty() ? 1 : window_[n];
+    const T *src = &ring_[((ring_pos_ + n) % size) * num_channels_];
+    T *dst = &frame_[n * num_channels_];
+    for (int channel = 0; channel < num_channels_; ++channel)
+      dst[channel] = src[channel] * w;
+  }
+  return frame_.data();
+}
+
+template <typename T>
+void SpectrumAnalyzerImpl<T>::Transform(const std::vector<int> &center_bins,
+                                        double *power) {
+  const T *frame = PrepareFrame();
+  const int half_window_size = num_bins_ / 2;
+  const size_t window_power_size = num_bins_ * num_channels_;
+
+  if (use_goertzel_) {
+    for (size_t carrier = 0; carrier < center_bins.size(); ++carrier) {
+      goertzel_[carrier].TransformBatch(
+          frame, num_channels_, center_bins[carrier] - half_window_size,
+          goertzel_power_.data());
+      std::copy(goertzel_power_.begin(), goertzel_power_.end(),
+                power + carrier * window_power_size);
+    }
+    return;
+  }
+
+  // All channels are transformed together in a batch.
+  fft_.TransformBatch(frame, num_channels_, spectrum_.data());
+  is_transformed_ = true;
+  for (int center_bin : center_bins) {
+    const int first_bin = center_bin - half_window_size;
+    for (int index = 0; index < num_bins_; ++index) {
+      const int k = SpectrumIndex(first_bin + index, fft_.size());
+      const T *real = &spectrum_[2 * k * num_channels_];
+      const T *imaginary = real + num_channels_;
+      for (int channel = 0; channel < num_channels_; ++channel)
+        power[channel] = real[channel] * real[channel] +
+                         imaginary[channel] * imaginary[channel];
+      power += num_channels_;
+    }
+  }
+}
+
+template <typename T>
+void SpectrumAnalyzerImpl<T>::PowerSpectrum(double *power) {
+  if (!is_transformed_) {
+    fft_.TransformBatch(PrepareFrame(), num_channels_, spectrum_.data());
+    is_transformed_ = true;
+  }
+  const int num_values = (fft_.size() / 2 + 1) * num_channels_;
+  for (int k = 0; k < num_values; k += num_channels_) {
+    const T *real = &spectrum_[2 * k];
+    const T *imaginary = real + num_channels_;
+    for (int channel = 0; channel < num_channels_; ++channel)
+      power[k + channel] = real[channel] * real[channel] +
+                           imaginary[channel] * imaginary[channel];
+  }
+}
+
+}  // namespace
+
+std::unique_ptr<SpectrumAnalyzer> SpectrumAnalyzer::Create(
+    const AudioFunTestConfig &config) {
+  if (config.single_precision)
+    return std::unique_ptr<SpectrumAnalyzer>(
+        new SpectrumAnalyzerImpl<float>(config));
+  return std::unique_ptr<SpectrumAnalyzer>(
+      new SpectrumAnalyzerImpl<double>(config));
+}
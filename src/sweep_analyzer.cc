@@ -0,0 +1,227 @@
+// Copyright 2019 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "include/sweep_analyzer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "include/tone_generators.h"
+
+namespace {
+
+// Regularization of the inverse sweep relative to the peak power of the
+// sweep spectrum. It bounds the gain on bins the sweep barely excites, and
+// is far below the power of an exponential sweep at its end frequency.
+const double kRegularization = 1e-7;
+
+// The peak of the impulse response must be this many times the mean power of
+// the response to count as found. Deconvolved noise peaks at up to about 350
+// times its mean power, since the inverse sweep lifts the top octaves, while
+// a sweep still stands out by 2000 times under noise as loud as itself.
+const double kMinPeakToMean = 1000.0;
+
+// Returns the smallest power of 2 not less than |value|.
+int CeilPowerOf2(double value) {
+  int size = 1;
+  while (size < value)
+    size <<= 1;
+  return size;
+}
+
+// Returns the largest power of 2 not greater than |value|, or 2, the
+// smallest transform size.
+int FloorPowerOf2(double value) {
+  int size = 2;
+  while (size * 2 <= value)
+    size <<= 1;
+  return size;
+}
+
+// Gain of the band limit at |frequency|. It is 1 within the sweep and falls
+// with half a cosine to 0 over the octave outside each end.
+double BandWeight(double frequency, double start, double end) {
+  double octaves = 0;
+  if (frequency < start)
+    octaves = log2(start / std::max(frequency, start / 2));
+  else if (frequency > end)
+    octaves = log2(std::min(frequency, end * 2) / end);
+  return 0.5 + 0.5 * cos(M_PI * octaves);
+}
+
+inline double BinPower(const std::vector<double> &spectrum, int bin) {
+  return spectrum[2 * bin] * spectrum[2 * bin] +
+         spectrum[2 * bin + 1] * spectrum[2 * bin + 1];
+}
+
+}  // namespace
+
+SweepAnalyzer::SweepAnalyzer(int sample_rate, double length_sec,
+                             double start_frequency, double end_frequency,
+                             int volume_gain, int max_frames)
+    : sample_rate_(sample_rate),
+      start_frequency_(start_frequency),
+      end_frequency_(end_frequency),
+      num_harmonics_(1),
+      max_frames_(max_frames),
+      fft_(CeilPowerOf2(max_frames + length_sec * sample_rate)),
+      inverse_(fft_.output_size()),
+      spectrum_(fft_.output_size()),
+      response_(fft_.size()) {
+  SweepGenerator sweep(sample_rate, length_sec, start_frequency,
+                       end_frequency, volume_gain);
+  const int sweep_frames = length_sec * sample_rate;
+  // SweepGenerator multiplies the frequency by a constant every frame and
+  // ends at the end frequency on the last frame.
+  rate_frames_ = (sweep_frames - 1) / log(end_frequency / start_frequency);
+
+  // Harmonics above the sweep have no response to cut out.
+  while (num_harmonics_ < kMaxHarmonic &&
+         (num_harmonics_ + 1) * start_frequency < end_frequency)
+    ++num_harmonics_;
+
+  // The linear response ends before the second harmonic starts, and each
+  // harmonic response ends before the next lower one starts.
+  response_fft_.reset(new RealFFT(FloorPowerOf2(rate_frames_ * log(2.0))));
+  harmonic_fft_.reset(new RealFFT(FloorPowerOf2(
+      rate_frames_ * log((num_harmonics_ + 1.0) / num_harmonics_))));
+
+  std::vector<double> samples(fft_.size());
+  sweep.Generate(sweep_frames, samples.data());
+  fft_.Transform(samples.data(), spectrum_.data());
+
+  const int num_bins = fft_.size() / 2 + 1;
+  double max_power = 0;
+  for (int k = 0; k < num_bins; ++k)
+    max_power = std::max(max_power, BinPower(spectrum_, k));
+  const double regularization = kRegularization * max_power;
+  // conj(X) / |X|^2 inverts X, and the regularization keeps the noise on
+  // bins outside the sweep from being amplified.
+  for (int k = 0; k < num_bins; ++k) {
+    const double weight =
+        BandWeight(static_cast<double>(k) * sample_rate / fft_.size(),
+                   start_frequency, end_frequency) /
+        (BinPower(spectrum_, k) + regularization);
+    inverse_[2 * k] = spectrum_[2 * k] * weight;
+    inverse_[2 * k + 1] = -spectrum_[2 * k + 1] * weight;
+  }
+}
+
+bool SweepAnalyzer::Analyze(const double *recording, int num_frames,
+                            Result *result) {
+  // The zero padded recording is transformed from the buffer of the
+  // response, which it turns into.
+  num_frames = std::min(num_frames, max_frames_);
+  std::copy(recording, recording + num_frames, response_.begin());
+  std::fill(response_.begin() + num_frames, response_.end(), 0.0);
+  fft_.Transform(response_.data(), spectrum_.data());
+  for (int k = 0; k < fft_.size() / 2 + 1; ++k) {
+    const double real = spectrum_[2 * k];
+    const double imag = spectrum_[2 * k + 1];
+    spectrum_[2 * k] = real * inverse_[2 * k] - imag * inverse_[2 * k + 1];
+    spectrum_[2 * k + 1] = real * inverse_[2 * k + 1] + imag * inverse_[2 * k];
+  }
+  fft_.InverseTransform(spectrum_.data(), response_.data());
+
+  // The linear response lies within the recording. The harmonic responses
+  // come before it and wrap around to the end.
+  int peak = 0;
+  double mean_power = 0;
+  for (int i = 0; i < num_frames; ++i) {
+    mean_power += response_[i] * response_[i];
+    if (fabs(response_[i]) > fabs(response_[peak]))
+      peak = i;
+  }
+  mean_power /= std::max(num_frames, 1);
+  if (response_[peak] * response_[peak] <= kMinPeakToMean * mean_power)
+    return false;
+
+  // A parabola through the magnitudes around the peak finds it between
+  // frames.
+  double offset = 0;
+  if (peak > 0 && peak + 1 < num_frames) {
+    const double before = fabs(response_[peak - 1]);
+    const double center = fabs(response_[peak]);
+    const double after = fabs(response_[peak + 1]);
+    const double curvature = before - 2 * center + after;
+    if (curvature < 0)
+      offset = 0.5 * (before - after) / curvature;
+  }
+  result->latency_sec = (peak + offset) / sample_rate_;
+
+  // Octave bands centered on 1 kHz * 2^n, each averaged over the bins within
+  // half an octave of its center.
+  const int response_size = response_fft_->size();
+  SegmentSpectrum(response_fft_.get(), peak, &segment_);
+  const double bin_width = static_cast<double>(sample_rate_) / response_size;
+  result->band_frequencies.clear();
+  result->response_db.clear();
+  for (double center = 1000.0 * pow(2.0, ceil(log2(start_frequency_ / 1000)));
+       center <= end_frequency_; center *= 2) {
+    const int low = ceil(std::max(center / M_SQRT2, start_frequency_) /
+                         bin_width);
+    const int high = std::min<int>(
+        std::min(center * M_SQRT2, end_frequency_) / bin_width,
+        response_size / 2);
+    double power = 0;
+    for (int k = low; k <= high; ++k)
+      power += BinPower(segment_, k);
+    // A band narrower than a bin takes the bin nearest to its center.
+    if (high < low)
+      power = BinPower(segment_, lround(center / bin_width));
+    else
+      power /= high - low + 1;
+    result->band_frequencies.push_back(center);
+    result->response_db.push_back(10 * log10(power));
+  }
+
+  // Harmonic k of fundamental f shows up at bin k * f of the response of
+  // harmonic k, which is compared with bin f of the linear response.
+  const int harmonic_size = harmonic_fft_->size();
+  const double harmonic_bin_width =
+      static_cast<double>(sample_rate_) / harmonic_size;
+  SegmentSpectrum(harmonic_fft_.get(), peak, &fundamental_);
+  result->harmonic_db.clear();
+  for (int order = 2; order <= num_harmonics_; ++order) {
+    SegmentSpectrum(harmonic_fft_.get(),
+                    peak - lround(rate_frames_ * log(order)), &segment_);
+    const int low = ceil(start_frequency_ / harmonic_bin_width);
+    const int high = std::min<int>(
+        end_frequency_ / order / harmonic_bin_width,
+        harmonic_size / 2 / order);
+    if (high < low)
+      break;
+    double harmonic_power = 0;
+    double fundamental_power = 0;
+    for (int k = low; k <= high; ++k) {
+      harmonic_power += BinPower(segment_, order * k);
+      fundamental_power += BinPower(fundamental_, k);
+    }
+    result->harmonic_db.push_back(
+        10 * log10(harmonic_power / fundamental_power));
+  }
+  return true;
+}
+
+void SweepAnalyzer::SegmentSpectrum(RealFFT *fft, int center,
+                                    std::vector<double> *spectrum) {
+  const int size = fft->size();
+  const int start = center - size / 4;
+  const int fade = std::max(size / 16, 1);
+  samples_.resize(size);
+  for (int i = 0; i < size; ++i) {
+    int index = (start + i) % fft_.size();
+    if (index < 0)
+      index += fft_.size();
+    samples_[i] = response_[index];
+  }
+  // Half Hann fades, so the cut does not spread energy over the spectrum.
+  for (int i = 0; i < fade; ++i) {
+    const double gain = 0.5 - 0.5 * cos(M_PI * (i + 0.5) / fade);
+    samples_[i] *= gain;
+    samples_[size - 1 - i] *= gain;
+  }
+  spectrum->resize(fft->output_size());
+  fft->Transform(samples_.data(), spectrum->data());
+}
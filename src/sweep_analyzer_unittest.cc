@@ -0,0 +1,88 @@
+// Copyright 2019 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <math.h>
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "include/sample_format.h"
+#include "include/sweep_analyzer.h"
+#include "include/tone_generators.h"
+
+namespace {
+
+const int kSampleRate = 48000;
+const double kLengthSec = 2.0;
+const double kStartFrequency = 20.0;
+const double kEndFrequency = 20000.0;
+const int kVolumeGain = 50;
+const int kSweepFrames = kLengthSec * kSampleRate;
+// Recordings run a tenth of a second past the sweep.
+const int kRecordingFrames = kSweepFrames + kSampleRate / 10;
+
+// Path of gain |kGain| after |kDelay| frames, with square and cube terms.
+const int kDelay = 1234;
+const double kGain = 0.5;
+const double kSquare = 0.1;
+const double kCube = 0.2;
+
+// Records the sweep through the path.
+std::vector<double> RecordPath() {
+  SweepGenerator sweep(kSampleRate, kLengthSec, kStartFrequency,
+                       kEndFrequency, kVolumeGain);
+  std::vector<double> samples(kSweepFrames);
+  sweep.Generate(kSweepFrames, samples.data());
+  std::vector<double> recording(kRecordingFrames);
+  for (int i = 0; i < kSweepFrames; ++i) {
+    const double x = samples[i];
+    recording[kDelay + i] = kGain * (x + kSquare * x * x + kCube * x * x * x);
+  }
+  return recording;
+}
+
+// The latency, response and harmonics of the path are recovered from its
+// recording of the sweep.
+TEST(SweepAnalyzerTest, MeasuresSimulatedPath) {
+  const std::vector<double> recording = RecordPath();
+  SweepAnalyzer analyzer(kSampleRate, kLengthSec, kStartFrequency,
+                         kEndFrequency, kVolumeGain, kRecordingFrames);
+  SweepAnalyzer::Result result;
+  ASSERT_TRUE(analyzer.Analyze(recording.data(), kRecordingFrames, &result));
+
+  EXPECT_NEAR(kDelay, result.latency_sec * kSampleRate, 0.05);
+
+  // A sine of amplitude a comes out of the path with a fundamental of
+  // a + 3/4 kCube a^3, a second harmonic of 1/2 kSquare a^2 and a third
+  // harmonic of 1/4 kCube a^3, all times kGain.
+  const double a = kVolumeGain / 100.0;
+  const double fundamental = a + 0.75 * kCube * a * a * a;
+  ASSERT_FALSE(result.response_db.empty());
+  for (size_t i = 0; i < result.response_db.size(); ++i) {
+    EXPECT_NEAR(20 * log10(kGain * fundamental / a), result.response_db[i],
+                0.1)
+        << result.band_frequencies[i] << " Hz";
+  }
+  ASSERT_LE(2u, result.harmonic_db.size());
+  EXPECT_NEAR(20 * log10(0.5 * kSquare * a * a / fundamental),
+              result.harmonic_db[0], 0.5);
+  EXPECT_NEAR(20 * log10(0.25 * kCube * a * a * a / fundamental),
+              result.harmonic_db[1], 0.5);
+  // The path has no higher orders.
+  for (size_t i = 2; i < result.harmonic_db.size(); ++i)
+    EXPECT_GT(-80.0, result.harmonic_db[i]) << "harmonic " << i + 2;
+}
+
+// Deconvolved noise has no peak standing out enough to be a response.
+TEST(SweepAnalyzerTest, NoiseHasNoResponse) {
+  std::vector<double> recording(kRecordingFrames);
+  UniformNoise(1).Generate(kRecordingFrames, recording.data());
+  SweepAnalyzer analyzer(kSampleRate, kLengthSec, kStartFrequency,
+                         kEndFrequency, kVolumeGain, kRecordingFrames);
+  SweepAnalyzer::Result result;
+  EXPECT_FALSE(analyzer.Analyze(recording.data(), kRecordingFrames, &result));
+}
+
+}  // namespace
@@ -11,6 +11,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <memory>
 #include <set>
 #include <string>
 
@@ -30,6 +31,9 @@ static struct option long_options[] = {
   {"end-volume", 1, NULL, 'e'},
   {"channels", 1, NULL, 'c'},
   {"active-channels", 1, NULL, 'a'},
+  {"min-frequency", 1, NULL, 'i'},
+  {"max-frequency", 1, NULL, 'x'},
+  {"seed", 1, NULL, 'z'},
 };
 
 TestConfig::TestType ParseTestType(const char *option) {
@@ -37,28 +41,32 @@ TestConfig::TestType ParseTestType(const char *option) {
     return TestConfig::kASharpMinorScale;
   } else if (strcmp(option, "tone") == 0) {
     return TestConfig::kSingleTone;
+  } else if (strcmp(option, "sweep") == 0) {
+    return TestConfig::kSweep;
+  } else if (strcmp(option, "white") == 0) {
+    return TestConfig::kWhiteNoise;
+  } else if (strcmp(option, "pink") == 0) {
+    return TestConfig::kPinkNoise;
+  } else if (strcmp(option, "mls") == 0) {
+    return TestConfig::kMls;
   }
   return TestConfig::kInvalid;
 }
 
 SampleFormat ParseFormat(const char *arg) {
-  if (strcmp(arg, "u8") == 0) {
-    return SampleFormat(SampleFormat::kPcmU8);
-  } else if (strcmp(arg, "s16") == 0) {
-    return SampleFormat(SampleFormat::kPcmS16);
-  } else if (strcmp(arg, "s24") == 0) {
-    return SampleFormat(SampleFormat::kPcmS24);
-  } else if (strcmp(arg, "s32") == 0) {
-    return SampleFormat(SampleFormat::kPcmS32);
-  } else {
-    return SampleFormat(SampleFormat::kPcmInvalid);
+  for (int type = SampleFormat::kPcmU8; type != SampleFormat::kPcmInvalid;
+       ++type) {
+    const SampleFormat format(static_cast<SampleFormat::Type>(type));
+    if (strcmp(format.to_string(), arg) == 0)
+      return format;
   }
+  return SampleFormat(SampleFormat::kPcmInvalid);
 }
 
 bool ParseOptions(int argc, char *argv[], TestConfig *config) {
   int opt = 0;
   int optindex = -1;
-  while ((opt = getopt_long(argc, argv, "t:d:l:f:h:r:s:e:c:a:",
+  while ((opt = getopt_long(argc, argv, "t:d:l:f:h:r:s:e:c:a:i:x:z:",
                             long_options,
                             &optindex)) != -1) {
     switch (opt) {
@@ -102,13 +110,34 @@ bool ParseOptions(int argc, char *argv[], TestConfig *config) {
         ParseActiveChannels(optarg, &config->active_channels);
         break;
 
+      case 'i':
+        config->min_frequency = atof(optarg);
+        break;
+
+      case 'x':
+        config->max_frequency = atof(optarg);
+        break;
+
+      case 'z':
+        config->seed = strtoul(optarg, NULL, 0);
+        break;
+
       default:
         assert(false);
     }
   }
 
   if (config->type == TestConfig::kInvalid) {
-    fprintf(stderr, "Test type must be \"scale\" or \"tone\"\n");
+    fprintf(stderr, "Test type must be \"scale\", \"tone\", \"sweep\", "
+            "\"white\", \"pink\" or \"mls\"\n");
+    return false;
+  }
+
+  if (config->type == TestConfig::kSweep &&
+      (config->min_frequency <= 0 ||
+       config->min_frequency >= config->max_frequency ||
+       config->max_frequency > config->sample_rate / 2)) {
+    fprintf(stderr, "Sweep range must be within (0, sample rate / 2].\n");
     return false;
   }
 
@@ -132,7 +161,9 @@ void PrintUsage(FILE *out, const char *name) {
   TestConfig default_config;
 
   fprintf(out, "Usage: %s [options]\n", name);
-  fprintf(out, "\t-t, --test-type: \"scale\" or \"tone\"\n");
+  fprintf(out, "\t-t, --test-type: \"scale\", \"tone\", \"sweep\" "
+               "(exponential), \"white\" or \"pink\" noise, or \"mls\" "
+               "(maximum length sequence)\n");
   fprintf(out, "\t-d, --alsa-device: "
                "Name of alsa device to use (def %s).\n",
                default_config.alsa_device.c_str());
@@ -167,9 +198,23 @@ void PrintUsage(FILE *out, const char *name) {
   fprintf(out,
           "\t-a, --active-channels: "
           "Comma-separated list of channels to play on. (def all channels)\n");
+  fprintf(out,
+          "\t-i, --min-frequency: "
+          "Start frequency of a sweep in HZ (def %0.2lf).\n",
+          default_config.min_frequency);
+  fprintf(out,
+          "\t-x, --max-frequency: "
+          "End frequency of a sweep in HZ (def %0.2lf).\n",
+          default_config.max_frequency);
+  fprintf(out,
+          "\t-z, --seed: "
+          "Seed of noise and MLS, which repeat exactly for a seed "
+          "(def %u).\n",
+          default_config.seed);
   fprintf(out, "\nThe volume of the sample will be a linear ramp over the "
           "duration of playback. The tone length, in scale mode, is the "
-          "length of each individual tone in the scale.\n\n");
+          "length of each individual tone in the scale. Sweeps, noise and "
+          "MLS play at the start volume.\n\n");
 }
 
 void PrintConfig(FILE *out, const TestConfig &config) {
@@ -179,6 +224,19 @@ void PrintConfig(FILE *out, const TestConfig &config) {
   } else if (config.type == TestConfig::kSingleTone) {
     fprintf(out, "\tType: Single Tone\n");
     fprintf(out, "\tFrequency: %0.2lf\n", config.frequency);
+  } else if (config.type == TestConfig::kSweep) {
+    fprintf(out, "\tType: Exponential Sweep\n");
+    fprintf(out, "\tFrequencies: %0.2lf - %0.2lf\n", config.min_frequency,
+            config.max_frequency);
+  } else if (config.type == TestConfig::kWhiteNoise) {
+    fprintf(out, "\tType: White Noise\n");
+    fprintf(out, "\tSeed: %u\n", config.seed);
+  } else if (config.type == TestConfig::kPinkNoise) {
+    fprintf(out, "\tType: Pink Noise\n");
+    fprintf(out, "\tSeed: %u\n", config.seed);
+  } else if (config.type == TestConfig::kMls) {
+    fprintf(out, "\tType: Maximum Length Sequence\n");
+    fprintf(out, "\tSeed: %u\n", config.seed);
   }
 
   fprintf(out, "\tAlsa Device: %s\n", config.alsa_device.c_str());
@@ -225,13 +283,33 @@ int main(int argc, char *argv[]) {
     scale_generator.SetVolumes(config.start_volume, config.end_volume);
     client.SetPlayObj(&scale_generator);
     client.PlayTones();
-  } else {
+  } else if (config.type == TestConfig::kSingleTone) {
     MultiToneGenerator tone_generator(config.sample_rate,
                                        config.tone_length_sec);
     tone_generator.SetVolumes(config.start_volume, config.end_volume);
     tone_generator.Reset(config.frequency);
     client.SetPlayObj(&tone_generator);
     client.PlayTones();
+  } else {
+    const int volume_gain = config.start_volume * 100;
+    std::unique_ptr<ToneGenerator> generator;
+    if (config.type == TestConfig::kSweep) {
+      generator.reset(new SweepGenerator(
+          config.sample_rate, config.tone_length_sec, config.min_frequency,
+          config.max_frequency, volume_gain));
+    } else if (config.type == TestConfig::kMls) {
+      generator.reset(new MlsGenerator(config.sample_rate,
+                                       config.tone_length_sec, 0,
+                                       config.seed, volume_gain));
+    } else {
+      generator.reset(new NoiseGenerator(
+          config.sample_rate, config.tone_length_sec,
+          config.type == TestConfig::kPinkNoise ? NoiseGenerator::kPink
+                                                : NoiseGenerator::kWhite,
+          config.seed, volume_gain));
+    }
+    client.SetPlayObj(generator.get());
+    client.PlayTones();
   }
 
   return 0;
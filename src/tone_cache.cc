@@ -0,0 +1,114 @@
+// Copyright 2019 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "include/tone_cache.h"
+
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+
+namespace {
+
+int64_t ThreadCpuNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+}  // namespace
+
+ToneCache::ToneCache(SampleFormat format,
+                     const std::vector<double> &channel_gains,
+                     TpdfDither *dither)
+    : format_(format),
+      channel_gains_(channel_gains),
+      dither_(dither),
+      frame_bytes_(format.bytes() * channel_gains.size()),
+      period_frames_(0),
+      serial_(0),
+      position_(0),
+      ahead_frames_(0),
+      cpu_ns_(0),
+      frames_(0),
+      cached_frames_(0) {}
+
+void ToneCache::Reset() {
+  period_frames_ = 0;
+  position_ = 0;
+  ahead_frames_ = 0;
+}
+
+size_t ToneCache::GetFrames(ToneGenerator *generator, void *data,
+                            size_t buf_size) {
+  const int64_t start_ns = ThreadCpuNs();
+  uint8_t *output = static_cast<uint8_t *>(data);
+  const int wanted = buf_size / frame_bytes_;
+  int served = 0;
+  while (served < wanted) {
+    // Frames generated into the period come first, since the generator is
+    // already past them.
+    if (ahead_frames_ > 0) {
+      const int count = std::min(ahead_frames_, wanted - served);
+      CopyFrames(count, output + served * frame_bytes_);
+      ahead_frames_ -= count;
+      served += count;
+      continue;
+    }
+
+    const ToneGenerator::Period period =
+        dither_ ? ToneGenerator::Period() : generator->GetPeriod();
+    if (period.frames > 0 && period.repeat_frames > 0) {
+      if (period_frames_ == period.frames && serial_ == period.serial) {
+        const int count = std::min<long long>(wanted - served,
+                                              period.repeat_frames);
+        CopyFrames(count, output + served * frame_bytes_);
+        generator->Skip(count);
+        cached_frames_ += count;
+        served += count;
+        continue;
+      }
+      // Rendering a period only pays off if it is played more than once.
+      if (period.repeat_frames >= 2 * period.frames) {
+        period_.resize(period.frames * frame_bytes_);
+        const int rendered =
+            generator->GetFrames(format_, channel_gains_, period_.data(),
+                                 period_.size(), NULL) / frame_bytes_;
+        // A generator running short of frames cannot be repeated, but the
+        // frames it wrote are still served.
+        period_frames_ = rendered == period.frames ? period.frames : 0;
+        serial_ = period.serial;
+        position_ = 0;
+        ahead_frames_ = rendered;
+        if (rendered == 0)
+          break;
+        continue;
+      }
+    }
+
+    Reset();
+    const size_t written = generator->GetFrames(
+        format_, channel_gains_, output + served * frame_bytes_,
+        (wanted - served) * frame_bytes_, dither_);
+    served += written / frame_bytes_;
+    break;
+  }
+  frames_ += served;
+  cpu_ns_ += ThreadCpuNs() - start_ns;
+  return served * frame_bytes_;
+}
+
+void ToneCache::CopyFrames(int num_frames, uint8_t *data) {
+  while (num_frames > 0) {
+    const int count = std::min(num_frames, period_frames_ > 0
+                                           ? period_frames_ - position_
+                                           : num_frames);
+    memcpy(data, &period_[position_ * frame_bytes_], count * frame_bytes_);
+    data += count * frame_bytes_;
+    num_frames -= count;
+    position_ += count;
+    if (position_ == period_frames_)
+      position_ = 0;
+  }
+}
@@ -0,0 +1,137 @@
+// Copyright 2019 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "include/sample_format.h"
+#include "include/tone_cache.h"
+#include "include/tone_generators.h"
+
+namespace {
+
+const int kSampleRate = 48000;
+const double kLengthSec = 1.0;
+// Frames asked for per call, which do not line up with any period.
+const int kChunkFrames = 1000;
+// Tones on bins of a 2048 points DFT, which repeat every 2048 frames.
+const double kBinHz = kSampleRate / 2048.0;
+
+// Creates a generator to play for kLengthSec.
+typedef std::unique_ptr<ToneGenerator> (*Factory)();
+
+std::unique_ptr<ToneGenerator> MakeSine() {
+  SineWaveGenerator *generator = new SineWaveGenerator(kSampleRate,
+                                                       kLengthSec);
+  generator->Reset(37 * kBinHz);
+  return std::unique_ptr<ToneGenerator>(generator);
+}
+
+std::unique_ptr<ToneGenerator> MakeChannelSine() {
+  ChannelSineWaveGenerator *generator =
+      new ChannelSineWaveGenerator(kSampleRate, kLengthSec);
+  generator->Reset({37 * kBinHz, 101 * kBinHz, 300 * kBinHz});
+  return std::unique_ptr<ToneGenerator>(generator);
+}
+
+std::unique_ptr<ToneGenerator> MakeMls() {
+  return std::unique_ptr<ToneGenerator>(
+      new MlsGenerator(kSampleRate, kLengthSec, 10));
+}
+
+// Plays |generator| to its end in chunks of kChunkFrames, through |cache| if
+// it is not NULL and straight from the generator otherwise.
+std::vector<uint8_t> Play(ToneGenerator *generator, ToneCache *cache,
+                          SampleFormat format,
+                          const std::vector<double> &gains,
+                          TpdfDither *dither) {
+  const size_t chunk_bytes = kChunkFrames * gains.size() * format.bytes();
+  std::vector<uint8_t> output;
+  while (generator->HasMoreFrames()) {
+    const size_t offset = output.size();
+    output.resize(offset + chunk_bytes);
+    const size_t written =
+        cache ? cache->GetFrames(generator, &output[offset], chunk_bytes)
+              : generator->GetFrames(format, gains, &output[offset],
+                                     chunk_bytes, dither);
+    output.resize(offset + written);
+    if (written == 0)
+      break;
+  }
+  return output;
+}
+
+// Frames served from the cache are byte for byte the frames the generator
+// writes itself in the integer formats, and within the accuracy of the
+// oscillator in float, with silent channels.
+TEST(ToneCacheTest, CachedFramesEqualGeneratedFrames) {
+  const Factory kFactories[] = {MakeSine, MakeChannelSine, MakeMls};
+  const SampleFormat::Type kTypes[] = {
+      SampleFormat::kPcmU8,     SampleFormat::kPcmS16,
+      SampleFormat::kPcmS24,    SampleFormat::kPcmS24In32,
+      SampleFormat::kPcmS32,    SampleFormat::kPcmFloat,
+  };
+  const std::vector<double> gains = {1.0, 0.0, 0.5};
+  for (Factory factory : kFactories) {
+    for (SampleFormat::Type type : kTypes) {
+      const SampleFormat format(type);
+      std::unique_ptr<ToneGenerator> live = factory();
+      const std::vector<uint8_t> expected =
+          Play(live.get(), NULL, format, gains, NULL);
+
+      std::unique_ptr<ToneGenerator> cached = factory();
+      ToneCache cache(format, gains);
+      const std::vector<uint8_t> actual =
+          Play(cached.get(), &cache, format, gains, NULL);
+
+      const int frames = kLengthSec * kSampleRate;
+      EXPECT_EQ(frames * gains.size() * format.bytes(), expected.size());
+      EXPECT_EQ(frames, cache.frames());
+      // All but the first two periods are copied from the cache.
+      EXPECT_GT(cache.cached_frames(), frames - 2 * 2048);
+      if (type != SampleFormat::kPcmFloat) {
+        EXPECT_TRUE(expected == actual) << format.to_string();
+        continue;
+      }
+      // Float samples keep the rounding errors of the oscillator, which
+      // differ between generating a period and skipping over it.
+      const int num_samples = expected.size() / format.bytes();
+      ASSERT_EQ(expected.size(), actual.size());
+      std::vector<double> expected_samples(num_samples);
+      std::vector<double> actual_samples(num_samples);
+      ConvertSamples(expected.data(), num_samples, format,
+                     expected_samples.data());
+      ConvertSamples(actual.data(), num_samples, format,
+                     actual_samples.data());
+      for (int i = 0; i < num_samples; ++i)
+        ASSERT_NEAR(expected_samples[i], actual_samples[i], 1e-9)
+            << format.to_string() << ", sample " << i;
+    }
+  }
+}
+
+// Dithered output is generated live, so it is the same as without the cache.
+TEST(ToneCacheTest, DitheredFramesAreGenerated) {
+  const SampleFormat format(SampleFormat::kPcmS16);
+  const std::vector<double> gains = {1.0, 0.5};
+  TpdfDither dither_live(1);
+  std::unique_ptr<ToneGenerator> live = MakeSine();
+  const std::vector<uint8_t> expected =
+      Play(live.get(), NULL, format, gains, &dither_live);
+
+  TpdfDither dither_cached(1);
+  std::unique_ptr<ToneGenerator> cached = MakeSine();
+  ToneCache cache(format, gains, &dither_cached);
+  const std::vector<uint8_t> actual =
+      Play(cached.get(), &cache, format, gains, NULL);
+
+  EXPECT_EQ(0, cache.cached_frames());
+  EXPECT_TRUE(expected == actual);
+}
+
+}  // namespace
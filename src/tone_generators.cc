@@ -4,20 +4,118 @@
 
 #include "include/tone_generators.h"
 
+#include <assert.h>
 #include <math.h>
 #include <stdio.h>
 
+#include <algorithm>
 #include <limits>
 
 namespace {
   static const double kPi = 3.14159265358979323846264338327l;
   static const double kHalfPi = kPi / 2.0;
+
+  // Number of frames generated into a planar buffer before they are
+  // interleaved into the output.
+  const int kChunkFrames = 256;
+
+  // Returns the fewest frames holding a whole number of cycles of
+  // |frequency|, or 0 if there are more than |max_frames|. Tones on a bin of
+  // a DFT repeat within the transform size.
+  int CyclePeriod(double frequency, int sample_rate, int max_frames) {
+    const double cycles = frequency / sample_rate;
+    for (int frames = 1; frames <= max_frames; ++frames) {
+      const double total = cycles * frames;
+      if (fabs(total - round(total)) < 1e-9)
+        return frames;
+    }
+    return 0;
+  }
+
+  // Returns the least common multiple of periods |a| and |b|, or 0 if either
+  // is 0 or the multiple exceeds |max_frames|.
+  int CommonPeriod(int a, int b, int max_frames) {
+    if (a == 0 || b == 0)
+      return 0;
+    int x = a, y = b;
+    while (y) {
+      const int t = x % y;
+      x = y;
+      y = t;
+    }
+    const long long period = static_cast<long long>(a) / x * b;
+    return period <= max_frames ? period : 0;
+  }
+
+  // Returns the common period of |frequencies|.
+  int TonesPeriod(const std::vector<double> &frequencies, int sample_rate) {
+    int period = 1;
+    for (double frequency : frequencies) {
+      const int max_frames = ToneGenerator::kMaxPeriodFrames;
+      period = CommonPeriod(
+          period, CyclePeriod(frequency, sample_rate, max_frames), max_frames);
+    }
+    return period;
+  }
+
+  // Use a fade of 2.5ms at both the start and end of a tone .
+  const double kFadeTimeSec = 0.005;
+
+  // Returns the gain of frame |frame| of a tone of |total_frames| frames,
+  // which rises and falls over |fade_frames| frames at its ends.
+  double FadeMagnitude(int frame, int total_frames, int fade_frames) {
+    const int frames_left = total_frames - frame;
+    if (frame < fade_frames)
+      return sin(kHalfPi * frame / fade_frames);
+    if (frames_left < fade_frames)
+      return sin(kHalfPi * frames_left / fade_frames);
+    return 1.0;
+  }
+
+  // Writes |num_frames| frames of the mono samples of |generator|, which are
+  // played on every channel, and returns the number of bytes written.
+  template <typename Generator>
+  size_t BroadcastFrames(Generator *generator, int num_frames,
+                         SampleFormat format,
+                         const std::vector<double> &channel_gains,
+                         void *data, TpdfDither *dither) {
+    const int num_channels = channel_gains.size();
+    double samples[kChunkFrames];
+    for (int i = 0; i < num_frames; i += kChunkFrames) {
+      const int count = std::min(kChunkFrames, num_frames - i);
+      generator->Generate(count, samples);
+      data = Broadcast(samples, channel_gains.data(), count, num_channels,
+                       format, data, dither);
+    }
+    return num_frames * num_channels * format.bytes();
+  }
+
+  // Feedback taps of maximal Galois LFSRs by order. The state shifts right,
+  // and the taps are applied when a 1 is shifted out.
+  const uint32_t kMlsTaps[MlsGenerator::kMaxOrder + 1] = {
+    0, 0, 0x3, 0x6, 0xc, 0x14, 0x30, 0x60, 0xb8, 0x110, 0x240, 0x500, 0x829,
+    0x100d, 0x2015, 0x6000, 0xd008, 0x12000, 0x20400, 0x40023, 0x90000,
+    0x140000, 0x300000, 0x420000, 0xe10000,
+  };
+
+  // Longest MLS order of MlsGenerator when it picks one.
+  const int kDefaultMlsOrder = 16;
+}
+
+std::vector<double> ChannelGains(int num_channels,
+                                 const std::set<int> &active_channels) {
+  std::vector<double> gains(num_channels, 0.0);
+  for (int c = 0; c < num_channels; ++c) {
+    if (active_channels.find(c) != active_channels.end())
+      gains[c] = 1.0;
+  }
+  return gains;
 }
 
 SineWaveGenerator::SineWaveGenerator(int sample_rate, double length_sec,
-    int volume_gain)
-    : cur_x_(0.0), cur_frame_(0), sample_rate_(sample_rate),
-      frequency_(0.0), volume_gain_(volume_gain) {
+    int volume_gain, Oscillator::Engine engine)
+    : oscillator_(engine), period_(0), serial_(0), cur_frame_(0),
+      sample_rate_(sample_rate), volume_gain_(volume_gain) {
   if (length_sec > 0)
     total_frame_ = length_sec * sample_rate;
   else
@@ -25,38 +123,116 @@ SineWaveGenerator::SineWaveGenerator(int sample_rate, double length_sec,
 }
 
 double SineWaveGenerator::Next() {
-  cur_x_ += (kPi * 2 * frequency_) / sample_rate_;
   cur_frame_++;
-  return sin(cur_x_) * volume_gain_ / 100.0;
+  return oscillator_.Next() * volume_gain_ / 100.0;
+}
+
+void SineWaveGenerator::Generate(int count, double *output) {
+  oscillator_.Generate(count, output);
+  const double gain = volume_gain_ / 100.0;
+  for (int i = 0; i < count; ++i)
+    output[i] *= gain;
+  cur_frame_ += count;
 }
+
 void SineWaveGenerator::Reset(double frequency) {
-  cur_x_ = 0;
   cur_frame_ = 0;
-  frequency_ = frequency;
+  oscillator_.Reset(frequency, sample_rate_);
+  period_ = CyclePeriod(frequency, sample_rate_, kMaxPeriodFrames);
+  ++serial_;
+}
+
+size_t SineWaveGenerator::GetFrames(SampleFormat format,
+    const std::vector<double> &channel_gains, void *data, size_t buf_size,
+    TpdfDither *dither) {
+  const int num_channels = channel_gains.size();
+
+  int remain_frames = total_frame_ > 0
+                      ? (total_frame_ - cur_frame_)
+                      : std::numeric_limits<int>::max();
+  int frame_required = buf_size / num_channels / format.bytes();
+  int num_frames = std::min(frame_required, remain_frames);
+
+  // Every channel plays the same tone.
+  return BroadcastFrames(this, num_frames, format, channel_gains, data,
+                         dither);
 }
 
-size_t SineWaveGenerator::GetFrames(SampleFormat format, int num_channels,
-    const std::set<int> &active_channels, void *data, size_t buf_size) {
+bool SineWaveGenerator::HasMoreFrames() const {
+  if (total_frame_ > 0) {
+    return cur_frame_ < total_frame_;
+  }
+  // Infinite.
+  return true;
+}
 
+ToneGenerator::Period SineWaveGenerator::GetPeriod() const {
+  Period period;
+  period.frames = period_;
+  period.repeat_frames = total_frame_ > 0
+                         ? total_frame_ - cur_frame_
+                         : std::numeric_limits<long long>::max();
+  period.serial = serial_;
+  return period;
+}
+
+void SineWaveGenerator::Skip(int num_frames) {
+  oscillator_.Skip(num_frames);
+  cur_frame_ += num_frames;
+}
+
+ChannelSineWaveGenerator::ChannelSineWaveGenerator(int sample_rate,
+                                                   double length_sec,
+                                                   int volume_gain)
+    : period_(0), serial_(0), cur_frame_(0), sample_rate_(sample_rate),
+      volume_gain_(volume_gain) {
+  if (length_sec > 0)
+    total_frame_ = length_sec * sample_rate;
+  else
+    total_frame_ = 0;
+}
+
+void ChannelSineWaveGenerator::Reset(const std::vector<double> &frequencies) {
+  tone_wave_.resize(frequencies.size(),
+                    SineWaveGenerator(sample_rate_, -1.0, volume_gain_));
+  for (size_t c = 0; c < frequencies.size(); ++c)
+    tone_wave_[c].Reset(frequencies[c]);
+  cur_frame_ = 0;
+  period_ = TonesPeriod(frequencies, sample_rate_);
+  ++serial_;
+}
+
+size_t ChannelSineWaveGenerator::GetFrames(SampleFormat format,
+    const std::vector<double> &channel_gains, void *data, size_t buf_size,
+    TpdfDither *dither) {
+  const int num_channels = channel_gains.size();
   int remain_frames = total_frame_ > 0
-                      ? (static_cast<int>(total_frame_) - cur_frame_ - 1)
+                      ? (total_frame_ - cur_frame_)
                       : std::numeric_limits<int>::max();
   int frame_required = buf_size / num_channels / format.bytes();
   int num_frames = std::min(frame_required, remain_frames);
 
-  for (int i = 0; i < num_frames; ++i) {
-    double sample = Next();
-    for (int c = 0; c < num_channels; ++c) {
-      if (active_channels.find(c) != active_channels.end())
-        data = WriteSample(sample, format, data);
-      else
-        data = WriteSample(0.0f, format, data);
+  // Channels without a tone have no plane and are silent.
+  const int num_tones = std::min<int>(tone_wave_.size(), num_channels);
+  buffer_.resize(num_tones * kChunkFrames);
+  planes_.assign(num_channels, NULL);
+  for (int c = 0; c < num_tones; ++c)
+    planes_[c] = &buffer_[c * kChunkFrames];
+
+  for (int i = 0; i < num_frames; i += kChunkFrames) {
+    const int count = std::min(kChunkFrames, num_frames - i);
+    for (int c = 0; c < num_tones; ++c) {
+      if (channel_gains[c] != 0)
+        tone_wave_[c].Generate(count, &buffer_[c * kChunkFrames]);
     }
+    data = Interleave(planes_.data(), channel_gains.data(), count,
+                      num_channels, format, data, dither);
   }
-  return num_frames;
+  cur_frame_ += num_frames;
+  return num_frames * num_channels * format.bytes();
 }
 
-bool SineWaveGenerator::HasMoreFrames() const {
+bool ChannelSineWaveGenerator::HasMoreFrames() const {
   if (total_frame_ > 0) {
     return cur_frame_ < total_frame_;
   }
@@ -64,130 +240,228 @@ bool SineWaveGenerator::HasMoreFrames() const {
   return true;
 }
 
+ToneGenerator::Period ChannelSineWaveGenerator::GetPeriod() const {
+  Period period;
+  period.frames = period_;
+  period.repeat_frames = total_frame_ > 0
+                         ? total_frame_ - cur_frame_
+                         : std::numeric_limits<long long>::max();
+  period.serial = serial_;
+  return period;
+}
+
+void ChannelSineWaveGenerator::Skip(int num_frames) {
+  for (auto &tone : tone_wave_)
+    tone.Skip(num_frames);
+  cur_frame_ += num_frames;
+}
+
+MultiToneGenerator::Params::Params()
+    : start_vol(1.0),
+      end_vol(1.0),
+      period(1),
+      restarts(0),
+      volume_changes(0),
+      serial(0) {}
+
 MultiToneGenerator::MultiToneGenerator(int sample_rate, double length_sec)
-    : frames_generated_(0),
+    : write_index_(0),
+      read_index_(1),
+      shared_index_(2),
+      glide_frame_(0),
+      glide_frames_(0),
+      restarts_(0),
+      volume_changes_(0),
+      frames_generated_(0),
       frames_wanted_(length_sec * sample_rate),
       fade_frames_(0),  // Calculated below.
       sample_rate_(sample_rate),
       cur_vol_(1.0),
-      start_vol_(1.0),
       inc_vol_(0.0) {
 
-  // Use a fade of 2.5ms at both the start and end of a tone .
-  const double kFadeTimeSec = 0.005;
-
   // Only fade if the fade won't take more than 1/2 the tone.
   if (length_sec > (kFadeTimeSec * 4)) {
     fade_frames_ = kFadeTimeSec * sample_rate;
   }
 
-  frequencies_.clear();
-  pthread_mutex_init(&param_mutex, NULL);
+  // Frequency changes glide over as long as a fade.
+  glide_frames_ = kFadeTimeSec * sample_rate;
+  glide_frame_ = glide_frames_;
+  tone_buffer_.resize(kChunkFrames);
 }
 
 MultiToneGenerator::~MultiToneGenerator() {
-  pthread_mutex_destroy(&param_mutex);
 }
 
 void MultiToneGenerator::SetVolumes(double start_vol, double end_vol) {
-  pthread_mutex_lock(&param_mutex);
-  cur_vol_ = start_vol_ = start_vol;
-  inc_vol_ = (end_vol - start_vol) / frames_wanted_;
-  pthread_mutex_unlock(&param_mutex);
+  control_.start_vol = start_vol;
+  control_.end_vol = end_vol;
+  ++control_.volume_changes;
+  Publish();
 }
 
 void MultiToneGenerator::Reset(const std::vector<double> &frequencies,
                                bool reset_timer) {
-  pthread_mutex_lock(&param_mutex);
-  frequencies_ = frequencies;
-  if (reset_timer) {
-    frames_generated_ = 0;
-    cur_vol_ = start_vol_;
-  }
-  pthread_mutex_unlock(&param_mutex);
+  Reset(frequencies.data(), frequencies.size(), reset_timer);
 }
 
 void MultiToneGenerator::Reset(const double *frequency, int num_tones,
                                bool reset_timer) {
-  pthread_mutex_lock(&param_mutex);
-  frequencies_.resize(num_tones);
-  for (int i = 0; i < num_tones; ++i) {
-    frequencies_[i] = frequency[i];
-  }
-  if (reset_timer) {
-    frames_generated_ = 0;
-    cur_vol_ = start_vol_;
-  }
-  pthread_mutex_unlock(&param_mutex);
+  control_.frequencies.assign(frequency, frequency + num_tones);
+  control_.period = TonesPeriod(control_.frequencies, sample_rate_);
+  if (reset_timer)
+    ++control_.restarts;
+  Publish();
 }
 
 void MultiToneGenerator::Reset(double frequency, bool reset_timer) {
-  pthread_mutex_lock(&param_mutex);
-  frequencies_.resize(1);
-  frequencies_[0] = frequency;
-  if (reset_timer) {
+  Reset(&frequency, 1, reset_timer);
+}
+
+void MultiToneGenerator::Publish() {
+  ++control_.serial;
+  params_[write_index_] = control_;
+  // Hands the written copy over, and takes the one GetFrames() left behind
+  // or an older one it never picked up.
+  write_index_ = shared_index_.exchange(write_index_ | kDirty,
+                                        std::memory_order_acq_rel) &
+                 kIndexMask;
+}
+
+void MultiToneGenerator::ApplyParams() {
+  if (!(shared_index_.load(std::memory_order_acquire) & kDirty))
+    return;
+  read_index_ = shared_index_.exchange(read_index_,
+                                       std::memory_order_acq_rel) &
+                kIndexMask;
+  const Params &params = params_[read_index_];
+
+  const bool restart = params.restarts != restarts_;
+  restarts_ = params.restarts;
+  if (restart) {
     frames_generated_ = 0;
-    cur_vol_ = start_vol_;
+    cur_vol_ = params.start_vol;
+  }
+  if (params.volume_changes != volume_changes_) {
+    volume_changes_ = params.volume_changes;
+    cur_vol_ = params.start_vol;
+  }
+  inc_vol_ = (params.end_vol - params.start_vol) / frames_wanted_;
+
+  // Tones which keep playing glide from the frequency they play now. The
+  // others start from phase 0, under the fade in of a restarted tone.
+  const size_t num_kept = restart ? 0 : std::min(tones_.size(),
+                                                 params.frequencies.size());
+  tones_.resize(params.frequencies.size());
+  frequencies_.resize(params.frequencies.size());
+  glide_start_.resize(params.frequencies.size());
+  bool glides = false;
+  for (size_t f = 0; f < params.frequencies.size(); ++f) {
+    if (f < num_kept) {
+      glides |= frequencies_[f] != params.frequencies[f];
+    } else {
+      tones_[f].Reset(params.frequencies[f], sample_rate_);
+      frequencies_[f] = params.frequencies[f];
+    }
+    glide_start_[f] = frequencies_[f];
+  }
+  glide_frame_ = glides ? 0 : glide_frames_;
+}
+
+void MultiToneGenerator::UpdateGlide(int count) {
+  const std::vector<double> &targets = params_[read_index_].frequencies;
+  glide_frame_ = std::min(glide_frame_ + count, glide_frames_);
+  const double progress = static_cast<double>(glide_frame_) / glide_frames_;
+  for (size_t f = 0; f < tones_.size(); ++f) {
+    // The last step lands on the target exactly.
+    const double frequency =
+        glide_frame_ == glide_frames_
+            ? targets[f]
+            : glide_start_[f] + (targets[f] - glide_start_[f]) * progress;
+    if (frequency != frequencies_[f]) {
+      tones_[f].SetFrequency(frequency);
+      frequencies_[f] = frequency;
+    }
   }
-  pthread_mutex_unlock(&param_mutex);
 }
 
 size_t MultiToneGenerator::GetFrames(SampleFormat format,
-                                     int num_channels,
-                                     const std::set<int> &active_channels,
+                                     const std::vector<double> &channel_gains,
                                      void *data,
-                                     size_t buf_size) {
+                                     size_t buf_size,
+                                     TpdfDither *dither) {
+  // Steps of a glide, short enough not to be heard as steps.
+  const int kGlideStepFrames = 16;
+  const int num_channels = channel_gains.size();
   const int kBytesPerFrame = num_channels * format.bytes();
   void *cur = data;
   int frames = buf_size / kBytesPerFrame;
-  int frames_written;
-  pthread_mutex_lock(&param_mutex);
-  tone_wave_.resize(frequencies_.size(), SineWaveGenerator(sample_rate_));
-  for (size_t f = 0; f < frequencies_.size(); ++f)
-    tone_wave_[f].Reset(frequencies_[f]);
-
-  for (frames_written = 0; frames_written < frames; ++frames_written) {
-    if (!HasMoreFrames()) {
-      break;
+  int frames_written = 0;
+  double samples[kChunkFrames];
+  ApplyParams();
+
+  // MultiToneGenerator averages tones generated at half of the full scale.
+  const double scale = tones_.size() > 1
+                       ? 0.5 / static_cast<double>(tones_.size())
+                       : 0.5;
+  while (frames_written < frames && frames_generated_ < frames_wanted_) {
+    int count = std::min(std::min(kChunkFrames, frames - frames_written),
+                         frames_wanted_ - frames_generated_);
+    if (glide_frame_ < glide_frames_) {
+      count = std::min(count, kGlideStepFrames);
+      UpdateGlide(count);
     }
-
-    double frame_magnitude = 0;
-    for (size_t f = 0; f < frequencies_.size(); ++f) {
-      frame_magnitude += tone_wave_[f].Next();
-    }
-    frame_magnitude *= GetFadeMagnitude() * cur_vol_;
-    if (frequencies_.size() > 1) {
-      frame_magnitude /= static_cast<double>(frequencies_.size());
+    // Mixes whole blocks of each tone, then applies the envelope.
+    std::fill(samples, samples + count, 0.0);
+    for (Oscillator &tone : tones_) {
+      tone.Generate(count, tone_buffer_.data());
+      for (int j = 0; j < count; ++j)
+        samples[j] += tone_buffer_[j];
     }
-    cur_vol_ += inc_vol_;
-    for (int c = 0; c < num_channels; ++c) {
-      if (active_channels.find(c) != active_channels.end()) {
-        cur = WriteSample(frame_magnitude, format, cur);
-      } else {
-        // Silence the non-active channels.
-        cur = WriteSample(0.0f, format, cur);
-      }
+    for (int j = 0; j < count; ++j) {
+      samples[j] *= GetFadeMagnitude() * cur_vol_ * scale;
+      cur_vol_ += inc_vol_;
+      ++frames_generated_;
     }
-
-    ++frames_generated_;
+    // Every active channel plays the same mix. Non-active channels have a
+    // zero gain and are silenced.
+    cur = Broadcast(samples, channel_gains.data(), count, num_channels, format,
+                    cur, dither);
+    frames_written += count;
   }
-  pthread_mutex_unlock(&param_mutex);
   return frames_written * kBytesPerFrame;
 }
 
 bool MultiToneGenerator::HasMoreFrames() const {
-  return frames_generated_ < frames_wanted_;
+  return frames_generated_ < frames_wanted_ ||
+         (shared_index_.load(std::memory_order_acquire) & kDirty);
 }
 
-double MultiToneGenerator::GetFadeMagnitude() const {
-  int frames_left = frames_wanted_ - frames_generated_;
-  if (frames_generated_ < fade_frames_) {  // Fade in.
-    return sin(kHalfPi * frames_generated_ / fade_frames_);
-  } else if (frames_left < fade_frames_) {  // Fade out.
-    return sin(kHalfPi * frames_left / fade_frames_);
-  } else {
-    return 1.0f;
+ToneGenerator::Period MultiToneGenerator::GetPeriod() const {
+  Period period;
+  const Params &params = params_[read_index_];
+  period.serial = params.serial;
+  // Parameters waiting to be picked up may change the tones.
+  if (shared_index_.load(std::memory_order_acquire) & kDirty)
+    return period;
+  const int fade_out_start = frames_wanted_ - fade_frames_;
+  if (inc_vol_ == 0 && glide_frame_ == glide_frames_ &&
+      frames_generated_ >= fade_frames_ &&
+      frames_generated_ < fade_out_start) {
+    period.frames = params.period;
+    period.repeat_frames = fade_out_start - frames_generated_;
   }
+  return period;
+}
+
+void MultiToneGenerator::Skip(int num_frames) {
+  for (Oscillator &tone : tones_)
+    tone.Skip(num_frames);
+  frames_generated_ += num_frames;
+}
+
+double MultiToneGenerator::GetFadeMagnitude() const {
+  return FadeMagnitude(frames_generated_, frames_wanted_, fade_frames_);
 }
 
 // A# minor harmoic scale is: A#, B# (C), C#, D#, E# (F), F#, G## (A).
@@ -215,11 +489,9 @@ void ASharpMinorGenerator::Reset() {
   tone_generator_.Reset(kNoteFrequencies[cur_note_], true);
 }
 
-size_t ASharpMinorGenerator::GetFrames(SampleFormat format,
-                                       int num_channels,
-                                       const std::set<int> &active_channels,
-                                       void *data,
-                                       size_t buf_size) {
+size_t ASharpMinorGenerator::GetFrames(
+    SampleFormat format, const std::vector<double> &channel_gains,
+    void *data, size_t buf_size, TpdfDither *dither) {
   if (!HasMoreFrames()) {
     return 0;
   }
@@ -229,13 +501,196 @@ size_t ASharpMinorGenerator::GetFrames(SampleFormat format,
     tone_generator_.Reset(kNoteFrequencies[++cur_note_], true);
   }
 
-  return tone_generator_.GetFrames(format,
-                                   num_channels,
-                                   active_channels,
-                                   data,
-                                   buf_size);
+  return tone_generator_.GetFrames(format, channel_gains, data, buf_size,
+                                   dither);
 }
 
 bool ASharpMinorGenerator::HasMoreFrames() const {
   return cur_note_ < kNumNotes - 1 || tone_generator_.HasMoreFrames();
 }
+
+SweepGenerator::SweepGenerator(int sample_rate, double length_sec,
+                               double start_frequency, double end_frequency,
+                               int volume_gain)
+    : total_frames_(length_sec * sample_rate),
+      cur_frame_(0),
+      fade_frames_(0),
+      volume_(volume_gain / 100.0),
+      start_cycles_(start_frequency / sample_rate),
+      growth_(1.0),
+      phase_(0.0),
+      cycles_(start_cycles_) {
+  if (length_sec > kFadeTimeSec * 4)
+    fade_frames_ = kFadeTimeSec * sample_rate;
+  // The last frame plays the end frequency.
+  if (total_frames_ > 1)
+    growth_ = pow(end_frequency / start_frequency, 1.0 / (total_frames_ - 1));
+}
+
+void SweepGenerator::Reset() {
+  cur_frame_ = 0;
+  phase_ = 0.0;
+  cycles_ = start_cycles_;
+}
+
+void SweepGenerator::Generate(int count, double *output) {
+  for (int i = 0; i < count; ++i) {
+    output[i] = sin(2 * M_PI * phase_) * volume_ *
+                FadeMagnitude(cur_frame_ + i, total_frames_, fade_frames_);
+    phase_ += cycles_;
+    cycles_ *= growth_;
+  }
+  // Whole cycles are dropped, so the phase keeps its precision.
+  phase_ -= floor(phase_);
+  cur_frame_ += count;
+}
+
+size_t SweepGenerator::GetFrames(SampleFormat format,
+    const std::vector<double> &channel_gains, void *data, size_t buf_size,
+    TpdfDither *dither) {
+  const int num_frames =
+      std::min<int>(buf_size / channel_gains.size() / format.bytes(),
+                    total_frames_ - cur_frame_);
+  return BroadcastFrames(this, num_frames, format, channel_gains, data,
+                         dither);
+}
+
+bool SweepGenerator::HasMoreFrames() const {
+  return cur_frame_ < total_frames_;
+}
+
+NoiseGenerator::NoiseGenerator(int sample_rate, double length_sec,
+                               Color color, uint32_t seed, int volume_gain)
+    : color_(color),
+      seed_(seed),
+      noise_(seed),
+      total_frames_(length_sec * sample_rate),
+      cur_frame_(0),
+      volume_(volume_gain / 100.0) {
+  std::fill(pink_, pink_ + kPinkPoles, 0.0);
+}
+
+void NoiseGenerator::Reset() {
+  noise_ = UniformNoise(seed_);
+  std::fill(pink_, pink_ + kPinkPoles, 0.0);
+  cur_frame_ = 0;
+}
+
+void NoiseGenerator::Generate(int count, double *output) {
+  noise_.Generate(count, output);
+  cur_frame_ += count;
+  if (color_ == kWhite) {
+    for (int i = 0; i < count; ++i)
+      output[i] *= volume_;
+    return;
+  }
+  // Paul Kellet's pinking filter, a sum of first order low passes which
+  // follows -3 dB per octave within 0.05 dB over the audio band. The scale
+  // brings uniform noise to an RMS of 0.25.
+  const double kScale = 0.1407;
+  double b0 = pink_[0], b1 = pink_[1], b2 = pink_[2], b3 = pink_[3],
+         b4 = pink_[4], b5 = pink_[5], b6 = pink_[6];
+  for (int i = 0; i < count; ++i) {
+    const double white = output[i];
+    b0 = 0.99886 * b0 + white * 0.0555179;
+    b1 = 0.99332 * b1 + white * 0.0750759;
+    b2 = 0.96900 * b2 + white * 0.1538520;
+    b3 = 0.86650 * b3 + white * 0.3104856;
+    b4 = 0.55000 * b4 + white * 0.5329522;
+    b5 = -0.7616 * b5 - white * 0.0168980;
+    output[i] = (b0 + b1 + b2 + b3 + b4 + b5 + b6 + white * 0.5362) *
+                kScale * volume_;
+    b6 = white * 0.115926;
+  }
+  pink_[0] = b0;
+  pink_[1] = b1;
+  pink_[2] = b2;
+  pink_[3] = b3;
+  pink_[4] = b4;
+  pink_[5] = b5;
+  pink_[6] = b6;
+}
+
+size_t NoiseGenerator::GetFrames(SampleFormat format,
+    const std::vector<double> &channel_gains, void *data, size_t buf_size,
+    TpdfDither *dither) {
+  const int num_frames =
+      std::min<int>(buf_size / channel_gains.size() / format.bytes(),
+                    total_frames_ - cur_frame_);
+  return BroadcastFrames(this, num_frames, format, channel_gains, data,
+                         dither);
+}
+
+bool NoiseGenerator::HasMoreFrames() const {
+  return cur_frame_ < total_frames_;
+}
+
+MlsGenerator::MlsGenerator(int sample_rate, double length_sec, int order,
+                           uint32_t seed, int volume_gain)
+    : order_(order),
+      total_frames_(length_sec * sample_rate),
+      cur_frame_(0),
+      volume_(volume_gain / 100.0),
+      serial_(0) {
+  if (order_ == 0) {
+    order_ = kDefaultMlsOrder;
+    while (order_ > kMinOrder && 2 * ((1 << order_) - 1) > total_frames_)
+      --order_;
+  }
+  assert(order_ >= kMinOrder && order_ <= kMaxOrder);
+  period_ = (1 << order_) - 1;
+  taps_ = kMlsTaps[order_];
+  // Any state but 0 is on the sequence.
+  start_state_ = seed % period_ + 1;
+  state_ = start_state_;
+}
+
+void MlsGenerator::Reset() {
+  state_ = start_state_;
+  cur_frame_ = 0;
+  ++serial_;
+}
+
+void MlsGenerator::Generate(int count, double *output) {
+  uint32_t state = state_;
+  for (int i = 0; i < count; ++i) {
+    const uint32_t bit = state & 1;
+    output[i] = bit ? -volume_ : volume_;
+    state = (state >> 1) ^ (-bit & taps_);
+  }
+  state_ = state;
+  cur_frame_ += count;
+}
+
+size_t MlsGenerator::GetFrames(SampleFormat format,
+    const std::vector<double> &channel_gains, void *data, size_t buf_size,
+    TpdfDither *dither) {
+  const int num_frames =
+      std::min<int>(buf_size / channel_gains.size() / format.bytes(),
+                    total_frames_ - cur_frame_);
+  return BroadcastFrames(this, num_frames, format, channel_gains, data,
+                         dither);
+}
+
+bool MlsGenerator::HasMoreFrames() const {
+  return cur_frame_ < total_frames_;
+}
+
+ToneGenerator::Period MlsGenerator::GetPeriod() const {
+  Period period;
+  if (period_ <= kMaxPeriodFrames) {
+    period.frames = period_;
+    period.repeat_frames = total_frames_ - cur_frame_;
+  }
+  period.serial = serial_;
+  return period;
+}
+
+void MlsGenerator::Skip(int num_frames) {
+  // The sequence comes back to the same state every period.
+  uint32_t state = state_;
+  for (int i = num_frames % period_; i > 0; --i)
+    state = (state >> 1) ^ (-(state & 1) & taps_);
+  state_ = state;
+  cur_frame_ += num_frames;
+}
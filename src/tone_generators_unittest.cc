@@ -0,0 +1,51 @@
+// Copyright 2019 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <algorithm>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "include/tone_generators.h"
+
+namespace {
+
+const int kSampleRate = 48000;
+const int kChunkFrames = 4096;
+
+// The sequence of every order comes back after exactly 2^order - 1 samples.
+// It repeats after its period, and a period holds 2^(order - 1) samples of
+// -1, one for each state with its low bit set. A shorter period would divide
+// 2^order - 1 into an odd number of equal parts, whose -1 samples could not
+// add up to a power of two, so the period is the shortest.
+TEST(MlsGeneratorTest, PeriodIsMaximal) {
+  std::vector<double> first(kChunkFrames);
+  std::vector<double> next(kChunkFrames);
+  for (int order = MlsGenerator::kMinOrder; order <= MlsGenerator::kMaxOrder;
+       ++order) {
+    const int period = (1 << order) - 1;
+    MlsGenerator generator(kSampleRate, 1.0, order, order);
+    MlsGenerator shifted(kSampleRate, 1.0, order, order);
+    ASSERT_EQ(period, generator.period());
+
+    int negatives = 0;
+    for (int n = 0; n < period; n += kChunkFrames) {
+      const int count = std::min(kChunkFrames, period - n);
+      shifted.Generate(count, next.data());
+      negatives += std::count(next.begin(), next.begin() + count, -0.5);
+    }
+    EXPECT_EQ(1 << (order - 1), negatives) << "order " << order;
+
+    for (int n = 0; n < period; n += kChunkFrames) {
+      const int count = std::min(kChunkFrames, period - n);
+      generator.Generate(count, first.data());
+      shifted.Generate(count, next.data());
+      ASSERT_TRUE(std::equal(first.begin(), first.begin() + count,
+                             next.begin()))
+          << "order " << order << ", frame " << n;
+    }
+  }
+}
+
+}  // namespace
@@ -0,0 +1,68 @@
+// Copyright 2019 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "include/window.h"
+
+#include <assert.h>
+
+#include <cmath>
+
+namespace {
+
+// Coefficients of cosine-sum windows:
+//   w[n] = a0 - a1 * cos(2 * pi * n / N) + a2 * cos(4 * pi * n / N) - ...
+const double kHannCoefficients[] = {0.5, 0.5};
+const double kBlackmanHarrisCoefficients[] = {
+  0.35875, 0.48829, 0.14128, 0.01168,
+};
+
+std::vector<double> CosineSumWindow(const double *coefficients, int count,
+                                    int size) {
+  std::vector<double> window(size);
+  for (int n = 0; n < size; ++n) {
+    double value = 0.0;
+    for (int i = 0; i < count; ++i) {
+      const double term = coefficients[i] * cos(2 * M_PI * i * n / size);
+      value += (i % 2) ? -term : term;
+    }
+    window[n] = value;
+  }
+  return window;
+}
+
+}  // namespace
+
+WindowFunction::WindowFunction(): type_(kRectangular) {}
+WindowFunction::WindowFunction(Type type): type_(type) {}
+
+WindowFunction::Type WindowFunction::type() const {
+  return type_;
+}
+
+const char *WindowFunction::to_string() const {
+  switch (type_) {
+    case kRectangular:
+      return "rectangular";
+    case kHann:
+      return "hann";
+    case kBlackmanHarris:
+      return "blackman-harris";
+    default:
+      return "INVALID";
+  }
+}
+
+std::vector<double> WindowFunction::Generate(int size) const {
+  switch (type_) {
+    case kRectangular:
+      return std::vector<double>(size, 1.0);
+    case kHann:
+      return CosineSumWindow(kHannCoefficients, 2, size);
+    case kBlackmanHarris:
+      return CosineSumWindow(kBlackmanHarrisCoefficients, 4, size);
+    default:
+      assert(false);
+      return std::vector<double>();
+  }
+}